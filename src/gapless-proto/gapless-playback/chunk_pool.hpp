@@ -0,0 +1,82 @@
+#ifndef CHUNK_POOL_HPP_r8v2kq6n
+#define CHUNK_POOL_HPP_r8v2kq6n
+
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+//! A fixed number of fixed size chunks for the output queue.  All the memory
+//! is allocated up front so the steady state does no heap allocation at all.
+//!
+//! The free list is a single-producer single-consumer ring of pointers.  The
+//! output side (the sdl callback) puts chunks back and the decoding side takes
+//! them, so neither ever waits on a lock.  Only one thread at a time may
+//! release and only one may acquire.
+//!
+//! There is one more slot in the ring than there are chunks, so it can never
+//! fill up and release() never fails.
+class chunk_pool : boost::noncopyable {
+  public:
+    chunk_pool(std::size_t chunk_size, std::size_t num_chunks)
+    : chunk_size_(chunk_size), memory_(chunk_size * num_chunks), free_(num_chunks + 1) {
+      for (std::size_t i = 0; i < num_chunks; ++i) {
+        free_[i] = &memory_[i * chunk_size];
+      }
+      head_.store(0, boost::memory_order_relaxed);
+      tail_.store(num_chunks, boost::memory_order_relaxed);
+    }
+
+    std::size_t chunk_size() const { return chunk_size_; }
+
+    //! \brief Take a chunk, or NULL if they're all in use.
+    void *try_acquire() {
+      const std::size_t h = head_.load(boost::memory_order_relaxed);
+      if (h == tail_.load(boost::memory_order_acquire)) {
+        return NULL;
+      }
+
+      void *const p = free_[h];
+      head_.store(next(h), boost::memory_order_release);
+      return p;
+    }
+
+    //! \brief Take a chunk, waiting for the output to give one back.
+    //!
+    //! This is what stops the decoder getting too far ahead now there's a
+    //! fixed number of chunks.
+    void *acquire() {
+      void *p;
+      while ((p = try_acquire()) == NULL) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(2));
+      }
+      return p;
+    }
+
+    //! \brief Give a chunk back.  Wait-free so the callback can do it.
+    void release(void *p) {
+      assert(p != NULL);
+      assert((unsigned char *) p >= &memory_[0] && (unsigned char *) p < &memory_[0] + memory_.size());
+
+      const std::size_t t = tail_.load(boost::memory_order_relaxed);
+      free_[t] = p;
+      tail_.store(next(t), boost::memory_order_release);
+    }
+
+  private:
+    std::size_t next(std::size_t i) const { return (i + 1 == free_.size()) ? 0 : i + 1; }
+
+    const std::size_t chunk_size_;
+    std::vector<unsigned char> memory_;
+    std::vector<void *> free_;
+
+    // Acquiring side.
+    boost::atomic<std::size_t> head_;
+    // Releasing side.
+    boost::atomic<std::size_t> tail_;
+};
+
+#endif
@@ -20,13 +20,9 @@ bool queue_small_enough() {
 //   of this thread sharing stuff.
 //
 // NOTE:
-//   Regarding pooling, the stl list is already pooled *but* I can't control
-//   locality for it, nor can I do a reduced allocate which just uses blocks
-//   from a stack.  The best solution might be a private inheriteed list, which
-//   gets rid of all the multiple-block allocating functions, but still uses an
-//   pool... only problem is we really want to tag each pool differently...
-//   meh this is all such low level stuff it's not clear exactly what is the
-//   cost of doing it.
+//   The buffers come from the chunk_pool so there's no allocating here.  The
+//   queue is bounded by the number of chunks because packet_state waits for
+//   one to come back before it starts the next.
 void push_packet(void *sample_buffer) {
   synced_type::value_type &q = synced_queue.data();
   {
@@ -86,10 +82,13 @@ void chunkinate_file(packet_state &state, const char * const file_name, bool dum
     void *sample_buffer;
     while ((sample_buffer = degap.get_packet()) != NULL) {
       if (dump_to_file) {
+        // Nothing reads the queue when dumping, so it goes straight back.
         fwrite(sample_buffer, sizeof(uint8_t), state.size(), dump_output_file);
+        chunks->release(sample_buffer);
+      }
+      else {
+        push_packet(sample_buffer);
       }
-
-      push_packet(sample_buffer);
     }
   }
 
@@ -119,9 +118,11 @@ void chunkinate_finish(packet_state &state, bool dump_to_file) {
   if (dump_to_file) {
     fwrite(p, sizeof(uint8_t), buffer_size, dump_output_file);
     fsync(fileno(dump_output_file));
+    chunks->release(p);
+  }
+  else {
+    push_packet(p);
   }
-
-  push_packet(p);
 
   // we didn't bother iwht the thread if file dumping.
   boost::unique_lock<boost::mutex> lk(synced_queue.mutex());
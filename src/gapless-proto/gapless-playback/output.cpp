@@ -40,8 +40,7 @@ void sdl_callback(void*,uint8_t *stream, int length) {
 
   // trc("writing output data of length " << length);
   std::memcpy(stream, buffer, length);
-  // pool.deallocate(buffer);
-  // trc("freeing " << buffer);
-  std::free(buffer);
+  // trc("releasing " << buffer);
+  chunks->release(buffer);
 }
 
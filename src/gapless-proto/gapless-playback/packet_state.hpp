@@ -1,6 +1,8 @@
 #ifndef PACKET_STATE_HPP_31f8zdup
 #define PACKET_STATE_HPP_31f8zdup
 
+#include "chunk_pool.hpp"
+
 //! Seperate stateful object which builds packets.
 //!
 //! It must be seperate so it can exist in a higher scope than a file
@@ -8,16 +10,19 @@
 //! should never need to be touched by the other code.
 class packet_state : boost::noncopyable {
   public:
-    //! \brief The packet size is the size of the buffer to pass to the output queue.
+    //! \brief Packets are chunks from the pool, so the pool's chunk size is
+    //! the size of the buffer to pass to the output queue.
     //! Silence value is normally 0, but sometimes it's not!
-    packet_state(std::size_t packet_size, int silence_value)
-    : packet_(NULL), packet_size_(packet_size), packet_index_(0), silence_value_(silence_value) {
-      packet_ = std::malloc(packet_size);
+    packet_state(chunk_pool &pool, int silence_value)
+    : pool_(pool), packet_(NULL), packet_size_(pool.chunk_size()), packet_index_(0), silence_value_(silence_value) {
+      packet_ = pool_.acquire();
       assert(packet_ != NULL);
     }
 
     ~packet_state() {
-      std::free(packet_);
+      if (packet_) {
+        pool_.release(packet_);
+      }
     }
 
     std::size_t index() const { return packet_index_; }
@@ -35,7 +40,7 @@ class packet_state : boost::noncopyable {
       return copy_len;
     }
 
-    //! \brief Set unused bytes to silence and return the ptr on the heap.
+    //! \brief Set unused bytes to silence and return the chunk.
     void *get_final() {
       finalise();
       return clear();
@@ -47,14 +52,13 @@ class packet_state : boost::noncopyable {
     //   nice one... possibly it's a neceesary one though if you end up having
     //   to restart the audio thread anyway.
 
-    //! \brief Returns old packet (on the heap).
+    //! \brief Returns old packet (a chunk from the pool).  Waits if there
+    //! isn't a free chunk for the next one.
     void *reset() {
-      /// TODO:
-      ///   need to use some kind of allocator to get these; also an RAII type.
       void *p = clear();
       assert(packet_ == NULL);
       assert(p != NULL);
-      packet_ = std::malloc(packet_size_);
+      packet_ = pool_.acquire();
       // std::cout << "reset(): release: " << p << std::endl;
       // std::cout << "reset(): alloc:   " << packet_ << std::endl;
       return p;
@@ -80,6 +84,7 @@ class packet_state : boost::noncopyable {
       packet_index_ = packet_size_;
     }
 
+    chunk_pool &pool_;
     void *packet_;
     const std::size_t packet_size_;
     std::size_t packet_index_;
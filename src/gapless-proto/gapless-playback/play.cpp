@@ -40,7 +40,11 @@ int play_from_list(playlist_type &list) {
     ffmpeg::initialiser ff;
     trc("Finished initialising.");
 
-    packet_state state(dev.obtained().buffer_size(), dev.obtained().silence());
+    // Enough to cover the queue limit the decoder used to keep to, plus the
+    // ones held by the degapifier and the callback.
+    chunk_pool pool(dev.obtained().buffer_size(), 32);
+    chunks = &pool;
+    packet_state state(pool, dev.obtained().silence());
 
     if (! make_file_output) dev.unpause();
 
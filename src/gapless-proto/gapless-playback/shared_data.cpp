@@ -1,6 +1,7 @@
 #include "shared_data.hpp"
 
 synced_type synced_queue;
+chunk_pool *chunks = NULL;
 
 // messy - prolly needs a bool callback_finished_printing_data to do a monitor while on.
 boost::mutex finish_mut;
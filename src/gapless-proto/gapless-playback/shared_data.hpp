@@ -7,6 +7,7 @@
 
 #include <boost/thread.hpp>
 #include "portapara.hpp"
+#include "chunk_pool.hpp"
 #include <queue>
 
 // TODO:
@@ -34,6 +35,10 @@ typedef para::sync_traits<std::queue<void *>, boost::mutex, boost::unique_lock<b
 typedef sync_traits_type::monitor_tuple_type synced_type;
 extern synced_type synced_queue;
 
+//! Where the chunks in synced_queue come from; the sdl callback gives them
+//! back here.  Set up by play().
+extern chunk_pool *chunks;
+
 // TODO:
 //   Prolly get rid of these.  We'll block forever on the playlist queue.
 extern boost::mutex finish_mut;
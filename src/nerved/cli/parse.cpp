@@ -4,6 +4,8 @@
 
 #include "../defines.hpp"
 
+#include <climits>
+#include <cstdlib>
 #include <cstring>
 #include <cstdio>
 
@@ -67,6 +69,21 @@ using cli::cli_parser;
     }\
   }
 
+#define UNSIGNED_OPT(name__, assign__)\
+  else if (current_equal(name__)) {\
+    const char *const v = get_value();\
+    if (v) {\
+      char *end;\
+      const unsigned long n = std::strtoul(v, &end, 10);\
+      if (*v == '\0' || *end != '\0' || n > UINT_MAX) {\
+        arg_value_error(name__, "must be a whole number");\
+      }\
+      else {\
+        s_.assign__ = (unsigned) n;\
+      }\
+    }\
+  }
+
 void cli_parser::parse() {
   for (i_ = 1; i_ < argc_; ++i_) {
     if (current_equal("-help")) {
@@ -84,6 +101,8 @@ void cli_parser::parse() {
     VALUE_OPT("-state", state_)
     VALUE_OPT("-socket", socket_)
     VALUE_OPT("-log", log_)
+    UNSIGNED_OPT("-workers", workers_)
+    UNSIGNED_OPT("-server-threads", server_threads_)
     else {
       arg_error("unrecognised argument");
     }
@@ -92,11 +111,16 @@ void cli_parser::parse() {
   if (s_.config_files().empty()) {
     arg_missing_error("-cfg");
   }
+
+  if (s_.server_threads() == 0) {
+    std::fprintf(stderr, "nerve: -server-threads must be at least 1\n");
+    status_ = cli::parse_fail;
+  }
 }
 
 void cli_parser::help() {
   std::printf(
-    "Usage: nerved -cfg file -state file -socket file [ option ... ]\n"
+    "Usage: nerved -cfg file -state file [ option ... ]\n"
     "The nerve music player daemon.\n"
     "\n"
     "Options:\n"
@@ -111,9 +135,15 @@ void cli_parser::help() {
     "\n"
     "Behavior:\n"
     "  -state FILE      Where to store and load playlist state.\n"
-    "  -socket FILE     Socket to use.\n"
+    "  -socket FILE     Socket to use.  A name starting with @ is in the\n"
+    "                   abstract namespace (Linux only) so there's no file.\n"
+    "                   Default /tmp/nerve.socket.\n"
     "  -log FILE        File to log to or - for stderr.  Some errors are\n"
     "                   always printed on stderr.\n"
+    "  -workers N       Run sections on a pool of N threads instead of one\n"
+    "                   thread per job.  Default 0 (one per job).\n"
+    "  -server-threads N\n"
+    "                   Threads to serve clients on.  Default 1.\n"
     "\n"
   );
   version();
@@ -152,8 +182,9 @@ void cli_parser::arg_error(const char *what) {
   status_ = cli::parse_fail;
 }
 
-void cli_parser::arg_value_error(const char *val, const char *what) {
-  std::fprintf(stderr, "nerve: %s '%s': %s\n", current_arg(), val, what);
+//! After get_value, so the current argument is the value.
+void cli_parser::arg_value_error(const char *option, const char *what) {
+  std::fprintf(stderr, "nerve: %s '%s': %s\n", option, current_arg(), what);
   status_ = cli::parse_fail;
 }
 
@@ -8,6 +8,8 @@ settings::settings() {
   trace_parser_ = trace_lexer_ = false;
   dump_config_ = false;
   state_ = NULL;
-  socket_ = NULL;
+  socket_ = "/tmp/nerve.socket";
   log_ = NULL;
+  workers_ = 0;
+  server_threads_ = 1;
 }
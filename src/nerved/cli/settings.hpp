@@ -40,9 +40,17 @@ namespace cli {
 
     //! File to store player state in.
     const char *state() const { return NERVE_CHECK_PTR(state_); }
+    //! A name starting with "@" is an abstract socket; see
+    //! server::local_server.
     const char *socket() const { return NERVE_CHECK_PTR(socket_); }
     const char *log() const { return NERVE_CHECK_PTR(log_); }
 
+    //! Size of the executor's worker pool, or 0 for one thread per job.
+    unsigned workers() const { return workers_; }
+
+    //! Threads running the server's io_service.  At least 1.
+    unsigned server_threads() const { return server_threads_; }
+
     //@}
 
     private:
@@ -53,6 +61,8 @@ namespace cli {
     const char *state_;
     const char *socket_;
     const char *log_;
+    unsigned workers_;
+    unsigned server_threads_;
   };
 }
 #endif
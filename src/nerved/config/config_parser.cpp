@@ -129,4 +129,5 @@ void config_parser::semantic_pass(config::parse_context &ctx) {
   ch.register_names();
   ch.link_pipeline_order();
   ch.link_jobs_and_check_stage_order();
+  ch.check_job_attributes();
 }
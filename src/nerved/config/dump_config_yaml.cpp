@@ -29,6 +29,31 @@ void thread_yaml(config::pipeline_config &pc) {
   int thread_num = 1;
   for (job_iter_t job = pc.begin(); job != pc.end(); ++job) {
     std::cout << "- thread: " << thread_num << std::endl;
+    const pipeline::thread_attributes &a = job->attributes();
+    if (a.given()) {
+      std::cout << "  attributes:" << std::endl;
+      if (a.cpus().any()) {
+        std::cout << "    cpus: [";
+        const char *sep = "";
+        for (std::size_t c = 0; c < a.cpus().size(); ++c) {
+          if (a.cpus().test(c)) {
+            std::cout << sep << c;
+            sep = ", ";
+          }
+        }
+        std::cout << "]" << std::endl;
+      }
+      std::cout << "    scheduler: " << pipeline::thread_attributes::policy_name(a.policy()) << std::endl;
+      if (a.priority_given()) {
+        std::cout << "    priority: " << a.priority() << std::endl;
+      }
+      if (a.nice_given()) {
+        std::cout << "    nice: " << a.nice() << std::endl;
+      }
+      if (a.stack_size()) {
+        std::cout << "    stack_size: " << a.stack_size() << std::endl;
+      }
+    }
     std::cout << "  sections:" << std::endl;
 
     section_config *sec = job->job_first();
@@ -45,6 +70,13 @@ void thread_yaml(config::pipeline_config &pc) {
 
       std::cout << "    prev: " << from_delim << from << from_delim << std::endl;
       std::cout << "    next: " << to_delim << to << to_delim << std::endl;
+      if (sec->buffer().given()) {
+        const section_config::buffer_config &b = sec->buffer();
+        std::cout << "    buffer:" << std::endl;
+        std::cout << "      capacity: " << b.capacity << std::endl;
+        std::cout << "      high_mark: " << b.high_mark << std::endl;
+        std::cout << "      low_mark: " << b.low_mark << std::endl;
+      }
       std::cout << "    sequences:" << std::endl;
 
       stage_config::category_type last_cat = stage_cat::unset;
@@ -32,17 +32,25 @@ namespace config {
     void report() { error_ = true;  }
     void report_fatal() { fatal_error_ = true; }
 
-#define NERVE_ERROR_REPORTER_REPORT(member__, loc__)\
-      member__ = true;\
+#define NERVE_ERROR_REPORTER_WRITE(cat__, loc__)\
       va_list args;\
       va_start(args, format);\
-      write_report(loc__, format, args);\
+      write_report(cat__, loc__, format, args);\
       va_end(args);
 
+#define NERVE_ERROR_REPORTER_REPORT(member__, loc__)\
+      member__ = true;\
+      NERVE_ERROR_REPORTER_WRITE(output::cat::error, loc__);
+
     void lreport(const parse_location &l, const char *format, ...) {
       NERVE_ERROR_REPORTER_REPORT(error_, l);
     }
 
+    //! Doesn't make the config fail.
+    void lwarn(const parse_location &l, const char *format, ...) {
+      NERVE_ERROR_REPORTER_WRITE(output::cat::warn, l);
+    }
+
     void report(const char *format, ...) {
       NERVE_ERROR_REPORTER_REPORT(error_, this->location());
     }
@@ -61,8 +69,8 @@ namespace config {
 
     private:
 
-    void write_report(const parse_location &loc, const char *format, va_list args) {
-      output::message m(output::source::config, output::cat::error);
+    void write_report(output::cat_type cat, const parse_location &loc, const char *format, va_list args) {
+      output::message m(output::source::config, cat);
       m.printf("%s:%d: ", loc.file(), loc.line());
       m.vprintf(format, args);
       m.printf("\n");
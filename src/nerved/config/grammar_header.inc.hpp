@@ -12,6 +12,7 @@
 #include "parse_context.hpp"
 #include "pipeline_configs.hpp"
 #include "../util/asserts.hpp"
+#include "../util/pooled.hpp"
 
 #include <iostream>
 #include <cstdlib>
@@ -39,6 +40,19 @@ typedef config::flex_interface::transfer_mem flex_mem;
 
 template<class T> void use_variable(const T &) {}
 
+//! "a,b" in memory which free_text frees.  Takes ownership of both.
+static char *join_list(char *a, char *b) {
+  flex_mem first(a);
+  flex_mem second(b);
+  const std::size_t a_length = std::strlen(a);
+  const std::size_t b_length = std::strlen(b);
+  char *const joined = (char *) pooled::tracked_byte_alloc(a_length + b_length + 2);
+  std::memcpy(joined, a, a_length);
+  joined[a_length] = ',';
+  std::memcpy(joined + a_length + 1, b, b_length + 1);
+  return joined;
+}
+
 /***************
  * Error state *
  ***************/
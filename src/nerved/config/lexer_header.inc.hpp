@@ -74,6 +74,12 @@ static ::config::flex_interface::context_type *context;
 static bool enable_trace = false;
 inline bool trace() { return enable_trace; }
 
+static int brace_depth = 0;
+//! Brace depth just inside the current thread block, or zero outside one.
+static int job_depth = 0;
+//! The next brace opens a thread block.
+static bool thread_key_seen = false;
+
 /****************
  * Exported API *
  ****************/
@@ -87,6 +93,9 @@ namespace fi = ::config::flex_interface;
 void fi::init(const config::flex_interface::params &p) {
   context = NERVE_CHECK_PTR(p.context());
   enable_trace = p.trace();
+  brace_depth = 0;
+  job_depth = 0;
+  thread_key_seen = false;
   // only necessary for checking the regex themselves
   ::yyset_debug(0);
   ::yyset_in(NERVE_CHECK_PTR(p.stream()));
@@ -154,3 +163,41 @@ static void string_assign_token_text() {
 }
 
 static void identifier_assign_token_text() { assign_token_text(yytext, yyleng + 1); }
+
+/*****************
+ * Thread blocks *
+ *****************/
+
+// The thread attribute keywords are only lexed directly inside a thread block
+// (the JOB state).  Everywhere else they're identifiers.
+
+//! JOB or INITIAL, for after a brace or a string.  Defined in the lexer
+//! because the states aren't made yet.
+static int outer_state();
+
+static bool in_job() { return job_depth != 0 && brace_depth == job_depth; }
+
+static void thread_key() {
+  // Threads are only at the top; the parser complains about any others.
+  thread_key_seen = brace_depth == 0;
+}
+
+static void open_brace() {
+  ++brace_depth;
+  if (thread_key_seen) {
+    job_depth = brace_depth;
+    thread_key_seen = false;
+  }
+}
+
+static void close_brace() {
+  // Likewise for too many of these.
+  if (brace_depth == 0) {
+    return;
+  }
+
+  if (brace_depth == job_depth) {
+    job_depth = 0;
+  }
+  --brace_depth;
+}
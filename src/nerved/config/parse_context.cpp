@@ -5,11 +5,17 @@
 #include "parse_context.hpp"
 #include "pipeline_configs.hpp"
 
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
 using config::parse_context;
 
 void parse_context::new_job() {
   current.reset();
   current.job = NERVE_CHECK_PTR(output_.new_job());
+  current.job->location_start(this->current_location());
 }
 
 void parse_context::new_section() {
@@ -95,3 +101,86 @@ void parse_context::add_stage(char *text) {
   }
 }
 
+
+void parse_context::parse_size(std::size_t &out, const char *text) {
+  char *end = NULL;
+  errno = 0;
+  const unsigned long v = std::strtoul(NERVE_CHECK_PTR(text), &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || *text == '-' || v == 0) {
+    this->reporter().report("%s: expected a positive number", text);
+  }
+  else {
+    out = v;
+  }
+}
+
+bool parse_context::parse_int(int &out, const char *text) {
+  char *end = NULL;
+  errno = 0;
+  const long v = std::strtol(NERVE_CHECK_PTR(text), &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || v < INT_MIN || v > INT_MAX) {
+    this->reporter().report("%s: expected a whole number", text);
+    return false;
+  }
+  out = (int) v;
+  return true;
+}
+
+void parse_context::parse_cpus(pipeline::thread_attributes::cpu_set_type &out, const char *text) {
+  typedef pipeline::thread_attributes::cpu_set_type cpu_set_type;
+  const unsigned long max = pipeline::thread_attributes::max_cpus;
+
+  // Parse into a copy so an error doesn't leave half a set.
+  cpu_set_type cpus;
+  const char *p = NERVE_CHECK_PTR(text);
+  for (;;) {
+    char *end = NULL;
+    const unsigned long first = std::strtoul(p, &end, 10);
+    if (end == p || *p == '-' || first >= max) {
+      break;
+    }
+
+    unsigned long last = first;
+    p = end;
+    if (*p == '-') {
+      const char *const range = p + 1;
+      last = std::strtoul(range, &end, 10);
+      if (end == range || *range == '-' || last >= max || last < first) {
+        break;
+      }
+      p = end;
+    }
+
+    for (unsigned long c = first; c <= last; ++c) {
+      cpus.set(c);
+    }
+
+    if (*p == '\0') {
+      out = cpus;
+      return;
+    }
+    else if (*p != ',') {
+      break;
+    }
+    ++p;
+  }
+
+  this->reporter().report(
+    "%s: expected CPU numbers below %lu and ranges separated by commas, e.g \"0,2-3\"", text, max
+  );
+}
+
+void parse_context::parse_policy(pipeline::thread_attributes &out, const char *text) {
+  if (std::strcmp(NERVE_CHECK_PTR(text), "fifo") == 0) {
+    out.policy(pipeline::thread_attributes::policy::fifo);
+  }
+  else if (std::strcmp(text, "rr") == 0) {
+    out.policy(pipeline::thread_attributes::policy::rr);
+  }
+  else if (std::strcmp(text, "other") == 0) {
+    out.policy(pipeline::thread_attributes::policy::other);
+  }
+  else {
+    this->reporter().report("%s: expected 'fifo', 'rr', or 'other'", text);
+  }
+}
@@ -6,9 +6,11 @@
 
 #include "error_reporter.hpp"
 
+#include "../pipeline/thread_attributes.hpp"
 #include "../util/asserts.hpp"
 
 #include <boost/utility.hpp>
+#include <cstddef>
 
 namespace config {
   class pipeline_config;
@@ -75,6 +77,23 @@ namespace config {
 
     //@}
 
+    //! \name Values
+    //@{
+
+    //! Convert a positive number or report an error and leave +out+ alone.
+    void parse_size(std::size_t &out, const char *text);
+
+    //! Convert any whole number.  Returns false and reports if it isn't one.
+    bool parse_int(int &out, const char *text);
+
+    //! A list of CPU numbers and ranges like "0,2-3".
+    void parse_cpus(pipeline::thread_attributes::cpu_set_type &out, const char *text);
+
+    //! "fifo", "rr", or "other".
+    void parse_policy(pipeline::thread_attributes &out, const char *text);
+
+    //@}
+
     private:
 
     pipeline_config &output_;
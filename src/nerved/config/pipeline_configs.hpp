@@ -16,6 +16,7 @@
 #include "parse_location.hpp"
 #include "flex_interface.hpp"
 #include "../stages/stage_data.hpp"
+#include "../pipeline/thread_attributes.hpp"
 
 #include "../util/c_string.hpp"
 #include "../util/asserts.hpp"
@@ -153,6 +154,18 @@ class section_config : boost::noncopyable {
   typedef pooled::container<stage_config::create_type>::vector stages_type;
   typedef boost::indirect_iterator<stages_type::iterator> stage_iterator_type;
 
+  //! Sizes of the thread pipe which this section writes to.  Zero means not
+  //! given, in which case the pipe's defaults are used.
+  struct buffer_config {
+    buffer_config() : capacity(0), high_mark(0), low_mark(0) {}
+
+    bool given() const { return capacity || high_mark || low_mark; }
+
+    std::size_t capacity;
+    std::size_t high_mark;
+    std::size_t low_mark;
+  };
+
   //! \name Resources
   //@{
 
@@ -206,6 +219,10 @@ class section_config : boost::noncopyable {
   job_config &parent_job() { return *NERVE_CHECK_PTR(parent_job_); }
   void parent_job(job_config *p) { parent_job_ = NERVE_CHECK_PTR(p); }
 
+  //! Output buffer of this section.
+  buffer_config &buffer() { return buffer_; }
+  const buffer_config &buffer() const { return buffer_; }
+
   //@}
 
   //! \name Ordering
@@ -243,6 +260,8 @@ class section_config : boost::noncopyable {
   flex_interface::unique_ptr name_;
   flex_interface::unique_ptr next_name_;
 
+  buffer_config buffer_;
+
   parse_location location_next_;
   parse_location location_start_;
 
@@ -292,6 +311,14 @@ class job_config : boost::noncopyable {
   section_iterator_type begin() { return make_deref_iter(sections_.begin()); }
   section_iterator_type end() { return make_deref_iter(sections_.end()); }
 
+  //! How the thread is scheduled.
+  pipeline::thread_attributes &attributes() { return attributes_; }
+  const pipeline::thread_attributes &attributes() const { return attributes_; }
+
+  //! Location of the start of the thread.
+  const parse_location &location_start() { return location_start_; }
+  void location_start(const parse_location &copy) { location_start_ = copy; }
+
   //! The first section in this thread in pipeline order.
   void job_first(section_config *s) { job_first_ = NERVE_CHECK_PTR(s); }
   section_config *job_first()  { return job_first_; }
@@ -309,6 +336,8 @@ class job_config : boost::noncopyable {
 
   private:
   sections_type sections_;
+  pipeline::thread_attributes attributes_;
+  parse_location location_start_;
   section_config *job_first_;
   section_config *job_last_;
   pipeline::job *configured_job_;
@@ -3,10 +3,18 @@
 
 #include "semantic_checker.hpp"
 
+#include "../para/pipes.hpp"
 #include "../util/asserts.hpp"
 
 using namespace config;
 
+namespace {
+  //! A mono-section config doesn't need names.
+  const char *display_name(const section_config *sec) {
+    return sec->name() ? sec->name() : "(unnamed)";
+  }
+}
+
 /***************
  * Preparation *
  ***************/
@@ -48,6 +56,7 @@ void semantic_checker::link_pipeline_order() {
       NERVE_ASSERT(! sec->stages().empty(), "there must always be stages in a section");
 
       section_config *const sp = &(*sec);
+      check_section_buffer(sp);
       if (check_section_next_name(sp)) {
         link_sections(jp, sp);
 
@@ -133,6 +142,32 @@ bool semantic_checker::check_section_next_name(section_config *const sec) {
   }
 }
 
+void semantic_checker::check_section_buffer(section_config *const sec) {
+  const section_config::buffer_config &b = sec->buffer();
+  if (! b.given()) {
+    return;
+  }
+
+  if (sec->next_name() == NULL) {
+    rep.lreport(
+      sec->location_start(),
+      "section %s has no 'next' so it has no buffer to configure",
+      display_name(sec)
+    );
+    return;
+  }
+
+  const para::pipe_limits l(b.capacity, b.high_mark, b.low_mark);
+  if (! l.valid()) {
+    rep.lreport(
+      sec->location_start(),
+      "section %s's buffer must satisfy low_mark (%lu) < high_mark (%lu) <= buffer (%lu)",
+      display_name(sec),
+      (unsigned long) l.low(), (unsigned long) l.high(), (unsigned long) l.capacity()
+    );
+  }
+}
+
 void semantic_checker::link_sections(job_config *const job, section_config *const sec) {
   string_type next_name(NERVE_CHECK_PTR(sec->next_name()));
   if (names.count(next_name)) {
@@ -255,3 +290,59 @@ void semantic_checker::assign_configure_block(stage_config &st) {
     st.configs(block);
   }
 }
+
+/***********
+ * Threads *
+ ***********/
+
+void semantic_checker::check_job_attributes() {
+  typedef pipeline::thread_attributes attributes;
+
+  for (job_iter_t job = confs.begin(); job != confs.end(); ++job) {
+    const attributes &a = job->attributes();
+    const parse_location &loc = job->location_start();
+
+    const std::size_t num_cpus = attributes::cpus_available();
+    if (num_cpus) {
+      for (std::size_t c = num_cpus; c < attributes::max_cpus; ++c) {
+        if (a.cpus().test(c)) {
+          rep.lreport(loc, "thread's cpus includes %lu but there are only %lu CPUs", (unsigned long) c, (unsigned long) num_cpus);
+          break;
+        }
+      }
+    }
+
+    const bool realtime = a.policy() == attributes::policy::fifo || a.policy() == attributes::policy::rr;
+    if (a.priority_given()) {
+      if (! realtime) {
+        rep.lreport(loc, "thread's 'priority' needs 'scheduler' to be 'fifo' or 'rr'");
+      }
+      else {
+        const int lo = attributes::min_priority(a.policy());
+        const int hi = attributes::max_priority(a.policy());
+        if (a.priority() < lo || a.priority() > hi) {
+          rep.lreport(
+            loc, "thread's 'priority' (%d) must be between %d and %d for the %s scheduler",
+            a.priority(), lo, hi, attributes::policy_name(a.policy())
+          );
+        }
+      }
+    }
+
+    if (a.nice_given()) {
+      if (a.nice() < -20 || a.nice() > 19) {
+        rep.lreport(loc, "thread's 'nice' (%d) must be between -20 and 19", a.nice());
+      }
+      else if (realtime) {
+        rep.lwarn(loc, "thread's 'nice' has no effect with the %s scheduler", attributes::policy_name(a.policy()));
+      }
+    }
+
+    if (a.stack_size() && a.stack_size() < attributes::min_stack_size()) {
+      rep.lreport(
+        loc, "thread's 'stack_size' (%lu) must be at least %lu",
+        (unsigned long) a.stack_size(), (unsigned long) attributes::min_stack_size()
+      );
+    }
+  }
+}
@@ -61,11 +61,17 @@ namespace config {
      */
     void link_jobs_and_check_stage_order();
 
+    //! Check the thread scheduling attributes are possible here.
+    void check_job_attributes();
+
     private:
 
     //! If false then don't validate more of the section after.
     bool check_section_next_name(section_config *const sec);
 
+    //! Check the thread pipe sizes make sense.
+    void check_section_buffer(section_config *const sec);
+
     //! Establish a linked list based on the next_name and the name lookup table.
     void link_sections(job_config *const job, section_config *const sec);
 
@@ -9,6 +9,8 @@
  * Parameters:
  *
  * - NERVED_CONFIG -- a file to include which might define other stuff.
+ * - NERVED_LOCKING_PIPES -- use the mutex/deque thread pipes instead of the
+ *   lock-free rings (mostly useful for comparison).
  *
  * Defines:
  *
@@ -31,6 +33,10 @@
 #  error "NERVED_VERSION must be defined"
 #endif
 
+#ifndef NERVED_LOCKING_PIPES
+#  define NERVED_LOCKING_PIPES 0
+#endif
+
 #ifndef NERVED_CRASH_DETECTOR
 #  define NERVED_CRASH_DETECTOR NERVE_DEVELOPER
 #endif
@@ -13,7 +13,10 @@
 
 #include "syncs.hpp"
 #include "monitors.hpp"
+#include "rings.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <deque>
 #include <boost/bind.hpp>
 
@@ -26,17 +29,69 @@ namespace para {
     struct queue { typedef std::deque<T> type; };
   };
 
+  //! \ingroup grp_pipes
+  //! Bounded lock-free queue.  Only valid with a parking_sync.
+  struct ring_queue_selector {
+    template<class T>
+    struct queue { typedef spsc_ring<T> type; };
+  };
+
+  //! \ingroup grp_pipes
+  //! Default handler for values which are thrown away by a clear.  Give
+  //! something else if the values own resources.
+  struct ignore_discarded {
+    template<class T>
+    void operator()(const T &) const {}
+  };
+
+  /*!
+   * \ingroup grp_pipes
+   *
+   * Size and hysteresis of a pipe.  A writer which fills the pipe to the high
+   * mark is not woken until the reader has drained it to the low mark, so there
+   * is one wake-up per (high - low) packets instead of one per packet.
+   *
+   * Values which are not given (i.e zero) are derived: the capacity defaults to
+   * default_capacity (or the high mark if that's bigger), the high mark to the
+   * capacity, and the low mark to half of the high mark.
+   */
+  class pipe_limits {
+    public:
+    typedef std::size_t size_type;
+
+    static const size_type default_capacity = 10;
+
+    explicit pipe_limits(size_type capacity = 0, size_type high = 0, size_type low = 0)
+    : capacity_(capacity ? capacity : (high > default_capacity ? high : default_capacity)),
+      high_(high ? high : capacity_),
+      low_(low ? low : high_ / 2)
+    {}
+
+    size_type capacity() const { return capacity_; }
+    size_type high() const { return high_; }
+    size_type low() const { return low_; }
+
+    //! Only a valid limit can be given to a pipe.
+    bool valid() const { return high_ > 0 && high_ <= capacity_ && low_ < high_; }
+
+    private:
+    size_type capacity_;
+    size_type high_;
+    size_type low_;
+  };
+
   // TODO: should pass a pipe_types with function types and so on
 
   //! \ingroup grp_pipes
-  //! A thread-safe non-iterable queue.
-  template<class T, class MonitorSync, class QueueSelector = simple_queue_selector>
+  //! A thread-safe non-iterable queue.  Discard is called on every value which
+  //! a clear throws away.
+  template<class T, class MonitorSync, class QueueSelector = simple_queue_selector, class Discard = ignore_discarded>
   class pipe {
     private:
     typedef typename QueueSelector::template queue<T>::type queue_type;
     typedef MonitorSync sync_type;
-    typedef para::monitor<sync_type> monitor_type;
-    typedef pipe<T,MonitorSync,QueueSelector> self_type;
+    typedef typename sync_type::scoped_lock_type lock_type;
+    typedef pipe<T,MonitorSync,QueueSelector,Discard> self_type;
 
     public:
     typedef typename queue_type::value_type value_type;
@@ -54,7 +109,8 @@ namespace para {
     static mover move(pipe<T> &p) { return mover(p.sync_, p.queue_); }
     */
 
-    pipe() {}
+    pipe() : throttled_(false), has_priority_(false) {}
+    explicit pipe(const pipe_limits &l) : limits_(l), throttled_(false), has_priority_(false) {}
 
     /*
     pipe(mover &m)
@@ -62,41 +118,419 @@ namespace para {
     { }
     */
 
-    //! Pop from the front of the queue.
+    //! Change the size.  Not thread-safe; do it before the pipe is used.
+    void limits(const pipe_limits &l) { limits_ = l; }
+    const pipe_limits &limits() const { return limits_; }
+
+    //! The most values it will hold.
+    pipe_limits::size_type capacity() const { return limits_.capacity(); }
+
+    // This doesn't use a monitor because the monitor notifies on every
+    // operation and the point of the marks is that we don't.
+
+    //! Pop from the front of the queue.  A priority value comes first.
     value_type read() {
-      monitor_type m(sync_, boost::bind(&self_type::read_pred, this));
-      value_type ret = queue_.front();
-      queue_.pop_front();
+      lock_type lock(sync_.lockable());
+      while (! read_pred()) {
+        sync_.waitable().wait(lock);
+      }
+
+      value_type ret;
+      pop(ret);
+      wake_writer();
       return ret;
     }
 
+    //! Pop at least one and at most max values into out.  Only waits if the
+    //! queue is empty.  Returns the number popped.
+    template<class OutputIterator>
+    std::size_t read_batch(OutputIterator out, std::size_t max) {
+      lock_type lock(sync_.lockable());
+      while (! read_pred()) {
+        sync_.waitable().wait(lock);
+      }
+
+      std::size_t n = 0;
+      value_type v;
+      while (n < max && pop(v)) {
+        *out++ = v;
+        ++n;
+      }
+
+      wake_writer();
+      return n;
+    }
+
+    //! Would a read return without waiting?
+    bool readable() {
+      lock_type lock(sync_.lockable());
+      return read_pred();
+    }
+
+    //! Would writing n values return without waiting?
+    bool writable(std::size_t n) {
+      lock_type lock(sync_.lockable());
+      return write_pred() && queue_.size() + n <= limits_.high();
+    }
+
+    //! Take the priority value if there is one.  Costs one atomic load (and
+    //! no lock) if there isn't.
+    bool try_read_priority(reference_type out) {
+      if (! has_priority_.load(boost::memory_order_acquire)) {
+        return false;
+      }
+
+      lock_type lock(sync_.lockable());
+      if (! has_priority_.load(boost::memory_order_relaxed)) {
+        return false;
+      }
+
+      out = priority_;
+      has_priority_.store(false, boost::memory_order_relaxed);
+      return true;
+    }
+
     //! Flush the pipe.
     void clear() {
-      monitor_type m(sync_, boost::bind(&self_type::write_pred, this));
+      lock_type lock(sync_.lockable());
+      std::for_each(queue_.begin(), queue_.end(), discard_);
       queue_.clear();
+      throttled_ = false;
+      sync_.waitable().notify_all();
     }
 
     //! Push onto the pipe.
     void write(const reference_type copy) {
-      monitor_type m(sync_, boost::bind(&self_type::write_pred, this));
-      queue_.push_back(copy);
+      lock_type lock(sync_.lockable());
+      while (! write_pred()) {
+        sync_.waitable().wait(lock);
+      }
+      push(copy);
+    }
+
+    //! Push a range in one lock.  The lock is only given up if the high mark
+    //! is reached part way through.
+    template<class InputIterator>
+    void write_batch(InputIterator first, InputIterator last) {
+      lock_type lock(sync_.lockable());
+      for (; first != last; ++first) {
+        while (! write_pred()) {
+          sync_.waitable().wait(lock);
+        }
+        push(*first);
+      }
     }
 
     //! Replace the queue's contents with the new data.
     void write_clear(const reference_type copy) {
-      typedef typename sync_type::scoped_lock_type lock_type;
       lock_type lock(sync_.lockable());
+      std::for_each(queue_.begin(), queue_.end(), discard_);
+      queue_.clear();
+      throttled_ = false;
+      push(copy);
+    }
+
+    //! Throw away the queue's contents and put the value in the one-slot
+    //! priority lane, where it's read before anything else.  A priority
+    //! value which was never read is discarded.
+    void write_priority(const reference_type copy) {
+      lock_type lock(sync_.lockable());
+      std::for_each(queue_.begin(), queue_.end(), discard_);
       queue_.clear();
+      throttled_ = false;
+
+      if (has_priority_.load(boost::memory_order_relaxed)) {
+        discard_(priority_);
+      }
+      priority_ = copy;
+      has_priority_.store(true, boost::memory_order_release);
+      sync_.waitable().notify_all();
+    }
+
+    bool read_pred() const { return has_priority_.load(boost::memory_order_relaxed) || ! queue_.empty(); }
+    bool write_pred() const { return ! throttled_; }
+
+    private:
+    // Lock must be held.  Priority first.
+    bool pop(value_type &out) {
+      if (has_priority_.load(boost::memory_order_relaxed)) {
+        out = priority_;
+        has_priority_.store(false, boost::memory_order_relaxed);
+        return true;
+      }
+      else if (queue_.empty()) {
+        return false;
+      }
+
+      out = queue_.front();
+      queue_.pop_front();
+      return true;
+    }
+
+    // Lock must be held.
+    void wake_writer() {
+      if (throttled_ && queue_.size() <= limits_.low()) {
+        throttled_ = false;
+        sync_.waitable().notify_all();
+      }
+    }
+
+    // Lock must be held.
+    void push(const reference_type copy) {
+      const bool was_empty = queue_.empty();
       queue_.push_back(copy);
-      sync_.waitable().notify_one();
+      if (queue_.size() >= limits_.high()) {
+        throttled_ = true;
+      }
+
+      // Only a reader can be waiting on an empty queue.
+      if (was_empty) {
+        sync_.waitable().notify_all();
+      }
     }
 
-    bool read_pred() const { return ! queue_.empty(); }
-    bool write_pred() const { return queue_.size() < 10; }
+    sync_type  sync_;
+    queue_type queue_;
+    pipe_limits limits_;
+    bool throttled_;
+    Discard discard_;
 
+    value_type priority_;
+    // Atomic so that try_read_priority can check it without the lock.
+    boost::atomic<bool> has_priority_;
+  };
+
+  /*!
+   * \ingroup grp_pipes
+   *
+   * Single-producer, single-consumer pipe.  Selected by using a parking_sync.
+   * Nothing is locked unless the ring is empty on read or full on write, in
+   * which case the thread parks on the sync's condition.
+   *
+   * The queue selector must give a ring (try_push, try_pop, and the read and
+   * write indices).  Clearing is done by the producer recording a cut index;
+   * the consumer discards anything before it, so Discard is called by the
+   * consumer.
+   *
+   * The writer always wakes a parked reader, but the reader only wakes the
+   * writer once the ring has drained to the low mark.
+   */
+  template<class T, class Waitable, class Lockable, class ScopedLock, class QueueSelector, class Discard>
+  class pipe<T, parking_sync<Waitable, Lockable, ScopedLock>, QueueSelector, Discard> {
     private:
+    typedef typename QueueSelector::template queue<T>::type queue_type;
+    typedef parking_sync<Waitable, Lockable, ScopedLock> sync_type;
+    typedef pipe<T, sync_type, QueueSelector, Discard> self_type;
+    typedef typename queue_type::size_type index_type;
+
+    public:
+    typedef typename queue_type::value_type value_type;
+    typedef typename queue_type::reference reference_type;
+
+    pipe() : cut_(0), throttled_(false), held_(false), priority_(value_type()) { queue_.reserve(limits_.capacity()); }
+    explicit pipe(const pipe_limits &l) : cut_(0), throttled_(false), held_(false), priority_(value_type()) { this->limits(l); }
+
+    //! Change the size.  Not thread-safe; do it before the pipe is used.
+    void limits(const pipe_limits &l) {
+      limits_ = l;
+      queue_.reserve(l.capacity());
+    }
+
+    const pipe_limits &limits() const { return limits_; }
+
+    //! The most values it will hold, which is the ring's rounded up size.
+    index_type capacity() const { return queue_.capacity(); }
+
+    //! Pop from the front of the queue.  A priority value comes first.
+    //! Consumer only.
+    value_type read() {
+      value_type ret;
+      next(ret, true);
+
+      // A writer might be waiting for the low mark.
+      if (queue_.size() <= limits_.low()) {
+        sync_.unpark();
+      }
+      return ret;
+    }
+
+    //! Pop at least one and at most max values into out.  Consumer only.  The
+    //! writer is woken at most once per batch.
+    template<class OutputIterator>
+    std::size_t read_batch(OutputIterator out, std::size_t max) {
+      std::size_t n = 0;
+      value_type v;
+      while (n < max && next(v, n == 0)) {
+        *out++ = v;
+        ++n;
+      }
+
+      if (queue_.size() <= limits_.low()) {
+        sync_.unpark();
+      }
+      return n;
+    }
+
+    //! Would a read return without waiting?  Consumer only.
+    bool readable() const { return held_ || read_pred(); }
+
+    //! Would writing n values return without parking?  Producer only.  The
+    //! size can only shrink under us so this is never wrongly true.
+    bool writable(std::size_t n) const {
+      return (! throttled_ || drained_pred()) && queue_.size() + n <= limits_.high();
+    }
+
+    //! Take the priority value if there is one.  Consumer only.  Costs a
+    //! single atomic load if there isn't.
+    bool try_read_priority(reference_type out) {
+      const value_type p = take_priority();
+      if (p == value_type()) {
+        return false;
+      }
+      out = p;
+      return true;
+    }
+
+    //! Flush the pipe.  Producer only.
+    void clear() {
+      cut_.store(queue_.write_index(), boost::memory_order_release);
+    }
+
+    //! Push onto the pipe.  Producer only.
+    void write(const reference_type copy) {
+      if (throttled_) {
+        sync_.park(boost::bind(&self_type::drained_pred, this));
+        throttled_ = false;
+      }
+
+      while (! queue_.try_push(copy)) {
+        sync_.park(boost::bind(&self_type::write_pred, this));
+      }
+      sync_.unpark();
+
+      if (queue_.size() >= limits_.high()) {
+        throttled_ = true;
+      }
+    }
+
+    //! Push a range.  Producer only.  The reader is woken once at the end
+    //! unless the writer has to park part way through.
+    template<class InputIterator>
+    void write_batch(InputIterator first, InputIterator last) {
+      for (; first != last; ++first) {
+        if (throttled_) {
+          sync_.unpark();
+          sync_.park(boost::bind(&self_type::drained_pred, this));
+          throttled_ = false;
+        }
+
+        while (! queue_.try_push(*first)) {
+          sync_.unpark();
+          sync_.park(boost::bind(&self_type::write_pred, this));
+        }
+
+        if (queue_.size() >= limits_.high()) {
+          throttled_ = true;
+        }
+      }
+      sync_.unpark();
+    }
+
+    //! Replace the queue's contents with the new data.  Producer only.
+    void write_clear(const reference_type copy) {
+      // The consumer sees the cut no later than it sees the new data.
+      cut_.store(queue_.write_index(), boost::memory_order_relaxed);
+      // Whatever we were waiting to drain is being thrown away.
+      throttled_ = false;
+      this->write(copy);
+    }
+
+    //! Cut the queue and put the value in the one-slot priority lane, where
+    //! the reader finds it before anything else without waiting behind the
+    //! queue.  A priority value which was never read is discarded (by the
+    //! producer, so Discard must be safe to call from either side).  The lane
+    //! uses value_type() to mean empty so that can't be written.  Producer
+    //! only.
+    void write_priority(const reference_type copy) {
+      // The lane's release publishes the cut.
+      cut_.store(queue_.write_index(), boost::memory_order_relaxed);
+      throttled_ = false;
+
+      const value_type old = priority_.exchange(copy, boost::memory_order_acq_rel);
+      if (old != value_type()) {
+        discard_(old);
+      }
+      sync_.unpark();
+    }
+
+    bool read_pred() const { return priority_pending() || ! queue_.empty(); }
+    bool write_pred() const { return ! queue_.full(); }
+    bool drained_pred() const { return queue_.size() <= limits_.low(); }
+
+    private:
+    bool priority_pending() const { return priority_.load(boost::memory_order_relaxed) != value_type(); }
+
+    value_type take_priority() {
+      if (! priority_pending()) {
+        return value_type();
+      }
+      return priority_.exchange(value_type(), boost::memory_order_acquire);
+    }
+
+    // Consumer only.  The next value in order; false if there's nothing and
+    // we may not wait.
+    //
+    // A popped value is held for one more look at the lane before it's
+    // returned.  The pop acquires everything written before the value, so a
+    // priority write which should come first is always seen and the held
+    // value goes after it (or is cut).
+    bool next(value_type &out, bool wait) {
+      for (;;) {
+        const value_type p = take_priority();
+        if (p != value_type()) {
+          out = p;
+          return true;
+        }
+
+        if (! held_) {
+          held_index_ = queue_.read_index();
+          if (queue_.try_pop(held_value_)) {
+            held_ = true;
+            continue;
+          }
+          else if (! wait) {
+            return false;
+          }
+
+          // Anything discarded by a cut might be what the writer waits for.
+          sync_.unpark();
+          sync_.park(boost::bind(&self_type::read_pred, this));
+          continue;
+        }
+
+        held_ = false;
+        if (held_index_ >= cut_.load(boost::memory_order_acquire)) {
+          out = held_value_;
+          return true;
+        }
+        discard_(held_value_);
+      }
+    }
+
     sync_type  sync_;
     queue_type queue_;
+    pipe_limits limits_;
+    boost::atomic<index_type> cut_;
+    // Only touched by the producer.
+    bool throttled_;
+    Discard discard_;
+
+    // Only touched by the consumer.
+    bool held_;
+    index_type held_index_;
+    value_type held_value_;
+
+    boost::atomic<value_type> priority_;
   };
 
   /*
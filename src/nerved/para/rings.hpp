@@ -0,0 +1,263 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+/*!
+ * \file
+ * \ingroup grp_pipes
+ *
+ * Bounded lock-free queues.
+ */
+
+#ifndef PARA_RINGS_HPP_q0wbd7kx
+#define PARA_RINGS_HPP_q0wbd7kx
+
+#include <boost/atomic.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace para {
+  //! \ingroup grp_pipes
+  //! Assumed size of a cache line.  Too big only wastes a little memory; too
+  //! small means the reader and writer fight over the same line.
+  static const std::size_t cache_line_size = 64;
+
+  /*!
+   * \ingroup grp_pipes
+   *
+   * Bounded single-producer, single-consumer ring buffer.  Exactly one thread
+   * may call the producer methods (try_push) and exactly one thread may call the
+   * consumer methods (try_pop, read_index) at any one time.  Anything else is
+   * only an estimate.
+   *
+   * The indices are free-running counters and the capacity is always a power of
+   * two so the slot is found with a mask.  Each side keeps a cached copy of the
+   * other side's index so that the shared cache line is only read when the ring
+   * looks full (or empty).
+   */
+  template<class T>
+  class spsc_ring : boost::noncopyable {
+    public:
+    typedef T value_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+
+    //! The capacity is rounded up to the next power of two.
+    explicit spsc_ring(size_type capacity = 16) { this->reserve(capacity); }
+
+    //! Reallocate the storage.  This is not thread-safe at all and anything in
+    //! the ring is lost.
+    void reserve(size_type capacity) {
+      size_type real = 1;
+      while (real < capacity) {
+        real <<= 1;
+      }
+
+      buffer_.assign(real, value_type());
+      mask_ = real - 1;
+      producer_.tail.store(0, boost::memory_order_relaxed);
+      producer_.cached_head = 0;
+      consumer_.head.store(0, boost::memory_order_relaxed);
+      consumer_.cached_tail = 0;
+    }
+
+    //! \name Producer side
+    //@{
+
+    //! Returns false if the ring is full.
+    bool try_push(const_reference v) {
+      const size_type t = producer_.tail.load(boost::memory_order_relaxed);
+      if (t - producer_.cached_head > mask_) {
+        producer_.cached_head = consumer_.head.load(boost::memory_order_acquire);
+        if (t - producer_.cached_head > mask_) {
+          return false;
+        }
+      }
+
+      buffer_[t & mask_] = v;
+      producer_.tail.store(t + 1, boost::memory_order_release);
+      return true;
+    }
+
+    //! Index which the next push will go to.
+    size_type write_index() const { return producer_.tail.load(boost::memory_order_relaxed); }
+
+    //@}
+
+    //! \name Consumer side
+    //@{
+
+    //! Returns false if the ring is empty.
+    bool try_pop(reference out) {
+      const size_type h = consumer_.head.load(boost::memory_order_relaxed);
+      if (h == consumer_.cached_tail) {
+        consumer_.cached_tail = producer_.tail.load(boost::memory_order_acquire);
+        if (h == consumer_.cached_tail) {
+          return false;
+        }
+      }
+
+      out = buffer_[h & mask_];
+      consumer_.head.store(h + 1, boost::memory_order_release);
+      return true;
+    }
+
+    //! Index which the next pop will come from.
+    size_type read_index() const { return consumer_.head.load(boost::memory_order_relaxed); }
+
+    //@}
+
+    //! \name Estimates
+    //! Exact when called from a side whose partner is not running.
+    //@{
+
+    size_type size() const {
+      return
+        producer_.tail.load(boost::memory_order_acquire) -
+        consumer_.head.load(boost::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() > mask_; }
+    size_type capacity() const { return mask_ + 1; }
+
+    //@}
+
+    private:
+    struct producer_side {
+      boost::atomic<size_type> tail;
+      size_type cached_head;
+    };
+
+    struct consumer_side {
+      boost::atomic<size_type> head;
+      size_type cached_tail;
+    };
+
+    // The leading pad keeps whatever was allocated before us off the producer's
+    // line.
+    char pad0_[cache_line_size];
+    producer_side producer_;
+    char pad1_[cache_line_size - sizeof(producer_side)];
+    consumer_side consumer_;
+    char pad2_[cache_line_size - sizeof(consumer_side)];
+
+    size_type mask_;
+    std::vector<value_type> buffer_;
+  };
+
+  /*!
+   * \ingroup grp_pipes
+   *
+   * Single-producer, single-consumer ring of bytes which are written and read
+   * in bulk.  Same rules as the spsc_ring, but every operation is also
+   * wait-free: there's no lock, no allocation and no loop other than at most
+   * two memcpys.  This makes it suitable for a realtime thread (like an audio
+   * callback) on either side.
+   */
+  class spsc_byte_ring : boost::noncopyable {
+    public:
+    typedef std::size_t size_type;
+
+    //! The capacity is rounded up to the next power of two.
+    explicit spsc_byte_ring(size_type capacity = 4096) { this->reserve(capacity); }
+
+    //! Reallocate the storage.  This is not thread-safe at all and anything in
+    //! the ring is lost.
+    void reserve(size_type capacity) {
+      size_type real = 1;
+      while (real < capacity) {
+        real <<= 1;
+      }
+
+      buffer_.assign(real, 0);
+      mask_ = real - 1;
+      tail_.store(0, boost::memory_order_relaxed);
+      head_.store(0, boost::memory_order_relaxed);
+    }
+
+    //! \name Producer side
+    //@{
+
+    //! Copy as much as fits.  Returns the bytes written.
+    size_type write(const void *data, size_type bytes) {
+      const size_type t = tail_.load(boost::memory_order_relaxed);
+      const size_type space = capacity() - (t - head_.load(boost::memory_order_acquire));
+      const size_type n = bytes < space ? bytes : space;
+
+      const size_type at = t & mask_;
+      const size_type first = n < capacity() - at ? n : capacity() - at;
+      const unsigned char *const src = (const unsigned char *) data;
+      std::memcpy(&buffer_[at], src, first);
+      std::memcpy(&buffer_[0], src + first, n - first);
+
+      tail_.store(t + n, boost::memory_order_release);
+      return n;
+    }
+
+    //! Bytes which can be written now.  Only grows under the producer.
+    size_type writable() const {
+      return capacity() - (tail_.load(boost::memory_order_relaxed) - head_.load(boost::memory_order_acquire));
+    }
+
+    //! Index which the next write will go to.  Give it to skip_to() to throw
+    //! away everything before it.
+    size_type write_index() const { return tail_.load(boost::memory_order_relaxed); }
+
+    //@}
+
+    //! \name Consumer side
+    //@{
+
+    //! Copy out as much as there is, up to the given bytes.  Returns the bytes
+    //! read.
+    size_type read(void *data, size_type bytes) {
+      const size_type h = head_.load(boost::memory_order_relaxed);
+      const size_type avail = tail_.load(boost::memory_order_acquire) - h;
+      const size_type n = bytes < avail ? bytes : avail;
+
+      const size_type at = h & mask_;
+      const size_type first = n < capacity() - at ? n : capacity() - at;
+      unsigned char *const dest = (unsigned char *) data;
+      std::memcpy(dest, &buffer_[at], first);
+      std::memcpy(dest + first, &buffer_[0], n - first);
+
+      head_.store(h + n, boost::memory_order_release);
+      return n;
+    }
+
+    //! Throw away everything before a write_index().  Does nothing if it's
+    //! already been read past.
+    void skip_to(size_type index) {
+      const size_type h = head_.load(boost::memory_order_relaxed);
+      const size_type avail = tail_.load(boost::memory_order_acquire) - h;
+      // Unsigned, so an index behind us is huge.
+      if (index - h <= avail) {
+        head_.store(index, boost::memory_order_release);
+      }
+    }
+
+    //! Bytes which can be read now.  Only grows under the consumer.
+    size_type readable() const {
+      return tail_.load(boost::memory_order_acquire) - head_.load(boost::memory_order_relaxed);
+    }
+
+    //@}
+
+    size_type capacity() const { return mask_ + 1; }
+
+    private:
+    char pad0_[cache_line_size];
+    boost::atomic<size_type> tail_;
+    char pad1_[cache_line_size - sizeof(boost::atomic<size_type>)];
+    boost::atomic<size_type> head_;
+    char pad2_[cache_line_size - sizeof(boost::atomic<size_type>)];
+
+    size_type mask_;
+    std::vector<unsigned char> buffer_;
+  };
+}
+#endif
@@ -11,6 +11,8 @@
 #ifndef PARA_SYNCS_HPP_h8412an4
 #define PARA_SYNCS_HPP_h8412an4
 
+#include <boost/atomic.hpp>
+
 namespace para {
   //! \ingroup grp_syncs
   //! The synchronisation primitives for a monitor.
@@ -28,5 +30,56 @@ namespace para {
     lockable_type lockable_;
     waitable_type waitable_;
   };
+
+  /*!
+   * \ingroup grp_syncs
+   *
+   * Synchronisation for lock-free structures which only need to sleep when
+   * they can't make progress (e.g a ring which is empty or full).  The lock is
+   * only taken by a thread which is about to sleep or by one which has to wake
+   * a sleeper, so the normal path is one fence and one relaxed load.
+   *
+   * Whatever makes the predicate true must be stored before unpark() is called.
+   */
+  template<class Waitable, class Lockable, class ScopedLock = typename Lockable::scoped_lock>
+  class parking_sync {
+    public:
+    typedef Lockable lockable_type;
+    typedef Waitable waitable_type;
+    typedef ScopedLock scoped_lock_type;
+
+    parking_sync() : parked_(0) {}
+
+    //! Sleep until ready() is true.  Returns immediately if it already is.
+    template<class Function>
+    void park(Function ready) {
+      scoped_lock_type lock(lockable_);
+      parked_.fetch_add(1, boost::memory_order_relaxed);
+      // Pairs with the fence in unpark.  Either they see us parked or we see
+      // the data they stored.
+      boost::atomic_thread_fence(boost::memory_order_seq_cst);
+      while (! ready()) {
+        waitable_.wait(lock);
+      }
+      parked_.fetch_sub(1, boost::memory_order_relaxed);
+    }
+
+    //! Wake everything which is parked, if anything is.
+    void unpark() {
+      boost::atomic_thread_fence(boost::memory_order_seq_cst);
+      if (parked_.load(boost::memory_order_relaxed) != 0) {
+        scoped_lock_type lock(lockable_);
+        waitable_.notify_all();
+      }
+    }
+
+    lockable_type &lockable() { return lockable_; }
+    waitable_type &waitable() { return waitable_; }
+
+    private:
+    boost::atomic<unsigned> parked_;
+    lockable_type lockable_;
+    waitable_type waitable_;
+  };
 }
 #endif
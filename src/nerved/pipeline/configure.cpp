@@ -12,9 +12,11 @@
 #include "../pipeline/process_stage_sequence.hpp"
 #include "../pipeline/observer_stage_sequence.hpp"
 #include "../pipeline/input_stage_sequence.hpp"
+#include "../stages/create.hpp"
 
 #include "../util/pooled.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace pipeline;
@@ -22,11 +24,11 @@ using namespace config;
 
 namespace stage_cat = config::stage_cat;
 
-static void configure_sequences(output::logger &, pipeline::section &, section_config &);
-static void configure_stage(output::logger &, pipeline::stage_sequence &, stage_config &);
+static std::size_t configure_sequences(output::logger &, pipeline_data &, pipeline::section &, section_config &);
+static void configure_stage(output::logger &, pipeline_data &, pipeline::stage_sequence &, stage_config &);
 static job *configure_job(output::logger &, pipeline_data &, job_config &job_conf);
 
-configure_status ::pipeline::configure(pipeline_data &pd, pipeline_config &pc, const cli::settings &) {
+configure_status ::pipeline::configure(pipeline_data &pd, pipeline_config &pc, const cli::settings &settings) {
   typedef pipeline_config::job_iterator_type    job_iter_t;
   typedef job_config::section_iterator_type     section_iter_t;
 
@@ -35,6 +37,9 @@ configure_status ::pipeline::configure(pipeline_data &pd, pipeline_config &pc, c
 
   section_config *sec_conf = NERVE_CHECK_PTR(pc.pipeline_first());
   section *last_sec = NULL;
+  thread_pipe *last_tp = NULL;
+  // Enough packets to fill every pipe.
+  std::size_t packets_needed = 0;
 
   struct trace_output_data {
     job *last_job;
@@ -73,16 +78,44 @@ configure_status ::pipeline::configure(pipeline_data &pd, pipeline_config &pc, c
     pipe *const in = prev
       ? NERVE_CHECK_PTR(NERVE_CHECK_PTR(last_sec)->connection().out())
       : NERVE_CHECK_PTR(pd.start_terminator());
-    pipe *const out = next
-      ? NERVE_CHECK_PTR(static_cast<pipe*>(last_sec->create_thread_pipe()))
-      : NERVE_CHECK_PTR(static_cast<pipe*>(pd.end_terminator()));
 
-    section *const sec_to_configure = NERVE_CHECK_PTR(job.create_section(in, out));
+    // This job sleeps on its waker until one of its inputs is written.
+    if (prev) {
+      NERVE_CHECK_PTR(last_tp)->reader_waker(job.waker());
+    }
+    else {
+      pd.start_terminator()->reader_waker(job.waker());
+    }
+
+    // The thread pipe is owned by the section which writes to it so the section
+    // must exist before its output does.
+    section *const sec_to_configure = NERVE_CHECK_PTR(job.create_section(in, pd.end_terminator()));
+    if (next) {
+      thread_pipe *const tp = NERVE_CHECK_PTR(sec_to_configure->create_thread_pipe());
+      const section_config::buffer_config &b = sc.buffer();
+      para::pipe_limits limits(b.capacity, b.high_mark, b.low_mark);
+      // The executor only steps a section when its output has room for a whole
+      // batch, so a high mark below that would never let it run.
+      if (settings.workers() && limits.high() < max_batch) {
+        limits = para::pipe_limits(std::max(limits.capacity(), max_batch), max_batch, limits.low());
+      }
+      log.trace(
+        "section '%s' buffer: %lu packets (high %lu, low %lu)\n", sc.name(),
+        (unsigned long) limits.capacity(), (unsigned long) limits.high(), (unsigned long) limits.low()
+      );
+      tp->limits(limits);
+      sec_to_configure->connection().out(tp);
+      last_tp = tp;
+      packets_needed += tp->capacity();
+    }
 
-    configure_sequences(log, *sec_to_configure, sc);
+    packets_needed += configure_sequences(log, pd, *sec_to_configure, sc);
     last_sec = NERVE_CHECK_PTR(sec_to_configure);
   } while ((sec_conf = sec_conf->pipeline_next()) != NULL);
 
+  log.trace("reserve %lu packets\n", (unsigned long) packets_needed);
+  pd.packet_pool()->reserve(packets_needed);
+
   pd.finalise();
   pc.clear();
 
@@ -94,41 +127,57 @@ configure_status ::pipeline::configure(pipeline_data &pd, pipeline_config &pc, c
 job *configure_job(output::logger &log, pipeline_data &pd, job_config &job_conf) {
   log.trace("create job %d\n", pd.jobs().size() + 1);
   pipeline::job *const j = NERVE_CHECK_PTR(pd.create_job());
+  j->attributes() = job_conf.attributes();
   job_conf.configured_job(j);
   return j;
 }
 
-void configure_sequences(output::logger &log, pipeline::section &sec, section_config &sec_conf) {
+//! Returns how many packets the sequences can hold between them.
+std::size_t configure_sequences(output::logger &log, pipeline_data &pd, pipeline::section &sec, section_config &sec_conf) {
   stage_config::category_type last_cat = ::stage_cat::unset;
+  std::size_t packets_held = 0;
 
   pipeline::stage_sequence *sequence = NULL;
   typedef section_config::stage_iterator_type   stage_iter_t;
 
-  pipeline::pipe *input_pipe = NERVE_CHECK_PTR(sec.connection().in());
-  pipeline::pipe *output_pipe = NULL;
-
   for (stage_iter_t stage_conf = sec_conf.begin(); stage_conf != sec_conf.end(); ++stage_conf) {
     const stage_config::category_type this_cat = stage_conf->category();
 
     if (this_cat != last_cat) {
       log.trace("add %s sequence under section '%s'\n", stage_conf->category_name(), sec_conf.name());
-      sequence = NERVE_CHECK_PTR(sec.create_sequence(this_cat, input_pipe, output_pipe));
-      input_pipe = output_pipe;
-      stage_iter_t next = stage_conf;
-      const bool last = ++next == sec_conf.end();
-      output_pipe = last ?
-        NERVE_CHECK_PTR(sec.connection().out()) :
-        NERVE_CHECK_PTR(sequence->create_local_pipe());
+
+      // Only now do we know that the previous sequence isn't the last one.
+      pipeline::pipe *const input_pipe = sequence
+        ? NERVE_CHECK_PTR(sequence->create_local_pipe())
+        : NERVE_CHECK_PTR(sec.connection().in());
+      if (sequence) {
+        sequence->connection().out(input_pipe);
+      }
+
+      sequence = NERVE_CHECK_PTR(sec.create_sequence(this_cat, input_pipe, NULL));
+      if (this_cat == ::stage_cat::input) {
+        input_stage_sequence *const is = static_cast<input_stage_sequence*>(sequence);
+        is->pool(pd.packet_pool());
+        is->inbox(pd.start_terminator());
+      }
+      // Pending input or a local pipe's worth.
+      packets_held += max_batch;
+      last_cat = this_cat;
     }
 
-    configure_stage(log, *NERVE_CHECK_PTR(sequence), *stage_conf);
+    configure_stage(log, pd, *NERVE_CHECK_PTR(sequence), *stage_conf);
   }
+
+  NERVE_CHECK_PTR(sequence)->connection().out(NERVE_CHECK_PTR(sec.connection().out()));
+
+  return packets_held;
 }
 
-void configure_stage(output::logger &log, stage_sequence &seq, stage_config &stage_conf) {
+void configure_stage(output::logger &log, pipeline_data &pd, stage_sequence &seq, stage_config &stage_conf) {
   log.trace("add stage %s\n", stage_conf.name());
 
   pipeline::simple_stage *const stage = NERVE_CHECK_PTR(seq.create_stage(stage_conf.stage_data()));
+  ::stages::add_controls(pd.controls(), stage, stage_conf.stage_data());
 
   if (stage_conf.configs_given()) {
     typedef stage_config::configs_type configs_type;
@@ -26,8 +26,20 @@ namespace pipeline {
     //! Read a packet which caused a wipe.  This is O(1) because a priority
     //! packet will always wipe the queue.  Returns null if no wiping packet.
     packet *read_input_wipe() {
-      NERVE_NIMPL("reading a wipe packet");
-      return NULL;
+      return NERVE_CHECK_PTR(this->in())->read_wipe();
+    }
+
+    //! Get up to max packets from the input connection.
+    std::size_t read_input_batch(packet **out, std::size_t max) {
+      return NERVE_CHECK_PTR(this->in())->read_batch(out, max);
+    }
+
+    //! Push several packets onto the output queue.  Nothing happens if there
+    //! are none.
+    void write_output_batch(packet *const *ps, std::size_t n) {
+      if (n != 0) {
+        NERVE_CHECK_PTR(this->out())->write_batch(ps, n);
+      }
     }
 
     //! Push onto the output queue.
@@ -0,0 +1,91 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#ifndef PIPELINE_CONTROLS_HPP_x3ub9k2d
+#define PIPELINE_CONTROLS_HPP_x3ub9k2d
+
+#include "../util/asserts.hpp"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+namespace pipeline {
+  //! \ingroup grp_pipeline
+  //! A stage whose gain can be set from any thread.
+  class gain_control {
+    public:
+    //! Linear multiplier.
+    virtual void gain(float linear) = 0;
+
+    protected:
+    ~gain_control() {}
+  };
+
+  //! \ingroup grp_pipeline
+  //! A stage which can stop and start playing from any thread.
+  class pause_control {
+    public:
+    virtual void pause(bool paused) = 0;
+
+    protected:
+    ~pause_control() {}
+  };
+
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * The stages which can be changed while the pipeline runs, for the server.
+   * They're set during configuration: the gain is the last volume stage, so
+   * it's the one nearest the output, and pausing is the output.  Neither
+   * changes after that and the stages are thread-safe, so any thread can use
+   * them.
+   */
+  class controls : boost::noncopyable {
+    public:
+    controls() : gain_(NULL), pause_(NULL), paused_(false) {}
+
+    //! \name Configuration
+    //@{
+    void gain_stage(gain_control *g) { gain_ = NERVE_CHECK_PTR(g); }
+    void pause_stage(pause_control *p) { pause_ = NERVE_CHECK_PTR(p); }
+
+    //! The stages are going.
+    void clear() { gain_ = NULL; pause_ = NULL; }
+    //@}
+
+    //! False if there's no stage to do it.
+    bool gain(float linear) {
+      if (! gain_) {
+        return false;
+      }
+      gain_->gain(linear);
+      return true;
+    }
+
+    //! Pause if playing and the other way around.  False if there's no stage
+    //! to do it.
+    bool toggle_pause() {
+      if (! pause_) {
+        return false;
+      }
+
+      lock_type lk(mutex_);
+      paused_ = ! paused_;
+      pause_->pause(paused_);
+      return true;
+    }
+
+    private:
+    typedef boost::mutex mutex_type;
+    typedef mutex_type::scoped_lock lock_type;
+
+    gain_control *gain_;
+    pause_control *pause_;
+
+    //! So toggles from different sessions don't cross.
+    mutex_type mutex_;
+    bool paused_;
+  };
+}
+
+#endif
@@ -0,0 +1,243 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#include "executor.hpp"
+#include "pipeline_data.hpp"
+#include "section.hpp"
+
+#include "../util/asserts.hpp"
+
+#include <boost/bind.hpp>
+
+using namespace pipeline;
+
+//! A section plus its scheduling state.
+struct executor::slot {
+  slot() : sec(NULL), upstream(NULL), downstream(NULL), claimed(false), missed(false), queued(false) {}
+
+  section *sec;
+  //! The sections on the other ends of its thread pipes, if they're sections.
+  slot *upstream;
+  slot *downstream;
+
+  boost::atomic<bool> claimed;
+  //! Someone failed to claim it so the owner must look again on release.
+  boost::atomic<bool> missed;
+  //! On a deque.  Stops a slot being queued twice.
+  boost::atomic<bool> queued;
+};
+
+//! A worker thread's deque.  The owner pushes and pops at the back and the
+//! others steal from the front.  It's locked, but there's rarely anyone else
+//! there.
+struct executor::worker {
+  worker() : index(0), head(0), size(0), capacity(0), found(NULL) {}
+
+  void reserve(std::size_t n) {
+    deque.reset(new slot*[n]);
+    capacity = n;
+  }
+
+  void push_back(slot *s) {
+    boost::mutex::scoped_lock lock(mutex);
+    NERVE_ASSERT(size < capacity, "a slot can only be queued once so the deque can't fill");
+    deque[(head + size++) % capacity] = s;
+  }
+
+  slot *pop_back() {
+    slot *s;
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      if (size == 0) {
+        return NULL;
+      }
+      s = deque[(head + --size) % capacity];
+    }
+    s->queued.store(false);
+    return s;
+  }
+
+  slot *pop_front() {
+    slot *s;
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      if (size == 0) {
+        return NULL;
+      }
+      s = deque[head];
+      head = (head + 1) % capacity;
+      --size;
+    }
+    s->queued.store(false);
+    return s;
+  }
+
+  unsigned index;
+
+  boost::mutex mutex;
+  // Big enough for every slot so pushing never allocates.
+  boost::scoped_array<slot*> deque;
+  std::size_t head;
+  std::size_t size;
+  std::size_t capacity;
+
+  //! Where find_runnable puts its result.
+  slot *found;
+};
+
+executor::executor(pipeline_data &pd, unsigned workers) : num_slots_(0), num_workers_(workers) {
+  NERVE_ASSERT(workers > 0, "an executor needs workers");
+
+  typedef pipeline_data::jobs_type::iterator job_iter;
+  typedef job::sections_type::iterator section_iter;
+
+  for (job_iter j = pd.jobs().begin(); j != pd.jobs().end(); ++j) {
+    num_slots_ += j->sections().size();
+  }
+  NERVE_ASSERT(num_slots_ > 0, "can't execute an empty pipeline");
+
+  slots_.reset(new slot[num_slots_]);
+  std::size_t n = 0;
+  for (job_iter j = pd.jobs().begin(); j != pd.jobs().end(); ++j) {
+    for (section_iter s = j->sections().begin(); s != j->sections().end(); ++s) {
+      slots_[n++].sec = &(*s);
+    }
+  }
+
+  for (std::size_t i = 0; i < num_slots_; ++i) {
+    slot &s = slots_[i];
+    for (std::size_t k = 0; k < num_slots_; ++k) {
+      if (k != i && slots_[k].sec->connection().in() == s.sec->connection().out()) {
+        s.downstream = &slots_[k];
+        slots_[k].upstream = &s;
+      }
+    }
+
+    // All the waiting is done here, not in the pipes.
+    if (thread_pipe *const tp = s.sec->owned_thread_pipe()) {
+      tp->reader_waker(&waker_);
+      tp->writer_waker(&waker_);
+    }
+  }
+  // An idle input wakes up for a load.
+  pd.start_terminator()->reader_waker(&waker_);
+
+  workers_.reset(new worker[num_workers_]);
+  for (unsigned i = 0; i < num_workers_; ++i) {
+    workers_[i].index = i;
+    workers_[i].reserve(num_slots_);
+  }
+
+  // Spread them out to start with.  Most of them won't be runnable yet.
+  for (std::size_t i = 0; i < num_slots_; ++i) {
+    push(workers_[i % num_workers_], slots_[i]);
+  }
+}
+
+// Here because the slot and worker are incomplete in the header.
+executor::~executor() {}
+
+void executor::start(boost::thread_group &threads) {
+  for (unsigned i = 0; i < num_workers_; ++i) {
+    threads.create_thread(boost::bind(&executor::worker_thread, this, boost::ref(workers_[i])));
+  }
+}
+
+void executor::worker_thread(worker &w) {
+forever:
+  slot *s = take(w);
+  if (! s) {
+    // Every read and write of a thread pipe unparks us to look again.
+    w.found = NULL;
+    waker_.park(boost::bind(&executor::find_runnable, this, boost::ref(w)));
+    s = NERVE_CHECK_PTR(w.found);
+  }
+
+  run(w, *s);
+  goto forever;
+}
+
+executor::slot *executor::take(worker &w) {
+  slot *s;
+  while ((s = w.pop_back()) != NULL) {
+    if (claim_runnable(*s)) {
+      return s;
+    }
+  }
+
+  for (unsigned i = 1; i < num_workers_; ++i) {
+    worker &victim = workers_[(w.index + i) % num_workers_];
+    while ((s = victim.pop_front()) != NULL) {
+      if (claim_runnable(*s)) {
+        return s;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+bool executor::find_runnable(worker &w) {
+  for (std::size_t i = 0; i < num_slots_; ++i) {
+    slot &s = slots_[(w.index + i) % num_slots_];
+    if (claim_runnable(s)) {
+      w.found = &s;
+      return true;
+    }
+  }
+  return false;
+}
+
+void executor::run(worker &w, slot &s) {
+  do {
+    for (unsigned i = 0; i < quantum && s.sec->runnable(); ++i) {
+      s.sec->section_step();
+    }
+
+    // What we read and wrote might have let the neighbours run.  Downstream
+    // is pushed last so we pop it first.
+    if (s.sec->runnable()) {
+      push(w, s);
+    }
+    if (s.upstream) {
+      push(w, *s.upstream);
+    }
+    if (s.downstream) {
+      push(w, *s.downstream);
+    }
+  } while (release(s) && hold_if_runnable(s));
+}
+
+void executor::push(worker &w, slot &s) {
+  if (! s.queued.exchange(true)) {
+    w.push_back(&s);
+  }
+}
+
+// A wake can arrive while someone else has the slot and has already looked at
+// its pipes.  Whoever fails to claim it marks it as missed before trying once
+// more, so either they get it or the owner sees the mark when it releases.
+// It's all sequentially consistent, which makes that an either/or.
+
+bool executor::claim(slot &s) {
+  if (! s.claimed.exchange(true)) {
+    return true;
+  }
+  s.missed.store(true);
+  return ! s.claimed.exchange(true);
+}
+
+bool executor::release(slot &s) {
+  s.claimed.store(false);
+  // If someone else gets it then they look at it instead.
+  return s.missed.exchange(false) && ! s.claimed.exchange(true);
+}
+
+bool executor::hold_if_runnable(slot &s) {
+  do {
+    if (s.sec->runnable()) {
+      return true;
+    }
+  } while (release(s));
+  return false;
+}
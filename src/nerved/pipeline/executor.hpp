@@ -0,0 +1,90 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#ifndef PIPELINE_EXECUTOR_HPP_q8mt3vwe
+#define PIPELINE_EXECUTOR_HPP_q8mt3vwe
+
+#include "thread_pipe.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+
+namespace pipeline {
+  class pipeline_data;
+  class section;
+
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * Runs every section of the pipeline on a fixed pool of workers instead of
+   * one thread per job.  Jobs only matter for configuration here; any worker
+   * can step any section, though never two workers at once.
+   *
+   * A section is only stepped when it's runnable (section::runnable), so
+   * workers never wait in a pipe.  Instead, the thread pipes wake the
+   * executor's waker on every read and write and an idle worker looks for
+   * something runnable.  A worker which has just stepped a section queues its
+   * neighbours on its own deque because they're the ones which are likely to
+   * be runnable now, and the downstream one's input is still in this core's
+   * cache.  Idle workers steal from the other end of the other deques.
+   *
+   * A stage which blocks in itself (e.g an output waiting on the device)
+   * holds up its worker, so there should be more workers than there are
+   * sections like that.
+   */
+  class executor : boost::noncopyable {
+    public:
+    //! Steps of one section before a worker looks at something else.
+    static const unsigned quantum = 8;
+
+    //! Takes over the wakers of every thread pipe in the pipeline and of the
+    //! start terminator, so it must be made before anything runs.
+    executor(pipeline_data &, unsigned workers);
+    ~executor();
+
+    //! Start the workers.  Like job threads they never return.
+    void start(boost::thread_group &);
+
+    private:
+    struct slot;
+    struct worker;
+
+    //! Main method for a worker.
+    void worker_thread(worker &);
+
+    //! A claimed runnable slot from our deque or someone else's, or null.
+    slot *take(worker &);
+    //! The park predicate.  Claims the first runnable slot into w.found.
+    bool find_runnable(worker &w);
+
+    //! Step a claimed slot while it's runnable and then release it.
+    void run(worker &, slot &);
+
+    //! Queue on w's deque unless it's already on one.
+    void push(worker &w, slot &s);
+
+    //! \name Claims
+    //! Only the worker which has claimed a slot may look at or step its
+    //! section.
+    //@{
+    bool claim(slot &);
+    //! True if it was claimed again because of a missed wake.
+    bool release(slot &);
+    //! Claimed already.  Keep it if it's runnable or give it up.
+    bool hold_if_runnable(slot &);
+    bool claim_runnable(slot &s) { return claim(s) && hold_if_runnable(s); }
+    //@}
+
+    boost::scoped_array<slot> slots_;
+    std::size_t num_slots_;
+    boost::scoped_array<worker> workers_;
+    unsigned num_workers_;
+    job_waker waker_;
+  };
+}
+
+#endif
@@ -1,6 +1,8 @@
 // Copyright (C) 2011, James Webber.
 // Distributed under a 3-clause BSD license.  See COPYING.
 #include "input_stage_sequence.hpp"
+#include "packet_pool.hpp"
+#include "terminators.hpp"
 
 #include "../stages/create.hpp"
 #include "../stages/stage_data.hpp"
@@ -13,34 +15,50 @@ simple_stage *input_stage_sequence::create_stage(stages::stage_data &cfg) {
 }
 
 stage_sequence::step_state input_stage_sequence::sequence_step() {
-  packet *p = NERVE_CHECK_PTR(read_input());
-  switch (p->event()) {
+  // The request stays with the start terminator; what we send on is ours.
+  const packet *const request = NERVE_CHECK_PTR(read_input());
+  packet *const p = NERVE_CHECK_PTR(NERVE_CHECK_PTR(pool_)->acquire());
+
+  switch (request->event()) {
   case packet::event::load:
-    load_event();
+    load_event(request);
+    p->event(packet::event::abandon);
+    write_output_wipe(p);
     break;
   case packet::event::skip:
-    skip_event();
+    skip_event(request);
+    p->event(packet::event::abandon);
+    write_output_wipe(p);
+    break;
+  case packet::event::cue:
+    // Only the input stage needs to know.
+    cue_event(request);
+    p->release();
     break;
     // TODO : more events
   case packet::event::data:
-    p = NERVE_CHECK_PTR(is_->read());
+    write_output(NERVE_CHECK_PTR(NERVE_CHECK_PTR(is_)->read(p)));
     break;
   default:
     NERVE_ABORT("event should never happen here");
   }
 
-  // change p.event to "abandon" unless we just read data
-  write_output_wipe(p);
-
+  NERVE_CHECK_PTR(inbox_)->idle(is_->idle());
   return stage_sequence::state::complete;
 }
-// TODO:
-//   Calls load on the input stage with details of what to load.  Not
-//   entirely sure on that yet so let's leave it.
-void input_stage_sequence::load_event() {
-  NERVE_NIMPL("load file event");
+
+// The details of the event are in the request's payload; see
+// start_terminator.
+void input_stage_sequence::load_event(const packet *request) {
+  const char *const path = (const char *) request->payload().data();
+  NERVE_CHECK_PTR(is_)->load(NERVE_CHECK_PTR(path));
+}
+
+void input_stage_sequence::cue_event(const packet *request) {
+  const char *const path = (const char *) request->payload().data();
+  NERVE_CHECK_PTR(is_)->cue(NERVE_CHECK_PTR(path));
 }
 
-void input_stage_sequence::skip_event() {
-  NERVE_NIMPL("skip to timestamp event");
+void input_stage_sequence::skip_event(const packet *request) {
+  NERVE_CHECK_PTR(is_)->skip(request->payload().data());
 }
@@ -9,6 +9,9 @@
 
 namespace pipeline {
   struct input_stage;
+  class packet;
+  class packet_pool;
+  class start_terminator;
 
   /*!
    * \ingroup grp_pipeline
@@ -21,19 +24,31 @@ namespace pipeline {
   class input_stage_sequence : public stage_sequence {
     public:
 
-    input_stage_sequence() : is_(NULL) {}
+    input_stage_sequence() : is_(NULL), pool_(NULL), inbox_(NULL) {}
 
-    void finalise() {}
+    //! Where every packet sent down the pipeline comes from.
+    void pool(packet_pool *p) { pool_ = p; }
+
+    //! Where the requests come from.  Told when the input stage is idle.
+    void inbox(start_terminator *t) { inbox_ = t; }
+
+    void finalise() {
+      NERVE_ASSERT(pool_ != NULL, "the input sequence needs a packet pool");
+      NERVE_ASSERT(inbox_ != NULL, "the input sequence needs the start terminator");
+    }
 
     simple_stage *create_stage(stage_sequence::stage_data_type &cfg);
     stage_sequence::step_state sequence_step();
 
     private:
-    void load_event();
-    void skip_event();
+    void load_event(const packet *request);
+    void cue_event(const packet *request);
+    void skip_event(const packet *request);
 
     private:
     input_stage *is_;
+    packet_pool *pool_;
+    start_terminator *inbox_;
   };
 }
 #endif
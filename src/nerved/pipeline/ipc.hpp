@@ -10,9 +10,16 @@
 
 #include "../util/asserts.hpp"
 
+#include <cstddef>
+
 namespace pipeline {
   struct packet;
 
+  //! \ingroup grp_pipeline
+  //! Most packets moved by one batch operation.  A sequence never writes more
+  //! than this many per step, so it's also the size of a local pipe.
+  static const std::size_t max_batch = 16;
+
   //! \ingroup grp_pipeline
   //! Polymorphic one-way data transfer between stages (the sequences does the
   //! actual usage of these)
@@ -22,6 +29,24 @@ namespace pipeline {
     virtual void write(packet *) = 0;
     virtual void write_wipe(packet *) = 0;
     virtual packet *read() = 0;
+
+    //! Read at least one and at most max packets.  Pipes which are never
+    //! waited on (local pipes) return zero when empty.
+    virtual std::size_t read_batch(packet **out, std::size_t max) = 0;
+    //! Write n packets in order for the price of one write.
+    virtual void write_batch(packet *const *in, std::size_t n) = 0;
+
+    //! The packet which caused a wipe, if one is waiting, otherwise null.
+    //! Never waits.  A packet read here is not returned by the other reads.
+    virtual packet *read_wipe() = 0;
+
+    //! Would a read return something without waiting?  Only meaningful to
+    //! the reader.
+    virtual bool readable() = 0;
+
+    //! Would writing n packets return without waiting?  Only meaningful to
+    //! the writer.
+    virtual bool writable(std::size_t n) = 0;
   };
 
   struct thread_pipe;
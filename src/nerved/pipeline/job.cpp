@@ -4,6 +4,7 @@
 #include "job.hpp"
 #include "section.hpp"
 
+#include "../output/logging.hpp"
 #include "../util/asserts.hpp"
 
 using namespace pipeline;
@@ -19,34 +20,42 @@ section *job::create_section(pipe *in, pipe *out) {
   return s;
 }
 
+bool job::any_ready() {
+  typedef sections_type::iterator iter_type;
+  for (iter_type s = sections().begin(); s != sections().end(); ++s) {
+    if (! s->would_block()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void pipeline::job::job_thread() {
   NERVE_ASSERT(! sections().empty(), "thread can't loop on nothing");
+
+  if (attributes().given()) {
+    output::logger log(output::source::pipeline);
+    attributes().apply(log);
+  }
+
 forever:
   typedef sections_type::iterator iter_type;
-  bool blocked_already = false;
+  bool stepped = false;
   for (iter_type s = sections().begin(); s != sections().end(); ++s) {
-    // Fullfills the "jobs mustn't block twice" requirement.
-    //
-    // TODO:
-    //   The mechanism and purpose is not well defined.  Especially we might
-    //   care if blocking on input or output.  It might be that we do it
-    //   based on the return from section_step and let the messy details of
-    //   that be totally transparent.
-    //
+    // Only the output can block now, which fulfills the "jobs mustn't block
+    // twice" requirement as long as the output's reader isn't in this job.
     if (s->would_block()) {
-      if (blocked_already) {
-        // Continue instead of break to avoid a bias towards sections at the
-        // start of the job.
-        continue;
-      }
-      else {
-        blocked_already = true;
-      }
+      continue;
     }
 
     s->section_step();
+    stepped = true;
+  }
+
+  if (! stepped) {
+    // One wait for all the inputs.  Whatever writes to them unparks us.
+    waker_.park(boost::bind(&job::any_ready, this));
   }
 
   goto forever;
 }
-
@@ -5,6 +5,7 @@
 #define PIPELINE_JOB_HPP_lih1nqby
 
 #include "section.hpp"
+#include "thread_attributes.hpp"
 #include "../util/pooled.hpp"
 #include "../util/indirect.hpp"
 
@@ -17,6 +18,10 @@ namespace pipeline {
    *
    * Maps onto a thread, contains sections, and ensures we don't block too many
    * times in a thread (which causes deadlocks).
+   *
+   * Sections are only stepped when they can make progress without waiting for
+   * input.  When none can, the job sleeps on its waker, which is woken by the
+   * thread pipes it reads from.
    */
   class job {
     public:
@@ -28,13 +33,25 @@ namespace pipeline {
     //! Called after all the "create" whatsits have been done.
     void finalise();
 
-    //! Main method for a thread.
+    //! Main method for a thread.  Applies the attributes first.
     void job_thread();
 
-    private:
+    //! How the job's thread is scheduled.
+    thread_attributes &attributes() { return attributes_; }
+    const thread_attributes &attributes() const { return attributes_; }
+
+    //! Given to the thread pipes which this job reads.
+    job_waker *waker() { return &waker_; }
+
     sections_type &sections() { return sections_;  }
 
+    private:
+    //! Can any section run?
+    bool any_ready();
+
     sections_type sections_;
+    job_waker waker_;
+    thread_attributes attributes_;
   };
 }
 #endif
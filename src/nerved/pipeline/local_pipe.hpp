@@ -10,32 +10,61 @@
 
 namespace pipeline {
   //! \ingroup grp_pipeline
-  //! Non-thread safe non-buffered pipe.
+  //! Non-thread safe pipe which holds one batch.  The reading sequence always
+  //! runs straight after the writing one, so it never needs to be bigger.
+  //! Wipes don't clear anything because nothing stays here long enough to be
+  //! worth wiping.
   class local_pipe : public pipe {
     public:
-    local_pipe() : data_(NULL) {}
+    local_pipe() : begin_(0), end_(0) {}
 
     void write(packet *p) { do_write(p); }
     void write_wipe(packet *p) { do_write(p); }
 
-    void clear() {}
+    void clear() { begin_ = end_ = 0; }
 
     packet *read() {
-      NERVE_ASSERT(data_ != NULL, "can't read from an empty local pipe");
-      packet *ret = NULL;
-      std::swap(ret, data_);
-      return data_;
+      NERVE_ASSERT(begin_ != end_, "can't read from an empty local pipe");
+      packet *const ret = data_[begin_++];
+      if (begin_ == end_) {
+        clear();
+      }
+      return ret;
     }
 
+    std::size_t read_batch(packet **out, std::size_t max) {
+      const std::size_t n = std::min(max, end_ - begin_);
+      std::copy(data_ + begin_, data_ + begin_ + n, out);
+      begin_ += n;
+      if (begin_ == end_) {
+        clear();
+      }
+      return n;
+    }
+
+    void write_batch(packet *const *in, std::size_t n) {
+      NERVE_ASSERT(end_ + n <= max_batch, "can't write more than a batch to a local pipe");
+      std::copy(in, in + n, data_ + end_);
+      end_ += n;
+    }
+
+    //! Wipes aren't prioritised within a job.
+    packet *read_wipe() { return NULL; }
+
+    bool readable() { return begin_ != end_; }
+    bool writable(std::size_t n) { return end_ + n <= max_batch; }
+
     private:
 
     void do_write(packet *p) {
-      NERVE_ASSERT(data_ == NULL, "can't write to a full local pipe");
-      data_ = p;
+      NERVE_ASSERT(end_ < max_batch, "can't write to a full local pipe");
+      data_[end_++] = p;
     }
 
     private:
-    packet *data_;
+    packet *data_[max_batch];
+    std::size_t begin_;
+    std::size_t end_;
   };
 }
 #endif
@@ -10,24 +10,33 @@
 using namespace pipeline;
 
 stage_sequence::step_state observer_stage_sequence::sequence_step() {
-  packet *p = read_input();
-
-  switch(NERVE_CHECK_PTR(p)->event()) {
-  case packet::event::data:
-    std::for_each(
-      stages().begin(), stages().end(),
-      boost::bind(&observer_stage::observe, _1, p)
-    );
-    write_output(p);
-    break;
-  default:
-    this->non_data_step(stages(), p);
-    break;
+  packet *batch[max_batch];
+  const std::size_t n = read_input_batch(batch, max_batch);
+
+  // Data goes out in runs so that non-data events stay in order with it.
+  std::size_t run = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    packet *const p = NERVE_CHECK_PTR(batch[i]);
+
+    if (p->non_data()) {
+      write_output_batch(batch + run, i - run);
+      this->non_data_step(stages(), p);
+      run = i + 1;
+    }
+    else {
+      std::for_each(
+        stages().begin(), stages().end(),
+        boost::bind(&observer_stage::observe, _1, p)
+      );
+    }
   }
 
+  write_output_batch(batch + run, n - run);
   return stage_sequence::state::complete;
 }
 
 simple_stage *observer_stage_sequence::create_stage(stages::stage_data &cfg) {
-  return NERVE_CHECK_PTR(stages::create_observer_stage(cfg));
+  observer_stage *const os = NERVE_CHECK_PTR(stages::create_observer_stage(cfg));
+  stages().push_back(os);
+  return os;
 }
@@ -5,6 +5,9 @@
 #define PIPELINE_OUTPUT_STAGE_HPP_zia9vdqt
 
 #include "simple_stages.hpp"
+#include "packet.hpp"
+
+#include <cstddef>
 
 namespace pipeline {
   class packet;
@@ -37,9 +40,17 @@ namespace pipeline {
   /*!
    * \ingroup grp_pipeline
    * Specialised outputting stage.
+   *
+   * reconfigure() is called before output() whenever a packet of samples has
+   * a different format from the last one, including the first.  Formats are
+   * compared with audio_format::same_as, so while the generation stays the
+   * same it costs one integer compare per packet.  The output decides what
+   * a change needs; it doesn't have to reopen anything.
    */
   class output_stage : public observer_stage {
     public:
+    output_stage() : input_events_(NULL) {}
+
     virtual void output(packet *, outputter *) = 0;
     virtual void reconfigure(packet *) = 0;
 
@@ -52,13 +63,23 @@ namespace pipeline {
     void observe(packet *pkt) {
       // TODO:
       //   Perhaps better in a hypothetical output seqeuence.
-      // if (pkt.configuration != last_configuration) {
-      //   this->reconfigure(pkt);
-      // }
+      const payload &pl = pkt->payload();
+      if (pl.content() == payload_content::samples && ! pl.empty() && ! pl.format().same_as(last_format_)) {
+        last_format_ = pl.format();
+        this->reconfigure(pkt);
+      }
 
       // Prolly this should pass a specialised event interface.
       this->output(pkt, input_events_);
     }
+
+    protected:
+    //! Make the next packet of samples reconfigure even if it's the same
+    //! format, e.g because the device was closed.
+    void forget_format() { last_format_ = audio_format(); }
+
+    private:
+    audio_format last_format_;
   };
 
 }
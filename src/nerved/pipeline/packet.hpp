@@ -4,11 +4,28 @@
 #ifndef PIPELINE_PACKET_HPP_7nyok8p6
 #define PIPELINE_PACKET_HPP_7nyok8p6
 
+#include "payload.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+
 namespace pipeline {
+  class packet_pool;
 
-  //! \ingroup grp_pipeline
-  //! Data packet passed down the pipeline.
-  class packet {
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * Data packet passed down the pipeline.  Packets are fixed size so they can
+   * be recycled by a packet_pool.  The payload describes the samples, which
+   * are usually decoded straight into the packet's own aligned storage.
+   *
+   * Packets are reference counted.  Whoever holds a packet owns one reference
+   * and either passes it on (i.e writes it to a pipe) or releases it.  A stage
+   * which keeps a packet after passing it on must retain it first.
+   */
+  class packet : boost::noncopyable {
     public:
 
     //! A namespace for the event identifiers.
@@ -17,6 +34,9 @@ namespace pipeline {
         data,
         load,
         skip,
+        //! The track to follow the current one.  Only for the input
+        //! sequence; it's never sent further.
+        cue,
         flush,
         abandon,
         finish
@@ -25,6 +45,14 @@ namespace pipeline {
 
     typedef event::id event_type;
 
+    //! Alignment of the storage.  Enough for any vector unit we care about.
+    static const std::size_t storage_alignment = 64;
+    //! Bytes of storage.  FFmpeg won't decode into anything smaller than
+    //! AVCODEC_MAX_AUDIO_FRAME_SIZE, which is this.
+    static const std::size_t storage_size = 192000;
+
+    packet() : event_(event::data), refs_(0), pool_(NULL), next_free_(NULL) {}
+
     event_type event() const { return event_; }
     void event(event_type e) { event_ = e; }
 
@@ -33,9 +61,41 @@ namespace pipeline {
 
     bool non_data() const { return event_ != event::data; }
 
+    const pipeline::payload &payload() const { return payload_; }
+    pipeline::payload &payload() { return payload_; }
+
+    //! storage_size bytes aligned to storage_alignment.
+    unsigned char *storage() {
+      const std::size_t base = (std::size_t) storage_;
+      return (unsigned char *) ((base + storage_alignment - 1) & ~(storage_alignment - 1));
+    }
+
+    //! \name Ownership
+    //@{
+
+    //! Take another reference.
+    void retain() { refs_.fetch_add(1, boost::memory_order_relaxed); }
+
+    //! Drop a reference.  The last one gives the packet back to its pool.
+    //! Defined in packet_pool.cpp.
+    void release();
+
+    //! Where it came from.  A stage which makes more packets than it's given
+    //! acquires them from here.
+    packet_pool *pool() const { return pool_; }
+
+    //@}
+
     private:
+    friend class packet_pool;
 
     event_type event_;
+    pipeline::payload payload_;
+    boost::atomic<unsigned int> refs_;
+    packet_pool *pool_;
+    packet *next_free_;
+
+    unsigned char storage_[storage_size + storage_alignment - 1];
   };
 }
 
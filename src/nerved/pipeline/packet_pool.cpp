@@ -0,0 +1,71 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "packet_pool.hpp"
+
+#include "../util/asserts.hpp"
+#include "../util/pooled.hpp"
+
+#include <algorithm>
+
+using namespace pipeline;
+
+void packet::release() {
+  NERVE_ASSERT(refs_.load(boost::memory_order_relaxed) > 0, "released a packet which nobody owns");
+  if (refs_.fetch_sub(1, boost::memory_order_release) == 1) {
+    // Whatever the other owners wrote must be finished before it's reused.
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    NERVE_CHECK_PTR(pool_)->recycle(this);
+  }
+}
+
+packet_pool::~packet_pool() {
+  std::for_each(packets_.begin(), packets_.end(), ::pooled::call_free<packet>());
+}
+
+void packet_pool::reserve(std::size_t n) {
+  lock_type lock(mutex_);
+  packets_.reserve(n);
+  while (packets_.size() < n) {
+    push_free(allocate());
+  }
+}
+
+packet *packet_pool::acquire() {
+  packet *p;
+  {
+    lock_type lock(mutex_);
+    if (free_) {
+      p = free_;
+      free_ = p->next_free_;
+      --free_count_;
+    }
+    else {
+      p = allocate();
+    }
+  }
+
+  p->next_free_ = NULL;
+  p->event(packet::event::data);
+  p->payload().clear();
+  p->refs_.store(1, boost::memory_order_relaxed);
+  return p;
+}
+
+void packet_pool::recycle(packet *p) {
+  NERVE_ASSERT(p->pool_ == this, "packet recycled into the wrong pool");
+  lock_type lock(mutex_);
+  push_free(p);
+}
+
+packet *packet_pool::allocate() {
+  packet *const p = NERVE_CHECK_PTR(::pooled::alloc<packet>());
+  p->pool_ = this;
+  packets_.push_back(p);
+  return p;
+}
+
+void packet_pool::push_free(packet *p) {
+  p->next_free_ = free_;
+  free_ = p;
+  ++free_count_;
+}
@@ -0,0 +1,65 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#ifndef PIPELINE_PACKET_POOL_HPP_w3bqk9zx
+#define PIPELINE_PACKET_POOL_HPP_w3bqk9zx
+
+#include "packet.hpp"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace pipeline {
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * Per-pipeline freelist of packets.  The input sequence takes packets from
+   * here and the end terminator (or whatever throws a packet away) gives them
+   * back.  Packets are allocated from the pooled allocator only when the
+   * freelist is empty, so once the pipeline's buffers are full there is no
+   * allocation at all.
+   *
+   * Any thread may acquire or release.  The freelist is locked but the lock is
+   * only held for a couple of pointer swaps.
+   */
+  class packet_pool : boost::noncopyable {
+    public:
+    packet_pool() : free_(NULL), free_count_(0) {}
+    ~packet_pool();
+
+    //! Make sure at least n packets exist so the steady state doesn't allocate.
+    void reserve(std::size_t n);
+
+    //! A data packet with one reference.
+    packet *acquire();
+
+    //! Called by packet::release when the last reference goes.
+    void recycle(packet *);
+
+    //! \name Statistics
+    //! These are only estimates unless the pipeline is stopped.
+    //@{
+    std::size_t allocated() const { return packets_.size(); }
+    std::size_t available() const { return free_count_; }
+    //@}
+
+    private:
+    typedef boost::mutex mutex_type;
+    typedef mutex_type::scoped_lock lock_type;
+
+    //! Lock must be held.
+    packet *allocate();
+    //! Lock must be held.
+    void push_free(packet *);
+
+    mutex_type mutex_;
+    packet *free_;
+    std::size_t free_count_;
+    std::vector<packet*> packets_;
+  };
+}
+
+#endif
@@ -21,10 +21,15 @@ namespace pipeline {
   class packet_return {
     public:
 
+    //! Nothing returned.
     packet_return() : buffering_(false), packet_(NULL) {}
 
+    //! A packet, and whether there's more to debuffer after it.
+    explicit packet_return(pipeline::packet *p, bool buffering = false)
+    : buffering_(buffering), packet_(NERVE_CHECK_PTR(p)) {}
+
     bool buffering() const { return buffering_; }
-    bool empty() const { return packet_ != NULL; }
+    bool empty() const { return packet_ == NULL; }
     pipeline::packet *packet() const {
       NERVE_ASSERT(! this->empty(), "access to packet is not allowed for an empty return");
       return packet_;
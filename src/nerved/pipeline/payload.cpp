@@ -0,0 +1,17 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "payload.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace {
+  boost::atomic<pipeline::audio_format::generation_type> last_generation(0);
+}
+
+pipeline::audio_format::generation_type pipeline::new_format_generation() {
+  audio_format::generation_type g;
+  do {
+    g = last_generation.fetch_add(1, boost::memory_order_relaxed) + 1;
+  } while (g == 0);
+  return g;
+}
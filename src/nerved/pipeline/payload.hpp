@@ -0,0 +1,190 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#ifndef PIPELINE_PAYLOAD_HPP_c1xk3w8e
+#define PIPELINE_PAYLOAD_HPP_c1xk3w8e
+
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+
+namespace pipeline {
+  //! \ingroup grp_pipeline
+  //! A namespace for the sample format enum.
+  struct sample_format {
+    enum id {
+      none,
+      s16,
+      s32,
+      flt,
+      dbl
+    };
+
+    //! Bytes in one sample of one channel, or zero for none.
+    static std::size_t bytes(id f) {
+      switch (f) {
+      case s16: return 2;
+      case s32: return 4;
+      case flt: return 4;
+      case dbl: return 8;
+      default: return 0;
+      }
+    }
+  };
+
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * How the samples in a payload are to be interpreted.  Samples are always
+   * interleaved.
+   *
+   * A format can also carry a generation, which stages that make samples
+   * take from a format_generations.  Every packet in a run of the same
+   * format has the same generation, so a stage which needs to notice a
+   * change can usually compare one integer with same_as().  Zero means no
+   * generation and always falls back to comparing the format.  The
+   * generation isn't part of ==.
+   */
+  class audio_format {
+    public:
+    // Qualified because sample_format() hides the struct in here.
+    typedef pipeline::sample_format::id sample_format_type;
+    typedef boost::uint32_t generation_type;
+
+    audio_format() : sample_format_(pipeline::sample_format::none), channels_(0), rate_(0), generation_(0) {}
+
+    audio_format(sample_format_type f, unsigned int channels, unsigned int rate)
+    : sample_format_(f), channels_(channels), rate_(rate), generation_(0) {}
+
+    sample_format_type sample_format() const { return sample_format_; }
+    unsigned int channels() const { return channels_; }
+    //! Samples per second per channel.
+    unsigned int rate() const { return rate_; }
+
+    //! Bytes per sample for all channels.
+    std::size_t frame_bytes() const { return pipeline::sample_format::bytes(sample_format_) * channels_; }
+
+    bool operator==(const audio_format &o) const {
+      return sample_format_ == o.sample_format_ && channels_ == o.channels_ && rate_ == o.rate_;
+    }
+
+    bool operator!=(const audio_format &o) const { return ! (*this == o); }
+
+    //! \name Generations
+    //@{
+    generation_type generation() const { return generation_; }
+    void generation(generation_type g) { generation_ = g; }
+
+    //! Equal, but quicker when both are from the same generation.
+    bool same_as(const audio_format &o) const {
+      return (generation_ != 0 && generation_ == o.generation_) || *this == o;
+    }
+    //@}
+
+    private:
+    sample_format_type sample_format_;
+    unsigned int channels_;
+    unsigned int rate_;
+    generation_type generation_;
+  };
+
+  //! \ingroup grp_pipeline
+  //! A new generation number, unique in the process and never zero.  Defined
+  //! in payload.cpp.
+  audio_format::generation_type new_format_generation();
+
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * Kept by a stage which makes samples.  Every format it makes goes through
+   * stamp(), which only gives out a new generation when the format is
+   * different from the last one.
+   */
+  class format_generations {
+    public:
+    const audio_format &stamp(const audio_format &f) {
+      if (current_.generation() == 0 || f != current_) {
+        current_ = f;
+        current_.generation(new_format_generation());
+      }
+      return current_;
+    }
+
+    private:
+    audio_format current_;
+  };
+
+  //! \ingroup grp_pipeline
+  //! A namespace for what a payload's bytes are.
+  struct payload_content {
+    enum id {
+      //! Decoded samples in the format.
+      samples,
+      //! Whatever a decoder needs to know before the compressed data.  Only
+      //! the stage which wrote it knows how to read it.
+      codec_header,
+      //! Undecoded data from a demuxer.
+      compressed
+    };
+  };
+
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * Describes the samples carried by a packet.  The data is normally the
+   * packet's own storage, which is where stages write to avoid copying, but
+   * it may point anywhere which lives at least as long as the packet.
+   */
+  class payload {
+    public:
+    typedef boost::int64_t timestamp_type;
+    typedef payload_content::id content_type;
+
+    payload() { this->clear(); }
+
+    void clear() {
+      data_ = NULL;
+      size_ = 0;
+      content_ = payload_content::samples;
+      format_ = audio_format();
+      timestamp_ = 0;
+    }
+
+    //! \name Samples
+    //@{
+    void *data() const { return data_; }
+    //! In bytes.
+    std::size_t size() const { return size_; }
+    void data(void *d, std::size_t bytes) { data_ = d; size_ = bytes; }
+
+    bool empty() const { return size_ == 0; }
+    //! Samples per channel.
+    std::size_t frames() const {
+      const std::size_t fb = format_.frame_bytes();
+      return fb ? size_ / fb : 0;
+    }
+    //@}
+
+    //! Anything other than samples is only meaningful to the stages which
+    //! pair up to make and use it.
+    content_type content() const { return content_; }
+    void content(content_type c) { content_ = c; }
+
+    const audio_format &format() const { return format_; }
+    void format(const audio_format &f) { format_ = f; }
+
+    //! Position of the first sample from the start of the track in
+    //! microseconds.
+    timestamp_type timestamp() const { return timestamp_; }
+    void timestamp(timestamp_type t) { timestamp_ = t; }
+
+    private:
+    void *data_;
+    std::size_t size_;
+    content_type content_;
+    audio_format format_;
+    timestamp_type timestamp_;
+  };
+}
+
+#endif
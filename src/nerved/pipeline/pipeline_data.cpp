@@ -16,6 +16,7 @@ using namespace pipeline;
 typedef pipeline::pipe pipe_type;
 
 void pipeline_data::clear() {
+  controls_.clear();
   jobs_.clear();
 }
 
@@ -7,7 +7,9 @@
 // Necessary because it's destroyed in the pooled_destructor so the size is
 // needed.
 #include "job.hpp"
+#include "controls.hpp"
 #include "terminators.hpp"
+#include "packet_pool.hpp"
 
 #include <boost/utility.hpp>
 #include "../util/pooled.hpp"
@@ -31,6 +33,15 @@ namespace pipeline {
     pipeline::start_terminator *start_terminator() { return &start_terminator_; }
     pipeline::end_terminator *end_terminator() { return &end_terminator_; }
 
+    //! What the end of the pipeline has seen.  Readable from any thread.
+    const pipeline::play_status &status() const { return end_terminator_.status(); }
+
+    //! What the server can change while it runs.
+    pipeline::controls &controls() { return controls_; }
+
+    //! Every packet in this pipeline comes from here.
+    pipeline::packet_pool *packet_pool() { return &packet_pool_; }
+
     //! Check and finish the pipeline objects after configuration.
     void finalise();
 
@@ -41,9 +52,13 @@ namespace pipeline {
     jobs_type &jobs() { return jobs_; }
 
     private:
+    // Declared first so that it outlives the jobs, which might still hold
+    // packets.
+    pipeline::packet_pool packet_pool_;
     jobs_type jobs_;
     pipeline::start_terminator start_terminator_;
     pipeline::end_terminator end_terminator_;
+    pipeline::controls controls_;
   };
 }
 
@@ -0,0 +1,103 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#ifndef PIPELINE_PLAY_STATUS_HPP_q8c2vmhe
+#define PIPELINE_PLAY_STATUS_HPP_q8c2vmhe
+
+#include "payload.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+
+namespace pipeline {
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * What has come out of the end of the pipeline, for anyone who wants to
+   * know (i.e the server).  It's written by the end terminator as packets go
+   * past, and read from any thread without locking.
+   *
+   * Each field is read separately, so a snapshot taken during an update can
+   * mix the two.  changes() goes up after every change of state or track,
+   * which is what readers should compare to see if anything happened.  The
+   * position changes with every packet and doesn't count.
+   */
+  class play_status : boost::noncopyable {
+    public:
+    //! A namespace for the states.
+    struct state {
+      enum id {
+        stopped,
+        playing
+      };
+    };
+
+    typedef state::id state_type;
+    typedef payload::timestamp_type timestamp_type;
+
+    //! A copy of everything at about the same time.
+    struct snapshot {
+      state_type state;
+      //! Goes up each time a track is abandoned for another one.
+      boost::uint64_t track;
+      //! How far into the track has been played, in microseconds.
+      timestamp_type position;
+      boost::uint64_t changes;
+    };
+
+    play_status() : state_(state::stopped), track_(0), position_(0), changes_(0) {}
+
+    snapshot read() const {
+      snapshot s;
+      s.changes = changes_.load(boost::memory_order_acquire);
+      s.state = (state_type) state_.load(boost::memory_order_relaxed);
+      s.track = track_.load(boost::memory_order_relaxed);
+      s.position = position_.load(boost::memory_order_relaxed);
+      return s;
+    }
+
+    boost::uint64_t changes() const { return changes_.load(boost::memory_order_acquire); }
+
+    //! \name Updates
+    //! Only the end terminator's thread.
+    //@{
+
+    //! Samples up to here have gone.
+    void played(timestamp_type position) {
+      position_.store(position, boost::memory_order_relaxed);
+      if (state_.load(boost::memory_order_relaxed) != state::playing) {
+        state_.store(state::playing, boost::memory_order_relaxed);
+        this->changed();
+      }
+    }
+
+    //! The current track was thrown away.
+    void abandoned() {
+      track_.store(track_.load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+      position_.store(0, boost::memory_order_relaxed);
+      this->changed();
+    }
+
+    void finished() {
+      if (state_.load(boost::memory_order_relaxed) != state::stopped) {
+        state_.store(state::stopped, boost::memory_order_relaxed);
+        this->changed();
+      }
+    }
+
+    //@}
+
+    private:
+    void changed() {
+      changes_.store(changes_.load(boost::memory_order_relaxed) + 1, boost::memory_order_release);
+    }
+
+    boost::atomic<unsigned int> state_;
+    boost::atomic<boost::uint64_t> track_;
+    boost::atomic<timestamp_type> position_;
+    boost::atomic<boost::uint64_t> changes_;
+  };
+}
+
+#endif
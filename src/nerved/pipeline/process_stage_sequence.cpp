@@ -3,13 +3,15 @@
 
 #include "process_stage_sequence.hpp"
 
+#include "../stages/create.hpp"
 #include "../stages/stage_data.hpp"
 
 using namespace pipeline;
 
 simple_stage *process_stage_sequence::create_stage(stages::stage_data &cfg) {
-  NERVE_NIMPL("creating a process stage sequence member");
-  return NULL;
+  process_stage *const ps = NERVE_CHECK_PTR(stages::create_process_stage(cfg));
+  stages().push_back(ps);
+  return ps;
 }
 
 void process_stage_sequence::finalise() {
@@ -19,26 +21,53 @@ void process_stage_sequence::finalise() {
 stage_sequence::step_state process_stage_sequence::sequence_step() {
   typedef stage_sequence::state state;
 
-  if (data_loop_.buffering()) {
+  if (data_loop_.buffering() || pending()) {
     // We must check for wipe events first to reduce latency.  Otherwise a
-    // buffering stage will continue to do work while there is an abandon event
-    // on the queue.
+    // buffering stage, or what's left of the last batch, will continue to be
+    // worked on while there is an abandon event on the queue.
     packet *p = connection().read_input_wipe();
     if (p) {
       NERVE_ASSERT(p->event() == packet::event::abandon, "only 'abandon' packets cause wipes");
       data_loop_.abandon_reset();
+      clear_pending();
       this->non_data_step(stages(), p);
       return state::complete;
     }
+  }
+
+  if (data_loop_.buffering()) {
+    data_loop_.debuffer_step();
+    return this->current_state();
+  }
+
+  if (! pending()) {
+    pending_begin_ = 0;
+    pending_end_ = read_input_batch(pending_, max_batch);
+  }
+
+  // At most one output per input so this can't overflow a local pipe.
+  while (pending() && ! data_loop_.buffering()) {
+    packet *const p = NERVE_CHECK_PTR(pending_[pending_begin_++]);
+    if (p->non_data()) {
+      this->non_data_step(stages(), p);
+    }
     else {
-      data_loop_.step();
-      return data_loop_.buffering() ? state::buffering : state::complete;
+      data_loop_.step(p);
     }
   }
-  else {
-    data_loop_.step();
-    return data_loop_.buffering() ? state::buffering : state::complete;
-  }
+
+  return this->current_state();
 }
 
+void process_stage_sequence::clear_pending() {
+  std::for_each(
+    pending_ + pending_begin_, pending_ + pending_end_,
+    boost::bind(&packet::release, _1)
+  );
+  pending_begin_ = pending_end_ = 0;
+}
 
+stage_sequence::step_state process_stage_sequence::current_state() {
+  typedef stage_sequence::state state;
+  return (data_loop_.buffering() || pending()) ? state::buffering : state::complete;
+}
@@ -24,7 +24,7 @@ namespace pipeline {
     // this object, so I don't think it's worth fixing it.  At least not until
     // the pipes are completely sorted out.
     process_stage_sequence()
-    : data_loop_(this->connection()) { }
+    : data_loop_(this->connection()), pending_begin_(0), pending_end_(0) { }
 
     simple_stage *create_stage(stage_sequence::stage_data_type &);
 
@@ -36,7 +36,23 @@ namespace pipeline {
 
     stages_type &stages() { return data_loop_.stages(); }
 
+    //! \name Input which was read but not yet processed.
+    //! A batch is read in one go but a buffering stage stops us from taking
+    //! more input, so the rest waits here.
+    //@{
+    bool pending() const { return pending_begin_ != pending_end_; }
+    //! Releases what's left.
+    void clear_pending();
+    //@}
+
+    //! Buffering if either the stages or the pending input is.
+    stage_sequence::step_state current_state();
+
     progressive_buffer data_loop_;
+
+    packet *pending_[max_batch];
+    std::size_t pending_begin_;
+    std::size_t pending_end_;
   };
 } // ns pipeline
 
@@ -4,18 +4,21 @@
 
 using namespace pipeline;
 
-void progressive_buffer::step() {
-  packet *input;
-  iterator_type real_start = start_;
+void progressive_buffer::step(packet *input) {
+  NERVE_ASSERT(! this->buffering(), "can't take new input while a stage is buffering");
+  this->run(this->stages().begin(), input);
+}
 
-  if (this->buffering()) {
-    ++real_start;
-    input = this->debuffer_input();
-  }
-  else {
-    input = this->read_input();
-  }
+void progressive_buffer::debuffer_step() {
+  NERVE_ASSERT(this->buffering(), "can't debuffer when nothing is buffering");
+  // Debuffering might pop the stage.
+  iterator_type real_start = buffering_.back();
+  ++real_start;
+  packet *const input = this->debuffer_input();
+  this->run(real_start, input);
+}
 
+void progressive_buffer::run(iterator_type real_start, packet *input) {
   const iterator_type end = stages().end();
 
   for (iterator_type s = real_start; s != end; ++s) {
@@ -27,14 +30,10 @@ void progressive_buffer::step() {
       return;
     }
     else if (ret.buffering()) {
-      // Simply assigning this every time we meet a buffering stage means we
-      // end up debuffering the latest stage which has stuff to debuffer.
-      //
-      // TODO:
-      //   This means we ignore any stage earlier in the sequence which is
-      //   buffering and therefore buffers expand when we push more data!  We
-      //   must use a stack to reduce our bufferingness.
-      start(s);
+      // We only ever run stages after the top of the stack so this keeps it
+      // in order and can't push the same stage twice.
+      NERVE_ASSERT(buffering_.size() < stages().size(), "buffering stack overflow");
+      buffering_.push_back(s);
     }
 
     input = ret.packet();
@@ -46,13 +45,12 @@ void progressive_buffer::step() {
 }
 
 packet *progressive_buffer::debuffer_input() {
-  const stage_value_type ret = this->start()->debuffer();
+  const stage_value_type ret = buffering_.back()->debuffer();
 
   NERVE_ASSERT(! ret.empty(), "empty data from a buffering stage is forbidden");
 
   if (! ret.buffering()) {
-    // TODO: pop iterator from stack
-    reset_start();
+    buffering_.pop_back();
   }
 
   return ret.packet();
@@ -13,6 +13,7 @@
 #include "../util/indirect.hpp"
 
 #include <algorithm>
+#include <vector>
 #include <boost/bind.hpp>
 #include <boost/type_traits/remove_pointer.hpp>
 
@@ -29,6 +30,11 @@ namespace pipeline {
    * - buffers don't expand (i.e if something is debuffering then no more input is
    *   added)
    *
+   * Buffering stages are kept on a stack in sequence order.  The top (the
+   * latest stage) is always debuffered first and its output goes through the
+   * stages after it, which may push themselves.  Only when the stack is empty
+   * is new input taken, so an earlier buffering stage is never given more.
+   *
    * The drawback is that there is overhead for stages which will only ever return
    * one or less packet.
    */
@@ -59,48 +65,54 @@ namespace pipeline {
      * TODO:
      *   Might be necessary to mess with the pipes here.
      */
-    void finalise() { this->reset_start(); }
+    void finalise() {
+      // So that pushing never allocates.
+      buffering_.reserve(stages().size());
+      buffering_.clear();
+    }
 
     //! This resets the progressive buffer (not the stages) for When the stages
     //! themselves will be abandoned.  This means all the buffers will be empty, so
     //! we need to go to the start again.
-    void abandon_reset() { this->reset_start(); }
+    void abandon_reset() { buffering_.clear(); }
 
     //! Is there a buffering stage here?
-    bool buffering() { return this->start() != this->stages().begin(); }
+    bool buffering() const { return ! buffering_.empty(); }
 
     /*!
-     * Perform an iteration of the stages where no stage is visited twice (but
-     * some might be unvisited).  Pulls data from the input queue only when
-     * necessary.
+     * Perform an iteration of the stages with a new input packet.  No stage is
+     * visited twice (but some might be unvisited).  Must not be called while
+     * buffering because that would make the buffers expand.
      */
-    void step();
+    void step(packet *input);
+
+    //! Perform an iteration starting after the latest buffering stage, using
+    //! whatever it debuffers as the input.
+    void debuffer_step();
 
     //! Stored stages.  Stages are stored here so we can control the iterators.
     stages_type &stages() { return stages_; }
 
     private:
 
-    //! Iterator state
-    //@{
-    iterator_type start() const { return start_; }
-    void start(iterator_type i) { start_ = i; }
-    void reset_start() { start(this->stages().begin()); };
-    //@}
+    typedef std::vector<iterator_type> stack_type;
 
     //! Input/output
     //@{
 
-    //! Also resets buffering stage next time if necessary.
+    //! Run the stages from s onwards.
+    void run(iterator_type s, packet *input);
+
+    //! Also pops the buffering stage if it's finished.
     packet *debuffer_input();
-    packet *read_input() { return conn_.read_input(); }
     void write_output(packet *p) { conn_.write_output(p); }
 
     //@}
 
     polymorphic_connection &conn_;
     stages_type stages_;
-    iterator_type start_;
+    //! Buffering stages in sequence order.
+    stack_type buffering_;
   };
 
 } //ns pipeline
@@ -12,7 +12,9 @@ using namespace pipeline;
 void section::finalise() {
   NERVE_ASSERT(! sequences().empty(), "there must be some sequences");
   std::for_each(sequences().begin(), sequences().end(), boost::bind(&stage_sequence::finalise, _1));
-  reset_start();
+  // So that pushing never allocates.
+  buffering_.reserve(sequences().size());
+  buffering_.clear();
 }
 
 namespace {
@@ -54,27 +56,27 @@ stage_sequence *section::create_sequence(stages::category_type c, pipe_type *in,
 
 void section::section_step() {
   NERVE_ASSERT(! sequences().empty(), "can't loop an empty section")
-  bool do_reset = true;
   typedef sequence_type::state state;
 
-  for (iterator_type s = start(); s != this->sequences().end(); ++s) {
+  const iterator_type first = buffering_.empty() ? sequences().begin() : buffering_.back();
+
+  for (iterator_type s = first; s != this->sequences().end(); ++s) {
     // See class docs for why this is the least bad solution.
     sequence_type::step_state ret = s->sequence_step();
+    const bool on_top = ! buffering_.empty() && buffering_.back() == s;
 
     if (ret == state::buffering) {
-      // TODO:
-      //   If there are multiple sequences doing buffering, then we ignore one
-      //   of them here.  There needs to be a stack of iterators.
-      start(s);
-      do_reset = false;
+      // Only sequences from the top onwards are stepped so the stack stays in
+      // order.
+      if (! on_top) {
+        buffering_.push_back(s);
+      }
     }
     else {
       NERVE_ASSERT(ret == state::complete, "there are no other possibilities");
+      if (on_top) {
+        buffering_.pop_back();
+      }
     }
   }
-
-  if (do_reset) {
-    reset_start();
-  }
 }
-
@@ -11,6 +11,7 @@
 #include "../stages/information.hpp"
 #include "../util/indirect.hpp"
 #include <boost/type_traits/remove_pointer.hpp>
+#include <vector>
 
 namespace pipeline {
   /*!
@@ -48,8 +49,9 @@ namespace pipeline {
    *
    * The result is that for every sequence there is a virtual call to write
    * output, but but we don't need to do a buffering/no-return check or event
-   * check.  We can't optimise out the polymorphic pipe here because it can be a
-   * terminator.
+   * check.  Sequences move packets in batches (see max_batch) so the virtual
+   * call and any locking is paid per batch rather than per packet.  We can't
+   * optimise out the polymorphic pipe here because it can be a terminator.
    */
   class section {
     public:
@@ -84,6 +86,11 @@ namespace pipeline {
       return &thread_pipe_;
     }
 
+    //! The thread pipe from create_thread_pipe, or null if it was never made.
+    thread_pipe *owned_thread_pipe() {
+      return thread_pipe_allocated_ ? &thread_pipe_ : NULL;
+    }
+
     //! Called post-initialisation to ready everything for running.  Iow no more
     //! sequences to add.
     void finalise();
@@ -93,6 +100,7 @@ namespace pipeline {
     //! \name Operation
     //@{
 
+    //! Would a step wait for input?  Never waits itself.
     bool would_block() {
       return
         ! buffering_sequence() &&
@@ -102,11 +110,14 @@ namespace pipeline {
         //
         // TODO:
         //   The above might be wrong.
-        //
-        // TODO:
-        //   Unspecified for now because it depends on pipes.
-        // NERVE_CHECK_PTR(*start())->input_pipe().would_block()
-        false;
+        ! NERVE_CHECK_PTR(conn_.in())->readable();
+    }
+
+    //! Can a step finish without waiting on its input or its output?  A step
+    //! writes at most one batch out.  For when nothing may wait at all, e.g
+    //! the executor.
+    bool runnable() {
+      return ! would_block() && NERVE_CHECK_PTR(conn_.out())->writable(max_batch);
     }
 
     //! Operational part.
@@ -119,13 +130,13 @@ namespace pipeline {
 
     typedef sequences_type::iterator iterator_type;
 
-    bool buffering_sequence() { return start() == sequences().begin(); }
-
-    void reset_start() { start_ = sequences().begin(); }
-    void start(iterator_type i) { start_ = i; }
-    iterator_type start() { return start_; }
+    //! A sequence is part way through something so we don't need input.
+    bool buffering_sequence() const { return ! buffering_.empty(); }
 
-    iterator_type start_;
+    //! Buffering sequences in order.  The latest is stepped first and only
+    //! when there are none does the section take more input.  This is the
+    //! same as the progressive_buffer does with stages.
+    std::vector<iterator_type> buffering_;
     sequences_type sequences_;
 
     bool thread_pipe_allocated_;
@@ -32,7 +32,8 @@ namespace pipeline {
 
   /*!
    * \ingroup grp_pipeline
-   * A stage which can do anything with the packet.
+   * A stage which can do anything with the packet.  A packet which is not
+   * returned (now or from a later debuffer) must be released.
    */
   class process_stage : public simple_stage {
     public:
@@ -65,10 +66,23 @@ namespace pipeline {
     typedef const char * load_type;
 
     virtual void pause() = 0;
+    //! Null is the end of the current track, which goes on to the cued track
+    //! or finishes.  Nothing else is supported yet.
     virtual void skip(skip_type location) = 0;
     virtual void load(load_type where) = 0;
-    virtual packet *read() = 0;
+    //! The track after the current one.  It should follow on without a gap
+    //! instead of finishing.  Another cue replaces it and a load forgets it.
+    virtual void cue(load_type next) = 0;
+    //! Fill a fresh packet (from the pipeline's pool) with the next data and
+    //! return it.  A stage which already has the data in a packet from the
+    //! same pool can release the fresh one and return that instead.
+    virtual packet *read(packet *) = 0;
     virtual void finish() = 0;
+    //! Nothing loaded and nothing left to say about the last track, so read
+    //! would only give an empty packet.  The start terminator doesn't ask
+    //! for data while this is true.  Stages which can't tell are always
+    //! asked.
+    virtual bool idle() const { return false; }
   };
 }
 #endif
@@ -74,6 +74,7 @@ namespace pipeline {
 
     // Calls relevant methods for a non-data event and then propogates the packet.
     // Constant delay is always enforced because special events don't do anything.
+    // Only wipe packets jump the output queue; the others stay in order.
     template<class Container>
     void non_data_step(const Container &c, packet *pkt) {
       typedef typename Container::value_type value_type;
@@ -93,7 +94,12 @@ namespace pipeline {
         break;
       }
 
-      write_output_wipe(pkt);
+      if (pkt->wipe()) {
+        write_output_wipe(pkt);
+      }
+      else {
+        write_output(pkt);
+      }
     }
 
     //! Input/output convenience
@@ -101,6 +107,8 @@ namespace pipeline {
 
     packet *read_input() { return connection_.read_input(); }
     void write_output(packet *p) { connection_.write_output(p); }
+    std::size_t read_input_batch(packet **out, std::size_t max) { return connection_.read_input_batch(out, max); }
+    void write_output_batch(packet *const *ps, std::size_t n) { connection_.write_output_batch(ps, n); }
     void write_output_wipe(packet *p) { connection_.write_output_wipe(p); }
 
     //@}
@@ -0,0 +1,130 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "terminators.hpp"
+
+#include "../util/asserts.hpp"
+
+#include <cstring>
+
+using namespace pipeline;
+
+const std::size_t start_terminator::max_load_path;
+
+start_terminator::start_terminator()
+: pending_(false), idle_(true), reader_waker_(NULL), load_waiting_(false), load_length_(0),
+  cue_waiting_(false), cue_length_(0), skip_waiting_(false), skip_location_(NULL)
+{
+  data_packet_.event(packet::event::data);
+  load_packet_.event(packet::event::load);
+  cue_packet_.event(packet::event::cue);
+  skip_packet_.event(packet::event::skip);
+}
+
+bool start_terminator::post_load(const char *path, std::size_t length) {
+  NERVE_ASSERT_PTR(path);
+  if (length >= max_load_path) {
+    return false;
+  }
+
+  {
+    lock_type lk(mutex_);
+    std::memcpy(load_path_, path, length);
+    load_path_[length] = '\0';
+    load_length_ = length;
+    load_waiting_ = true;
+    cue_waiting_ = false;
+    skip_waiting_ = false;
+    pending_.store(true, boost::memory_order_release);
+  }
+  this->wake_reader();
+  return true;
+}
+
+bool start_terminator::post_cue(const char *path, std::size_t length) {
+  NERVE_ASSERT_PTR(path);
+  if (length >= max_load_path) {
+    return false;
+  }
+
+  {
+    lock_type lk(mutex_);
+    std::memcpy(cue_path_, path, length);
+    cue_path_[length] = '\0';
+    cue_length_ = length;
+    cue_waiting_ = true;
+    pending_.store(true, boost::memory_order_release);
+  }
+  this->wake_reader();
+  return true;
+}
+
+void start_terminator::post_skip(skip_type location) {
+  {
+    lock_type lk(mutex_);
+    skip_location_ = location;
+    skip_waiting_ = true;
+    pending_.store(true, boost::memory_order_release);
+  }
+  this->wake_reader();
+}
+
+packet *start_terminator::read() {
+  if (! pending_.load(boost::memory_order_acquire)) {
+    return &data_packet_;
+  }
+
+  lock_type lk(mutex_);
+  packet *const p = this->take_event();
+  pending_.store(load_waiting_ || cue_waiting_ || skip_waiting_, boost::memory_order_relaxed);
+  return p ? p : &data_packet_;
+}
+
+packet *start_terminator::take_event() {
+  if (load_waiting_) {
+    load_waiting_ = false;
+    // The packet's storage is enough for any path.
+    unsigned char *const to = load_packet_.storage();
+    std::memcpy(to, load_path_, load_length_ + 1);
+    load_packet_.payload().clear();
+    load_packet_.payload().data(to, load_length_ + 1);
+    return &load_packet_;
+  }
+  else if (cue_waiting_) {
+    cue_waiting_ = false;
+    unsigned char *const to = cue_packet_.storage();
+    std::memcpy(to, cue_path_, cue_length_ + 1);
+    cue_packet_.payload().clear();
+    cue_packet_.payload().data(to, cue_length_ + 1);
+    return &cue_packet_;
+  }
+  else if (skip_waiting_) {
+    skip_waiting_ = false;
+    skip_packet_.payload().clear();
+    skip_packet_.payload().data(skip_location_, 0);
+    return &skip_packet_;
+  }
+
+  return NULL;
+}
+
+void end_terminator::record(const packet *p) {
+  switch (p->event()) {
+  case packet::event::data:
+    {
+      const payload &pl = p->payload();
+      const unsigned int rate = pl.format().rate();
+      if (pl.content() == payload_content::samples && ! pl.empty() && rate) {
+        status_.played(pl.timestamp() + (payload::timestamp_type) pl.frames() * 1000000 / rate);
+      }
+    }
+    break;
+  case packet::event::abandon:
+    status_.abandoned();
+    break;
+  case packet::event::finish:
+    status_.finished();
+    break;
+  default:
+    break;
+  }
+}
@@ -6,54 +6,195 @@
 
 #include "ipc.hpp"
 #include "packet.hpp"
+#include "play_status.hpp"
+#include "simple_stages.hpp"
+#include "thread_pipe.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cstddef>
 
 namespace pipeline {
   struct packet;
 
-  //! \ingroup grp_pipeline
-  //! Starts the pipeline.
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * Starts the pipeline.  The packets read from here are requests to the
+   * input sequence and still belong to the terminator; the input sequence
+   * sends on new packets from the pool instead.
+   *
+   * When nothing else is waiting the request is always for more data.
+   * Control events are posted from any thread (i.e server sessions) and are
+   * read before data.  There's one slot for each kind of event rather than a
+   * queue, so events coalesce while they wait:
+   *
+   * - a load replaces any waiting load and throws away any waiting skip or
+   *   cue, because they were meant for the old track;
+   * - a cue replaces any waiting cue, and so does a skip for skips;
+   * - a load is read before a cue or a skip, so ones posted after a load
+   *   are applied to the new track.
+   *
+   * The data path only looks at an atomic flag; the lock is taken when there
+   * is an event.
+   *
+   * While the input stage has nothing loaded there's no point asking it for
+   * data, so the terminator isn't readable until an event is posted, which
+   * also wakes the reading job.
+   */
   class start_terminator : public pipe {
     public:
-    start_terminator() {
-      dummy_packet_.event(packet::event::data);
-    }
+    typedef input_stage::skip_type skip_type;
+
+    //! Longest path which can be loaded, including the terminator.
+    static const std::size_t max_load_path = 4096;
+
+    start_terminator();
+
+    //! The first section's job (or the executor).  Must be done before the
+    //! pipeline runs.
+    void reader_waker(job_waker *w) { reader_waker_ = w; }
+
+    //! The input stage has nothing to read.  Only the reading thread, after
+    //! each request.
+    void idle(bool i) { idle_.store(i, boost::memory_order_release); }
+
+    //! \name Posting events
+    //! Any thread.
+    //@{
+
+    //! Copies the path.  False if it's too long.
+    bool post_load(const char *path, std::size_t length);
+    //! As post_load.
+    bool post_cue(const char *path, std::size_t length);
+    void post_skip(skip_type location);
+
+    //@}
 
     void write(packet *) { do_write(); }
     void write_wipe(packet *) { do_write(); }
 
-    packet *read() {
-      return &dummy_packet_;
+    packet *read();
+
+    //! Events are read one at a time so a batch is only ever one request.
+    std::size_t read_batch(packet **out, std::size_t max) {
+      NERVE_ASSERT(max > 0, "batch reads must have room for something");
+      *out = this->read();
+      return 1;
+    }
+
+    void write_batch(packet *const *, std::size_t) { do_write(); }
+
+    packet *read_wipe() { return NULL; }
+
+    //! There's a request when an event is waiting or something is loaded.
+    bool readable() {
+      return pending_.load(boost::memory_order_acquire) || ! idle_.load(boost::memory_order_acquire);
+    }
+
+    bool writable(std::size_t) {
+      do_write();
+      return false;
     }
 
     private:
+    typedef boost::mutex mutex_type;
+    typedef mutex_type::scoped_lock lock_type;
+
     void do_write() { NERVE_ABORT("can't write to the start terminator"); }
 
-    // TODO:
-    //   Almost certainly want something else here because the input stage might
-    //   mess up the packet.
-    //
-    //   Also, I can control the input stage more effectively if there is more
-    //   direct access.  If the input sequence knew about the input terminator
-    //   then it'd be easier...
-    packet dummy_packet_;
+    //! After an event is posted, without the lock.
+    void wake_reader() {
+      if (reader_waker_) {
+        reader_waker_->unpark();
+      }
+    }
+
+    //! Lock must be held.  The next request, or null.
+    packet *take_event();
+
+    mutex_type mutex_;
+    //! Set when any slot is full.
+    boost::atomic<bool> pending_;
+    //! What the input sequence last said.  Starts set since nothing's loaded.
+    boost::atomic<bool> idle_;
+    job_waker *reader_waker_;
+
+    //! \name Slots
+    //! Protected by the lock.
+    //@{
+    bool load_waiting_;
+    std::size_t load_length_;
+    char load_path_[max_load_path];
+    bool cue_waiting_;
+    std::size_t cue_length_;
+    char cue_path_[max_load_path];
+    bool skip_waiting_;
+    skip_type skip_location_;
+    //@}
+
+    //! \name Requests
+    //! The input sequence is finished with a request before it reads
+    //! another, so these are only touched by the reading thread.
+    //@{
+    packet data_packet_;
+    packet load_packet_;
+    packet cue_packet_;
+    packet skip_packet_;
+    //@}
   };
 
   //! \ingroup grp_pipeline
-  //! Ends the pipeline and frees packets.
+  //! Ends the pipeline and gives packets back to their pool.  What goes past
+  //! is recorded in the play status.
   class end_terminator : public pipe {
     public:
-    void write(packet *) { do_write(); }
-    void write_wipe(packet *) { do_write(); }
+    void write(packet *p) {
+      this->record(NERVE_CHECK_PTR(p));
+      p->release();
+    }
+
+    void write_wipe(packet *p) {
+      this->record(NERVE_CHECK_PTR(p));
+      p->release();
+    }
 
     packet *read() {
       NERVE_ABORT("can't read from the end terminator");
       return NULL;
     }
 
-    private:
-    void do_write() {
-      NERVE_NIMPL("freeing end-terminator packets");
+    std::size_t read_batch(packet **, std::size_t) {
+      NERVE_ABORT("can't read from the end terminator");
+      return 0;
     }
+
+    packet *read_wipe() {
+      NERVE_ABORT("can't read from the end terminator");
+      return NULL;
+    }
+
+    bool readable() {
+      NERVE_ABORT("can't read from the end terminator");
+      return false;
+    }
+
+    void write_batch(packet *const *in, std::size_t n) {
+      std::for_each(in, in + n, boost::bind(&end_terminator::write, this, _1));
+    }
+
+    //! Writes only release so they never wait.
+    bool writable(std::size_t) { return true; }
+
+    const play_status &status() const { return status_; }
+
+    private:
+    void record(const packet *p);
+
+    play_status status_;
   };
 }
 
@@ -0,0 +1,109 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#include "thread_attributes.hpp"
+
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#endif
+
+using pipeline::thread_attributes;
+
+namespace {
+  int posix_policy(thread_attributes::policy_type p) {
+    switch (p) {
+    case thread_attributes::policy::fifo: return SCHED_FIFO;
+    case thread_attributes::policy::rr: return SCHED_RR;
+    case thread_attributes::policy::other: return SCHED_OTHER;
+    case thread_attributes::policy::inherit:
+      NERVE_ABORT("inherit has no posix policy");
+    }
+    NERVE_ABORT("should be impossible to get here");
+  }
+}
+
+const char *thread_attributes::policy_name(policy_type p) {
+  switch (p) {
+  case policy::fifo: return "fifo";
+  case policy::rr: return "rr";
+  case policy::other: return "other";
+  case policy::inherit: return "inherit";
+  }
+  NERVE_ABORT("should be impossible to get here");
+}
+
+int thread_attributes::min_priority(policy_type p) {
+  return p == policy::inherit ? 0 : sched_get_priority_min(posix_policy(p));
+}
+
+int thread_attributes::max_priority(policy_type p) {
+  return p == policy::inherit ? 0 : sched_get_priority_max(posix_policy(p));
+}
+
+std::size_t thread_attributes::min_stack_size() {
+  return PTHREAD_STACK_MIN;
+}
+
+std::size_t thread_attributes::cpus_available() {
+  const long n = sysconf(_SC_NPROCESSORS_CONF);
+  return n > 0 ? (std::size_t) n : 0;
+}
+
+void thread_attributes::apply(output::logger &log) const {
+  if (cpus_.any()) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::size_t i = 0; i < max_cpus && i < CPU_SETSIZE; ++i) {
+      if (cpus_.test(i)) {
+        CPU_SET(i, &set);
+      }
+    }
+
+    const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+      log.error("couldn't set thread affinity: %s\n", std::strerror(err));
+    }
+#else
+    log.warn("thread affinity isn't supported on this platform\n");
+#endif
+  }
+
+  // Before the policy because a realtime thread ignores it anyway.
+  if (nice_given_) {
+#ifdef __linux__
+    // Linux's nice is per-thread if you give it a thread id.
+    if (setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), nice_) != 0) {
+      log.error("couldn't set thread nice level to %d: %s\n", nice_, std::strerror(errno));
+    }
+#else
+    log.warn("per-thread nice levels aren't supported on this platform\n");
+#endif
+  }
+
+  if (policy_ != policy::inherit) {
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = priority_given_ ? priority_ : min_priority(policy_);
+
+    const int err = pthread_setschedparam(pthread_self(), posix_policy(policy_), &param);
+    if (err != 0) {
+      log.error(
+        "couldn't set thread scheduler to %s with priority %d: %s\n",
+        policy_name(policy_), param.sched_priority, std::strerror(err)
+      );
+    }
+  }
+}
@@ -0,0 +1,101 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#ifndef PIPELINE_THREAD_ATTRIBUTES_HPP_t2hvx6pa
+#define PIPELINE_THREAD_ATTRIBUTES_HPP_t2hvx6pa
+
+#include <bitset>
+#include <cstddef>
+
+namespace output { class logger; }
+
+namespace pipeline {
+  /*!
+   * \ingroup grp_pipeline
+   *
+   * How the OS should schedule a job's thread.  Anything which isn't given is
+   * inherited from the daemon.  The stack size is used when the thread is made
+   * and the rest is applied by the thread itself when it starts.
+   */
+  class thread_attributes {
+    public:
+    //! Highest CPU number plus one which can be given.
+    static const std::size_t max_cpus = 1024;
+    typedef std::bitset<max_cpus> cpu_set_type;
+
+    //! A namespace for the scheduling policy enum.
+    struct policy {
+      enum id {
+        inherit,
+        other,
+        fifo,
+        rr
+      };
+    };
+
+    typedef policy::id policy_type;
+
+    thread_attributes()
+    : policy_(policy::inherit), priority_(0), priority_given_(false),
+      nice_(0), nice_given_(false), stack_size_(0)
+    {}
+
+    //! Is there anything to do at all?
+    bool given() const {
+      return cpus_.any() || policy_ != policy::inherit || priority_given_ || nice_given_ || stack_size_;
+    }
+
+    //! \name Attributes
+    //@{
+
+    //! CPUs the thread may run on.  None means any.
+    cpu_set_type &cpus() { return cpus_; }
+    const cpu_set_type &cpus() const { return cpus_; }
+
+    policy_type policy() const { return policy_; }
+    void policy(policy_type p) { policy_ = p; }
+
+    //! Realtime priority.  Only means anything for fifo and rr.
+    int priority() const { return priority_; }
+    bool priority_given() const { return priority_given_; }
+    void priority(int p) { priority_ = p; priority_given_ = true; }
+
+    int nice() const { return nice_; }
+    bool nice_given() const { return nice_given_; }
+    void nice(int n) { nice_ = n; nice_given_ = true; }
+
+    //! In bytes.  Zero means the default.
+    std::size_t stack_size() const { return stack_size_; }
+    void stack_size(std::size_t s) { stack_size_ = s; }
+
+    //@}
+
+    //! \name Limits
+    //! What the system allows, for checking the config.
+    //@{
+    static int min_priority(policy_type);
+    static int max_priority(policy_type);
+    static std::size_t min_stack_size();
+    //! Number of CPUs which exist, or zero if we can't tell.
+    static std::size_t cpus_available();
+    //@}
+
+    //! Apply everything except the stack size to the calling thread.  A
+    //! failure (usually permissions for realtime policies) is logged and the
+    //! thread carries on as it was.
+    void apply(output::logger &) const;
+
+    static const char *policy_name(policy_type);
+
+    private:
+    cpu_set_type cpus_;
+    policy_type policy_;
+    int priority_;
+    bool priority_given_;
+    int nice_;
+    bool nice_given_;
+    std::size_t stack_size_;
+  };
+}
+
+#endif
@@ -5,6 +5,8 @@
 #define PIPELINE_THREAD_PIPE_HPP_gargmedd
 
 #include "ipc.hpp"
+#include "packet.hpp"
+#include "../defines.hpp"
 #include "../util/asserts.hpp"
 #include "../para/pipes.hpp"
 
@@ -14,23 +16,110 @@ namespace pipeline {
   struct packet;
 
   //! \ingroup grp_pipeline
-  //! Thread-safe buffer.
+  //! What a job sleeps on when none of its sections can run.  Thread pipes
+  //! wake their reading job's waker whenever they are written to.
+  typedef para::parking_sync<boost::condition_variable, boost::mutex> job_waker;
+
+  //! \ingroup grp_pipeline
+  //! Thread-safe buffer.  There is always exactly one writing job and one
+  //! reading job so by default this is a lock-free ring.  See
+  //! NERVED_LOCKING_PIPES.
+  //!
+  //! A wipe empties the queue and puts its packet in a one-slot priority lane
+  //! so that the reader gets it before anything else and can check for it
+  //! (read_wipe) without waiting or locking.
   class thread_pipe : public pipe {
     public:
 
-    thread_pipe() {}
+    thread_pipe() : reader_waker_(NULL), writer_waker_(NULL) {}
+
+    //! The reading job's waker.  Must be done before the pipe is used.
+    void reader_waker(job_waker *w) { reader_waker_ = w; }
+
+    //! Woken after every read.  Only needed when the writer doesn't wait in
+    //! the pipe itself (see executor).  Must be done before the pipe is used.
+    void writer_waker(job_waker *w) { writer_waker_ = w; }
+
+    //! Set the size and watermarks.  Must be done before the pipe is used.
+    void limits(const para::pipe_limits &l) {
+      NERVE_ASSERT(l.valid(), "pipe limits must be validated before they get here");
+      p_.limits(l);
+    }
+
+    const para::pipe_limits &limits() const { return p_.limits(); }
+
+    //! Can be more than limits().capacity().
+    std::size_t capacity() const { return p_.capacity(); }
+
+    void write(packet *p) {
+      p_.write(p);
+      wake_reader();
+    }
+
+    void write_wipe(packet *p) {
+      p_.write_priority(p);
+      wake_reader();
+    }
 
-    void write(packet *p) { p_.write(p); }
-    void write_wipe(packet *p) { p_.write_clear(p); }
-    packet *read() { return p_.read(); }
+    void write_batch(packet *const *in, std::size_t n) {
+      p_.write_batch(in, in + n);
+      wake_reader();
+    }
+
+    packet *read() {
+      packet *const p = p_.read();
+      wake_writer();
+      return p;
+    }
+
+    std::size_t read_batch(packet **out, std::size_t max) {
+      const std::size_t n = p_.read_batch(out, max);
+      wake_writer();
+      return n;
+    }
+
+    bool readable() { return p_.readable(); }
+    bool writable(std::size_t n) { return p_.writable(n); }
+
+    packet *read_wipe() {
+      packet *p = NULL;
+      p_.try_read_priority(p);
+      return p;
+    }
 
     private:
 
+    void wake_reader() {
+      if (reader_waker_) {
+        reader_waker_->unpark();
+      }
+    }
+
+    void wake_writer() {
+      if (writer_waker_) {
+        writer_waker_->unpark();
+      }
+    }
+
+    //! Packets dropped by a wipe go back to the pool.
+    struct release_discarded {
+      void operator()(packet *p) const { NERVE_CHECK_PTR(p)->release(); }
+    };
+
     typedef boost::condition_variable condition_type;
     typedef boost::mutex lockable_type;
+
+#if NERVED_LOCKING_PIPES
     typedef para::basic_monitor_sync<condition_type, lockable_type> boost_sync_type;
+    typedef para::simple_queue_selector queue_selector_type;
+#else
+    typedef para::parking_sync<condition_type, lockable_type> boost_sync_type;
+    typedef para::ring_queue_selector queue_selector_type;
+#endif
 
-    para::pipe<packet*, boost_sync_type> p_;
+    para::pipe<packet*, boost_sync_type, queue_selector_type, release_discarded> p_;
+    job_waker *reader_waker_;
+    job_waker *writer_waker_;
   };
 }
 
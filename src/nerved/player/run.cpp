@@ -3,33 +3,76 @@
 #include "run.hpp"
 
 #include "../pipeline/pipeline_data.hpp"
+#include "../pipeline/executor.hpp"
+#include "../cli/settings.hpp"
 #include "../server/local_server.hpp"
 #include "../output/logging.hpp"
 
 #include <boost/asio/io_service.hpp>
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
 
 using pipeline::pipeline_data;
 
-player::run_status player::run(pipeline::pipeline_data &pl, const cli::settings &) {
+namespace {
+  //! One of the server's threads.  An exception stops all of them.
+  void serve(boost::asio::io_service &io_service, boost::atomic<bool> &failed) {
+    try {
+      io_service.run();
+    }
+    catch (std::exception &e) {
+      output::logger log(output::source::server);
+      log.error("%s\n", e.what());
+      failed.store(true);
+      io_service.stop();
+    }
+  }
+}
+
+player::run_status player::run(pipeline::pipeline_data &pl, const cli::settings &settings) {
   output::logger log(output::source::player);
   log.trace("player starting\n");
 
   boost::asio::io_service io_service;
-  const char *const file = "/tmp/nerve.socket";
-  std::remove(file);
-  server::local_server server(io_service, file);
+  server::local_server server(io_service, settings.socket(), *pl.start_terminator(), pl.controls(), pl.status());
 
+  boost::scoped_ptr<pipeline::executor> executor;
   boost::thread_group threads;
   typedef pipeline_data::jobs_type::iterator iter_type;
-  for (iter_type i = pl.jobs().begin(); i != pl.jobs().end(); ++i) {
-    threads.create_thread(boost::bind(&pipeline::job::job_thread, boost::ref(*i)));
+  if (settings.workers()) {
+    log.trace("running sections on %u workers\n", settings.workers());
+    for (iter_type i = pl.jobs().begin(); i != pl.jobs().end(); ++i) {
+      if (i->attributes().given()) {
+        log.warn("thread attributes are ignored when sections run on workers\n");
+        break;
+      }
+    }
+
+    executor.reset(new pipeline::executor(pl, settings.workers()));
+    executor->start(threads);
+  }
+  else {
+    for (iter_type i = pl.jobs().begin(); i != pl.jobs().end(); ++i) {
+      // The stack has to be given now.  The job does the rest itself.
+      boost::thread::attributes attrs;
+      if (i->attributes().stack_size()) {
+        attrs.set_stack_size(i->attributes().stack_size());
+      }
+      threads.add_thread(new boost::thread(attrs, boost::bind(&pipeline::job::job_thread, boost::ref(*i))));
+    }
   }
 
-  try {
-    io_service.run();
+  // This thread is one of them.
+  log.trace("serving on %u threads\n", settings.server_threads());
+  boost::atomic<bool> failed(false);
+  boost::thread_group server_threads;
+  for (unsigned i = 1; i < settings.server_threads(); ++i) {
+    server_threads.create_thread(boost::bind(&serve, boost::ref(io_service), boost::ref(failed)));
   }
-  catch (std::exception &e) {
-    log.error("%s\n", e.what());
+  serve(io_service, failed);
+  server_threads.join_all();
+
+  if (failed.load()) {
     return run_fail;
   }
 
@@ -3,33 +3,159 @@
 
 #include "local_server.hpp"
 
+#include "../util/asserts.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
 using namespace server;
 
-local_server::local_server(boost::asio::io_service &io_service, const char *file)
+namespace {
+  //! The address of the socket called name.
+  std::string address_of(const char *name) {
+    NERVE_ASSERT_PTR(name);
+    if (name[0] == '@') {
+#ifdef __linux__
+      return std::string(1, '\0') + (name + 1);
+#else
+      output::logger log(output::source::server);
+      log.warn("abstract sockets are only on Linux so '%s' will be a file\n", name);
+#endif
+    }
+    return name;
+  }
+
+  bool is_file(const std::string &address) {
+    return ! address.empty() && address[0] != '\0';
+  }
+
+  //! Only a socket is removed.  Anything else is left for the bind to fail
+  //! on, so a mistyped name can't delete a file.
+  void remove_socket(const char *path) {
+    struct stat st;
+    if (::lstat(path, &st) != 0) {
+      return;
+    }
+
+    if (S_ISSOCK(st.st_mode)) {
+      ::unlink(path);
+    }
+    else {
+      output::logger log(output::source::server);
+      log.error("%s exists and isn't a socket\n", path);
+    }
+  }
+
+  boost::asio::local::stream_protocol::endpoint bind_point(const std::string &address) {
+    // Otherwise a daemon which didn't exit cleanly stops the bind.
+    if (is_file(address)) {
+      remove_socket(address.c_str());
+    }
+    return boost::asio::local::stream_protocol::endpoint(address);
+  }
+}
+
+local_server::local_server(
+  boost::asio::io_service &io_service, const char *name,
+  pipeline::start_terminator &inbox, pipeline::controls &controls,
+  const pipeline::play_status &status
+)
 : io_service_(io_service),
-  acceptor_(io_service, stream_protocol::endpoint(file)),
-  log_(output::source::server)
+  strand_(io_service),
+  address_(address_of(name)),
+  acceptor_(io_service, bind_point(address_)),
+  inbox_(inbox),
+  controls_(controls),
+  publisher_(io_service, status),
+  log_(output::source::server),
+  created_(false)
 {
+  if (is_file(address_)) {
+    // So we know the one to remove is still ours.
+    struct stat st;
+    if (::lstat(address_.c_str(), &st) == 0) {
+      created_ = true;
+      device_ = st.st_dev;
+      inode_ = st.st_ino;
+    }
+    log_.trace("listening on %s\n", address_.c_str());
+  }
+  else {
+    log_.trace("listening on abstract socket @%s\n", address_.c_str() + 1);
+  }
+
+#ifndef SO_PEERCRED
+  log_.warn("peer credentials can't be checked here so anyone who can open the socket gets a session\n");
+#endif
+
   async_accept();
 }
 
+local_server::~local_server() {
+  if (! created_) {
+    return;
+  }
+
+  // Another daemon might have replaced it since.
+  struct stat st;
+  if (::lstat(address_.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) && st.st_dev == device_ && st.st_ino == inode_) {
+    ::unlink(address_.c_str());
+  }
+}
+
 void local_server::handle_accept(session_ptr new_session, const boost::system::error_code &error) {
   if (error) {
     log_.error("accept error: %s\n", error.message().c_str());
   }
+  else if (! this->check_peer(new_session->socket())) {
+    // Dropping the session closes it.
+    boost::system::error_code ignored;
+    new_session->socket().close(ignored);
+  }
   else {
+    // The session goes to its own strand from here.
     new_session->start();
   }
   async_accept();
 }
 
 void local_server::async_accept() {
-  session_ptr new_session(session::create_shared(io_service_));
+  session_ptr new_session(session::create_shared(io_service_, inbox_, controls_, publisher_));
   acceptor_.async_accept(
     new_session->socket(),
-    boost::bind(
-      &local_server::handle_accept, this, new_session,
-      boost::asio::placeholders::error
+    strand_.wrap(
+      boost::bind(
+        &local_server::handle_accept, this, new_session,
+        boost::asio::placeholders::error
+      )
     )
   );
 }
+
+bool local_server::check_peer(stream_protocol::socket &s) {
+#ifdef SO_PEERCRED
+  // The kernel fills this in at connect so it's one call and no round trip.
+  struct ucred cred;
+  socklen_t length = sizeof(cred);
+  if (::getsockopt(s.native_handle(), SOL_SOCKET, SO_PEERCRED, &cred, &length) != 0) {
+    log_.error("can't get the peer's credentials: %s\n", std::strerror(errno));
+    return false;
+  }
+
+  if (cred.uid != 0 && cred.uid != ::geteuid()) {
+    log_.warn("refused a connection from uid %u (pid %d)\n", (unsigned) cred.uid, (int) cred.pid);
+    return false;
+  }
+
+  log_.trace("connection from pid %d\n", (int) cred.pid);
+#else
+  // Warned about at startup.
+  (void) s;
+#endif
+  return true;
+}
@@ -4,6 +4,7 @@
 #define SERVER_SOCKET_SERVER_HPP_eamnxrbl
 
 #include "session.hpp"
+#include "publisher.hpp"
 #include "../output/logging.hpp"
 
 #include <boost/system/system_error.hpp>
@@ -11,13 +12,28 @@
 #include <boost/bind.hpp>
 #include <boost/utility.hpp>
 
+#include <sys/types.h>
+
 #include <string>
 #include <iostream>
 #include <cstdio>
 
 namespace server {
   //! \ingroup grp_server
-  //! Tracks connected clients using the session object.
+  //! Tracks connected clients using the session object.  Sessions send their
+  //! commands to the pipeline through its start terminator and get the play
+  //! status from its publisher.
+  //!
+  //! Any number of threads can run the io_service.  Accepting goes through
+  //! the server's strand and each session has its own.
+  //!
+  //! The socket is a file unless its name starts with "@", which puts it in
+  //! Linux's abstract namespace instead.  Abstract sockets have no file to
+  //! look up, clean up or collide with, but nor do they have file
+  //! permissions, so every connection's peer credentials are checked when
+  //! it's accepted: only the daemon's own user and root get a session.
+  //! Where there's no SO_PEERCRED nothing is checked, which is warned about
+  //! at startup.
   class local_server : boost::noncopyable {
     // This class is originally based on example code which is part of the boost
     // ASIO library.
@@ -31,7 +47,14 @@ namespace server {
     typedef boost::asio::local::stream_protocol stream_protocol;
 
     public:
-    local_server(boost::asio::io_service &io_service, const char *file);
+    local_server(
+      boost::asio::io_service &io_service, const char *name,
+      pipeline::start_terminator &inbox, pipeline::controls &controls,
+      const pipeline::play_status &status
+    );
+    //! Removes the socket file if it's still the one we made.
+    ~local_server();
+
     void handle_accept(session_ptr new_session, const boost::system::error_code &error);
 
     protected:
@@ -41,9 +64,25 @@ namespace server {
     void async_accept();
 
     private:
+    //! Is the peer allowed to connect?
+    bool check_peer(stream_protocol::socket &s);
+
     boost::asio::io_service &io_service_;
+    boost::asio::io_service::strand strand_;
+    //! What the socket's bound to.  Abstract ones start with a null.
+    const std::string address_;
     stream_protocol::acceptor acceptor_;
+    pipeline::start_terminator &inbox_;
+    pipeline::controls &controls_;
+    server::publisher publisher_;
     ::output::logger log_;
+
+    //! \name The socket file we made
+    //@{
+    bool created_;
+    dev_t device_;
+    ino_t inode_;
+    //@}
   };
 }
 #endif
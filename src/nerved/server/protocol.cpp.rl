@@ -1,15 +1,133 @@
 // Copyright (C) 2011, James Webber.
 // Distributed under a 3-clause BSD license.  See COPYING.
 
+// This is compiled from the build directory so includes are from the top of
+// the source tree.
+#include "server/protocol.hpp"
+#include "util/asserts.hpp"
+
+#include <cstring>
+
 %%{
-  machine pants;
+  machine protocol;
+
+  action mark { mark_ = p; arg_end_ = NULL; }
+  action arg_end { arg_end_ = p; }
 
-  action pants {
+  action load { h.load(mark_, (std::size_t) (arg_end_ - mark_)); mark_ = NULL; }
+  action cue { h.cue(mark_, (std::size_t) (arg_end_ - mark_)); mark_ = NULL; }
+  action skip { h.skip(); }
+  action pause { h.pause(); }
+  action status { h.status(); }
+  action interval { interval_ = interval_ * 10 + (unsigned long) (fc - '0'); }
+  action subscribe { h.subscribe(mark_, (std::size_t) (arg_end_ - mark_), interval_); mark_ = NULL; interval_ = 0; }
+  action unsubscribe { h.unsubscribe(mark_, (std::size_t) (arg_end_ - mark_)); mark_ = NULL; }
+  # Nothing after these is for us, even if it came in the same read.
+  action bye { h.bye(); fbreak; }
+  action shutdown { h.shutdown(); fbreak; }
+
+  action volume_start {
+    negative_ = false;
+    decibels_ = false;
+    whole_ = 0;
+    fraction_ = 0;
+    scale_ = 1;
+  }
+  action negative { negative_ = true; }
+  action whole { whole_ = whole_ * 10 + (unsigned long) (fc - '0'); }
+  action fraction { fraction_ = fraction_ * 10 + (unsigned long) (fc - '0'); scale_ *= 10; }
+  action decibels { decibels_ = true; }
+  action volume {
+    const double v = (double) whole_ + (double) fraction_ / (double) scale_;
+    h.volume(negative_ ? -v : v, decibels_);
   }
 
+  action bad_line {
+    mark_ = NULL;
+    interval_ = 0;
+    h.error("unknown command or bad arguments");
+    fhold; fgoto skip_line;
+  }
+
+  eol = '\r'? '\n';
+
+  # Arguments always come after exactly one space so there's no question of
+  # where they start.
+  path = (any - [\r\n])+ >mark %arg_end;
+  topic = [a-z_]+ >mark %arg_end;
+  # Milliseconds.
+  interval = digit{1,6} $interval;
+  # Six digits either side is plenty for a gain and can't overflow.
+  gain = ('-' @negative)? digit{1,6} $whole ('.' digit{1,6} $fraction)? ('dB' @decibels)?;
+
+  command =
+      'load ' path eol @load
+    | 'cue ' path eol @cue
+    | 'skip' eol @skip
+    | 'pause' eol @pause
+    | 'volume ' @volume_start gain eol @volume
+    | 'status' eol @status
+    | 'subscribe ' topic (' ' interval)? eol @subscribe
+    | 'unsubscribe ' topic eol @unsubscribe
+    | 'bye' eol @bye
+    | 'shutdown' eol @shutdown;
+
+  skip_line := (any - '\n')* '\n' @{ fgoto main; };
+
+  main := command* $err(bad_line);
 }%%
 
 using namespace server;
 
-%%write init;
+namespace {
+  %% write data nofinal;
+}
 
+void protocol::reset() {
+  cs_ = protocol_start;
+  mark_ = NULL;
+  arg_end_ = NULL;
+  negative_ = decibels_ = false;
+  whole_ = fraction_ = 0;
+  scale_ = 1;
+  interval_ = 0;
+}
+
+std::size_t protocol::parse(char *buffer, std::size_t capacity, std::size_t kept, std::size_t read, handler &h) {
+  NERVE_ASSERT_PTR(buffer);
+  NERVE_ASSERT(kept + read <= capacity, "can't have read more than the buffer holds");
+
+  const char *p = buffer + kept;
+  const char *const pe = p + read;
+  // Never at the end; the client might always send more.
+  const char *const eof = NULL;
+  int cs = cs_;
+
+  %% write exec;
+
+  cs_ = cs;
+  (void) eof;
+
+  if (! mark_) {
+    return 0;
+  }
+
+  const std::size_t keep = (std::size_t) (pe - mark_);
+  if (keep == capacity) {
+    h.error("line too long");
+    mark_ = NULL;
+    interval_ = 0;
+    cs_ = protocol_en_skip_line;
+    return 0;
+  }
+
+  // Only the argument in progress is needed.  Nothing before it is looked
+  // at again.
+  const std::ptrdiff_t shift = mark_ - buffer;
+  std::memmove(buffer, mark_, keep);
+  mark_ = buffer;
+  if (arg_end_) {
+    arg_end_ -= shift;
+  }
+  return keep;
+}
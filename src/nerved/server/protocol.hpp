@@ -3,12 +3,98 @@
 
 #ifndef SERVER_PROTOCOL_HPP_fjpwbrxj
 #define SERVER_PROTOCOL_HPP_fjpwbrxj
+
+#include <cstddef>
+
 namespace server {
-  //! \ingroup grp_server
-  //! Protocol state using the ragel state machine generator.
+  /*!
+   * \ingroup grp_server
+   *
+   * Protocol state using the ragel state machine generator.  The machine is
+   * in protocol.cpp.rl.
+   *
+   * Every command is one line ending in "\n" (or "\r\n") and has to fit in the
+   * session's buffer:
+   *
+   *   load PATH
+   *   cue PATH              play PATH when the current track ends
+   *   skip
+   *   pause                 pause, or carry on if paused
+   *   volume NUMBER         linear gain, e.g. 0.5
+   *   volume NUMBERdB       decibels, e.g. -6dB
+   *   status
+   *   subscribe TOPIC [MS]  updates every MS milliseconds; see session
+   *   unsubscribe TOPIC
+   *   bye                   close this session
+   *   shutdown              stop the server
+   *
+   * Bytes are parsed where they are read.  The machine keeps its state
+   * between calls so a command can be split across any number of reads.
+   * Arguments are passed on as pointers into the buffer, so nothing is
+   * copied or allocated.  The only bytes which need keeping when a read ends
+   * are those of an argument which isn't finished; parse() moves them to the
+   * front of the buffer.
+   *
+   * A line which doesn't parse or is too long is reported and skipped.
+   * Parsing stops after bye or shutdown; anything after them in the same
+   * read is thrown away.
+   */
   class protocol {
     public:
+    //! Gets the commands as they're parsed.  Arguments point into the
+    //! buffer and are only valid during the call.
+    class handler {
+      public:
+      virtual void load(const char *path, std::size_t length) = 0;
+      virtual void cue(const char *path, std::size_t length) = 0;
+      virtual void skip() = 0;
+      virtual void pause() = 0;
+      virtual void volume(double value, bool decibels) = 0;
+      virtual void status() = 0;
+      //! The interval is 0 if it wasn't given.
+      virtual void subscribe(const char *topic, std::size_t length, unsigned long interval) = 0;
+      virtual void unsubscribe(const char *topic, std::size_t length) = 0;
+      virtual void bye() = 0;
+      virtual void shutdown() = 0;
+      //! The line was thrown away.
+      virtual void error(const char *message) = 0;
+
+      protected:
+      ~handler() {}
+    };
+
+    protocol() { this->reset(); }
+
+    //! Start again at the beginning of a line.
+    void reset();
+
+    /*!
+     * Parse `read` new bytes which follow the `kept` bytes at the start of
+     * the buffer (which were returned by the last call).  Returns how many
+     * bytes are now kept at the start, so the next read should go after
+     * them.
+     */
+    std::size_t parse(char *buffer, std::size_t capacity, std::size_t kept, std::size_t read, handler &h);
+
+    private:
+    //! Ragel's current state.
+    int cs_;
+    //! Start and end of the argument being read.  Null when there isn't
+    //! one.
+    const char *mark_;
+    const char *arg_end_;
+
+    //! \name The volume being read
+    //@{
+    bool negative_;
+    bool decibels_;
+    unsigned long whole_;
+    unsigned long fraction_;
+    unsigned long scale_;
+    //@}
 
+    //! Of the subscription being read.
+    unsigned long interval_;
   };
 }
 #endif
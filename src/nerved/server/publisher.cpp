@@ -0,0 +1,79 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+#include "publisher.hpp"
+#include "session.hpp"
+
+#include "../pipeline/play_status.hpp"
+
+#include <boost/asio/placeholders.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <algorithm>
+
+using namespace server;
+
+const unsigned int publisher::tick_ms;
+
+namespace {
+  //! Weak pointers can't be compared for equality, only ordered.
+  struct same_session {
+    explicit same_session(const boost::weak_ptr<session> &s) : s_(s) {}
+    bool operator()(const boost::weak_ptr<session> &o) const { return ! (o < s_) && ! (s_ < o); }
+    const boost::weak_ptr<session> &s_;
+  };
+}
+
+publisher::publisher(boost::asio::io_service &io_service, const pipeline::play_status &status)
+: status_(status), strand_(io_service), timer_(io_service), running_(false)
+{}
+
+void publisher::add(const boost::shared_ptr<session> &s) {
+  strand_.dispatch(boost::bind(&publisher::handle_add, this, weak_session(s)));
+}
+
+void publisher::handle_add(const weak_session &s) {
+  if (std::find_if(sessions_.begin(), sessions_.end(), same_session(s)) == sessions_.end()) {
+    sessions_.push_back(s);
+  }
+
+  if (! running_) {
+    running_ = true;
+    timer_.expires_from_now(boost::posix_time::milliseconds(tick_ms));
+    this->schedule();
+  }
+}
+
+void publisher::schedule() {
+  timer_.async_wait(strand_.wrap(boost::bind(&publisher::tick, this, boost::asio::placeholders::error)));
+}
+
+void publisher::tick(const boost::system::error_code &error) {
+  if (error) {
+    running_ = false;
+    return;
+  }
+
+  const pipeline::play_status::snapshot now = status_.read();
+
+  typedef std::vector<weak_session>::iterator iter_type;
+  iter_type keep = sessions_.begin();
+  for (iter_type i = sessions_.begin(); i != sessions_.end(); ++i) {
+    const session_ptr s = i->lock();
+    if (s && s->subscribed()) {
+      s->publish(now);
+      *keep++ = *i;
+    }
+  }
+  sessions_.erase(keep, sessions_.end());
+
+  if (sessions_.empty()) {
+    running_ = false;
+    return;
+  }
+
+  // From the last expiry so the ticks don't drift.
+  timer_.expires_at(timer_.expires_at() + boost::posix_time::milliseconds(tick_ms));
+  this->schedule();
+}
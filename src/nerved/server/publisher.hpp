@@ -0,0 +1,70 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef SERVER_PUBLISHER_HPP_t0xk3d7w
+#define SERVER_PUBLISHER_HPP_t0xk3d7w
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <vector>
+
+namespace pipeline {
+  class play_status;
+}
+
+namespace server {
+  class session;
+
+  /*!
+   * \ingroup grp_server
+   *
+   * Sends the play status to subscribed sessions.  There's one timer for the
+   * whole server, not one for each session.  Every tick it reads the status
+   * once and gives it to each subscriber, and the session decides whether
+   * anything is due.  The timer only runs while something is subscribed.
+   *
+   * Sessions are held weakly so a subscription doesn't keep a closed
+   * session alive.  They drop out at the next tick after they go or stop
+   * wanting updates.
+   *
+   * The list and the timer are only touched in the publisher's strand.  The
+   * status goes to each session through the session's own strand, so a
+   * session which is busy doesn't hold up the tick.
+   */
+  class publisher : boost::noncopyable {
+    public:
+    //! Intervals are rounded up to a whole number of these.
+    static const unsigned int tick_ms = 50;
+
+    publisher(boost::asio::io_service &io_service, const pipeline::play_status &status);
+
+    const pipeline::play_status &status() const { return status_; }
+
+    //! Start giving this session updates.  Nothing happens if it's already
+    //! here.  Any thread.
+    void add(const boost::shared_ptr<session> &s);
+
+    private:
+    typedef boost::weak_ptr<session> weak_session;
+
+    //! \name In the strand
+    //@{
+    void handle_add(const weak_session &s);
+    void schedule();
+    void tick(const boost::system::error_code &error);
+    //@}
+
+    const pipeline::play_status &status_;
+    boost::asio::io_service::strand strand_;
+    boost::asio::deadline_timer timer_;
+    std::vector<weak_session> sessions_;
+    bool running_;
+  };
+}
+
+#endif
@@ -2,54 +2,313 @@
 // Distributed under a 3-clause BSD license.  See COPYING.
 
 #include "session.hpp"
+#include "publisher.hpp"
 
+#include "../pipeline/controls.hpp"
+#include "../pipeline/terminators.hpp"
 #include "../util/pooled.hpp"
 
+#include <boost/asio/error.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
 using namespace server;
 
-session::shared_ptr session::create_shared(boost::asio::io_service &sv) {
-  return shared_ptr(::pooled::alloc1<session>(sv), pooled::call_free<session>());
+const std::size_t session::max_queued;
+const unsigned long session::default_interval_ms;
+
+namespace {
+  bool is_topic(const char *topic, std::size_t length, const char *name) {
+    return std::strlen(name) == length && std::strncmp(topic, name, length) == 0;
+  }
+}
+
+session::shared_ptr session::create_shared(
+  boost::asio::io_service &sv, pipeline::start_terminator &inbox,
+  pipeline::controls &controls, server::publisher &pub
+) {
+  return shared_ptr(::pooled::alloc4<session>(sv, inbox, controls, pub), pooled::call_free<session>());
 }
 
 void session::start() {
+  strand_.post(boost::bind(&session::handle_start, shared_from_this()));
+}
+
+void session::publish(const snapshot_type &now) {
+  strand_.dispatch(boost::bind(&session::handle_publish, shared_from_this(), now));
+}
+
+void session::handle_start() {
   log_.trace("session %p: starting\n", (void*) this);
+  this->async_read();
+}
+
+void session::async_read() {
   socket_.async_read_some(
-    boost::asio::buffer(data_),
-    boost::bind(
-      &session::handle_read,
-      shared_from_this(),
-      boost::asio::placeholders::error,
-      boost::asio::placeholders::bytes_transferred
+    boost::asio::buffer(data_.begin() + kept_, data_.size() - kept_),
+    strand_.wrap(
+      boost::bind(
+        &session::handle_read,
+        shared_from_this(),
+        boost::asio::placeholders::error,
+        boost::asio::placeholders::bytes_transferred
+      )
     )
   );
 }
 
 void session::handle_read(const boost::system::error_code &error, size_t bytes_transferred) {
   if (error) {
-    log_.error("session %p: read: %s\n", (void*) this, error.message().c_str());
-    this->socket().shutdown(socket_type::shutdown_both);
+    if (error != boost::asio::error::eof) {
+      log_.error("session %p: read: %s\n", (void*) this, error.message().c_str());
+    }
+    this->close();
+    return;
+  }
+
+  kept_ = protocol_.parse(data_.c_array(), data_.size(), kept_, bytes_transferred, *this);
+  // All the replies to one read go in one write.
+  this->flush();
+
+  // Otherwise the session goes when the last handler holding it does.
+  if (closing_) {
+    return;
+  }
+  else if (queued_.size() >= max_queued) {
+    read_stalled_ = true;
   }
   else {
-    if (std::strncmp(data_.begin(), "BYE", bytes_transferred) == 0) {
-      this->socket().shutdown(socket_type::shutdown_both);
+    this->async_read();
+  }
+}
+
+void session::handle_write(const boost::system::error_code &error) {
+  writing_.clear();
+  if (error) {
+    log_.error("session %p: write: %s\n", (void*) this, error.message().c_str());
+    this->close();
+    return;
+  }
+
+  this->flush();
+
+  if (closing_) {
+    if (writing_.empty()) {
+      this->close();
     }
-    else if (std::strncmp(data_.begin(), "MADAGASCAR", bytes_transferred) == 0) {
-      // TODO:
-      //   How do I inform all clients I am shutting down?
-      socket_.get_io_service().stop();
-      return;
+  }
+  else if (read_stalled_ && queued_.size() < max_queued) {
+    read_stalled_ = false;
+    this->async_read();
+  }
+}
+
+void session::handle_publish(const snapshot_type &now) {
+  if (closing_) {
+    return;
+  }
+
+  if (state_topic_ && now.changes != sent_changes_) {
+    state_due_ = true;
+  }
+
+  if (position_ticks_ && --position_countdown_ == 0) {
+    position_countdown_ = position_ticks_;
+    if (now.position != sent_position_) {
+      position_due_ = true;
     }
+  }
 
-#if 0
-    boost::asio::async_write(
-      socket_,
-      boost::asio::buffer(data_, bytes_transferred),
-      boost::bind(
-        &session::handle_write,
-        shared_from_this(),
-        boost::asio::placeholders::error
-      )
-    );
-#endif
+  latest_ = now;
+  if (state_due_ || position_due_) {
+    this->flush();
   }
 }
+
+void session::update_subscribed() {
+  subscribed_.store(! closing_ && (state_topic_ || position_ticks_), boost::memory_order_release);
+}
+
+void session::reply(const char *text) {
+  queued_ += text;
+}
+
+void session::flush() {
+  if (! writing_.empty()) {
+    return;
+  }
+
+  if (state_due_) {
+    this->append_state(latest_);
+    sent_changes_ = latest_.changes;
+    state_due_ = false;
+  }
+
+  if (position_due_) {
+    this->append_position(latest_);
+    sent_position_ = latest_.position;
+    position_due_ = false;
+  }
+
+  if (queued_.empty()) {
+    return;
+  }
+
+  writing_.swap(queued_);
+  boost::asio::async_write(
+    socket_, boost::asio::buffer(writing_),
+    strand_.wrap(boost::bind(&session::handle_write, shared_from_this(), boost::asio::placeholders::error))
+  );
+}
+
+void session::close() {
+  closing_ = true;
+  this->update_subscribed();
+  boost::system::error_code ignored;
+  socket_.shutdown(socket_type::shutdown_both, ignored);
+}
+
+void session::append_state(const snapshot_type &s) {
+  char line[64];
+  std::sprintf(
+    line, "state %s %llu\n",
+    s.state == pipeline::play_status::state::playing ? "playing" : "stopped",
+    (unsigned long long) s.track
+  );
+  queued_ += line;
+}
+
+void session::append_position(const snapshot_type &s) {
+  char line[64];
+  std::sprintf(line, "position %lld\n", (long long) (s.position / 1000));
+  queued_ += line;
+}
+
+void session::load(const char *path, std::size_t length) {
+  log_.trace("session %p: load %.*s\n", (void*) this, (int) length, path);
+  if (! inbox_.post_load(path, length)) {
+    this->error("path too long");
+    return;
+  }
+  this->reply("ok\n");
+}
+
+void session::cue(const char *path, std::size_t length) {
+  log_.trace("session %p: cue %.*s\n", (void*) this, (int) length, path);
+  if (! inbox_.post_cue(path, length)) {
+    this->error("path too long");
+    return;
+  }
+  this->reply("ok\n");
+}
+
+void session::skip() {
+  log_.trace("session %p: skip\n", (void*) this);
+  // No location means the end of the current track.
+  inbox_.post_skip(NULL);
+  this->reply("ok\n");
+}
+
+void session::pause() {
+  log_.trace("session %p: pause\n", (void*) this);
+  if (! controls_.toggle_pause()) {
+    this->error("not supported");
+    return;
+  }
+  this->reply("ok\n");
+}
+
+void session::volume(double value, bool decibels) {
+  log_.trace("session %p: volume %g%s\n", (void*) this, value, decibels ? "dB" : "");
+  if (! decibels && value < 0) {
+    this->error("gain can't be negative");
+    return;
+  }
+
+  // The stage clamps it.
+  const double linear = decibels ? std::pow(10.0, value / 20.0) : value;
+  if (! controls_.gain((float) linear)) {
+    this->error("not supported");
+    return;
+  }
+  this->reply("ok\n");
+}
+
+void session::status() {
+  // The most common command, so there's no logging.
+  const snapshot_type now = publisher_.status().read();
+  this->append_state(now);
+  this->append_position(now);
+  this->reply("ok\n");
+}
+
+void session::subscribe(const char *topic, std::size_t length, unsigned long interval) {
+  log_.trace("session %p: subscribe %.*s %lu\n", (void*) this, (int) length, topic, interval);
+
+  latest_ = publisher_.status().read();
+  if (is_topic(topic, length, "state")) {
+    state_topic_ = true;
+    // Say where things are now so the client doesn't have to ask.
+    state_due_ = true;
+  }
+  else if (is_topic(topic, length, "position")) {
+    const unsigned long ms = interval ? interval : default_interval_ms;
+    position_ticks_ = (ms + publisher::tick_ms - 1) / publisher::tick_ms;
+    position_countdown_ = position_ticks_;
+    position_due_ = true;
+  }
+  else {
+    this->error("unknown topic");
+    return;
+  }
+
+  this->reply("ok\n");
+  this->update_subscribed();
+  // It's only added once however many times this happens.
+  publisher_.add(shared_from_this());
+}
+
+void session::unsubscribe(const char *topic, std::size_t length) {
+  log_.trace("session %p: unsubscribe %.*s\n", (void*) this, (int) length, topic);
+
+  // The publisher forgets the session at its next tick.
+  if (is_topic(topic, length, "state")) {
+    state_topic_ = false;
+    state_due_ = false;
+  }
+  else if (is_topic(topic, length, "position")) {
+    position_ticks_ = 0;
+    position_due_ = false;
+  }
+  else {
+    this->error("unknown topic");
+    return;
+  }
+  this->update_subscribed();
+  this->reply("ok\n");
+}
+
+void session::bye() {
+  // Anything already queued is still sent.
+  closing_ = true;
+  this->update_subscribed();
+  if (writing_.empty() && queued_.empty()) {
+    this->close();
+  }
+}
+
+void session::shutdown() {
+  // TODO:
+  //   How do I inform all clients I am shutting down?
+  closing_ = true;
+  socket_.get_io_service().stop();
+}
+
+void session::error(const char *message) {
+  log_.trace("session %p: %s\n", (void*) this, message);
+  this->reply("error ");
+  this->reply(message);
+  this->reply("\n");
+}
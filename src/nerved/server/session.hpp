@@ -4,25 +4,66 @@
 #define SERVER_SESSION_HPP_mk6t8fr4
 
 #include "protocol.hpp"
+#include "../pipeline/play_status.hpp"
 #include "../output/logging.hpp"
 
 #include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/system/system_error.hpp>
 #include <boost/system/error_code.hpp>
 
 #include <boost/array.hpp>
+#include <boost/atomic.hpp>
 #include <boost/utility.hpp>
 #include <boost/bind.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <string>
+
+namespace pipeline {
+  class controls;
+  class start_terminator;
+}
+
 namespace server {
-  //! \ingroup grp_server
-  //! An individual communication with a client.  Note the inheritance means we
-  //! can convert a raw pointer into a shared_ptr (and it has to be public).
-  class session : public boost::enable_shared_from_this<session>, boost::noncopyable {
+  class publisher;
+
+  /*!
+   * \ingroup grp_server
+   *
+   * An individual communication with a client.  Note the inheritance means we
+   * can convert a raw pointer into a shared_ptr (and it has to be public).
+   *
+   * Reads go straight into data_ and are parsed there by the protocol; see
+   * protocol for the commands.  Commands for the player are posted to the
+   * pipeline's start terminator, apart from volume and pause which go
+   * straight to the stages through the pipeline's controls.
+   *
+   * Every command is answered with "ok" or "error MESSAGE".  A status command
+   * and the subscriptions send these lines too:
+   *
+   *   state playing|stopped TRACK
+   *   position MS
+   *
+   * There are two topics.  "state" sends a state line when the state or
+   * track changes.  "position" sends a position line every MS milliseconds
+   * (default 1000) while it's changing.
+   *
+   * There's only ever one write going.  Replies wait in a queue until it's
+   * done.  Updates aren't queued: they're written from the latest status
+   * when the next write starts, so a client which reads slowly gets fewer
+   * updates instead of a backlog.  A client which doesn't read its replies
+   * isn't read from until it catches up.
+   *
+   * The io_service can be run by several threads.  All of a session's
+   * handlers go through its strand so they never run at the same time and
+   * nothing else needs locking.  Other sessions carry on in other threads
+   * while one is busy.
+   */
+  class session : public boost::enable_shared_from_this<session>, boost::noncopyable, private protocol::handler {
     // This class is originally based on example code which is part of the boost
     // ASIO library.
     //
@@ -34,12 +75,36 @@ namespace server {
     private:
     typedef boost::asio::local::stream_protocol stream_protocol;
     typedef stream_protocol::socket socket_type;
+    typedef pipeline::play_status::snapshot snapshot_type;
 
     public:
     typedef boost::shared_ptr<session> shared_ptr;
 
-    explicit session(boost::asio::io_service &io_service)
+    //! Stop reading when this much is waiting to be written.
+    static const std::size_t max_queued = 4096;
+    //! Of position updates when the subscription doesn't say.
+    static const unsigned long default_interval_ms = 1000;
+
+    session(
+      boost::asio::io_service &io_service, pipeline::start_terminator &inbox,
+      pipeline::controls &controls, server::publisher &pub
+    )
       : socket_(io_service),
+        strand_(io_service),
+        inbox_(inbox),
+        controls_(controls),
+        publisher_(pub),
+        kept_(0),
+        closing_(false),
+        read_stalled_(false),
+        subscribed_(false),
+        state_topic_(false),
+        position_ticks_(0),
+        position_countdown_(0),
+        state_due_(false),
+        position_due_(false),
+        sent_changes_(0),
+        sent_position_(0),
         log_(output::source::server)
     { }
 
@@ -47,35 +112,114 @@ namespace server {
       log_.trace("session %p closed\n", (void*) this);
     }
 
-    static shared_ptr create_shared(boost::asio::io_service &sv);
+    static shared_ptr create_shared(
+      boost::asio::io_service &sv, pipeline::start_terminator &inbox,
+      pipeline::controls &controls, server::publisher &pub
+    );
 
     socket_type &socket() { return socket_; }
 
-    //! Start this session listening.
+    //! Start this session listening.  Any thread.
     void start();
 
-    //! Deal with some data coming in.
-    void handle_read(const boost::system::error_code &error, size_t bytes_transferred);
+    //! \name Publisher
+    //! Any thread.
+    //@{
 
-#if 0
-    void handle_write(const boost::system::error_code &error) {
-      if (! error) {
-        socket_.async_read_some(
-          boost::asio::buffer(data_),
-          boost::bind(
-            &session::handle_read,
-            shared_from_this(),
-            boost::asio::placeholders::error,
-            boost::asio::placeholders::bytes_transferred
-          )
-        );
-      }
-    }
-#endif
+    //! The latest status.  It's dealt with in the strand.
+    void publish(const snapshot_type &now);
+
+    //! False when the session can be forgotten.
+    bool subscribed() const { return subscribed_.load(boost::memory_order_acquire); }
+
+    //@}
 
     private:
+    //! \name Handlers
+    //! These are all in the strand.
+    //@{
+    void handle_start();
+    void handle_read(const boost::system::error_code &error, size_t bytes_transferred);
+    void handle_write(const boost::system::error_code &error);
+    void handle_publish(const snapshot_type &now);
+    //@}
+
+    //! Whether any topic is on.
+    void update_subscribed();
+
+    //! Read after whatever the protocol kept from last time.
+    void async_read();
+
+    //! Queued until the next write.
+    void reply(const char *text);
+
+    //! Start writing whatever is waiting unless there's a write going.
+    void flush();
+
+    //! Stop reading and writing.
+    void close();
+
+    //! \name Status lines
+    //@{
+    void append_state(const snapshot_type &s);
+    void append_position(const snapshot_type &s);
+    //@}
+
+    //! \name Protocol commands
+    //@{
+    void load(const char *path, std::size_t length);
+    void cue(const char *path, std::size_t length);
+    void skip();
+    void pause();
+    void volume(double value, bool decibels);
+    void status();
+    void subscribe(const char *topic, std::size_t length, unsigned long interval);
+    void unsubscribe(const char *topic, std::size_t length);
+    void bye();
+    void shutdown();
+    void error(const char *message);
+    //@}
+
     stream_protocol::socket socket_;
+    boost::asio::io_service::strand strand_;
+    pipeline::start_terminator &inbox_;
+    pipeline::controls &controls_;
+    server::publisher &publisher_;
+
     boost::array<char, 1024> data_;
+    protocol protocol_;
+    //! Bytes at the start of data_ which the protocol still needs.
+    std::size_t kept_;
+    //! Don't read any more; shut down once what's queued is written.
+    bool closing_;
+    //! Reading waits for queued_ to go down.
+    bool read_stalled_;
+
+    //! \name Output
+    //! The strings keep their capacity so steady state doesn't allocate.
+    //@{
+    std::string queued_;
+    //! Being written.  Empty when there's no write going.
+    std::string writing_;
+    //@}
+
+    //! \name Subscriptions
+    //@{
+    //! Read by the publisher.
+    boost::atomic<bool> subscribed_;
+    bool state_topic_;
+    //! Publisher ticks between position updates, or 0 for none.
+    unsigned long position_ticks_;
+    unsigned long position_countdown_;
+    //! Written at the next flush.
+    bool state_due_;
+    bool position_due_;
+    //! What they are written from.
+    snapshot_type latest_;
+    boost::uint64_t sent_changes_;
+    pipeline::play_status::timestamp_type sent_position_;
+    //@}
+
     output::logger log_;
   };
 
@@ -13,6 +13,12 @@
 
 #include "information.hpp"
 #include "ffmpeg_input.hpp"
+#include "ffmpeg_demux.hpp"
+#include "ffmpeg_decode.hpp"
 #include "sdl.hpp"
+#include "file_output.hpp"
+#include "volume.hpp"
+#include "degapifier.hpp"
+#include "convert.hpp"
 
 #endif
@@ -0,0 +1,279 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "convert.hpp"
+
+#include "dsp/convert.hpp"
+#include "dsp/simd.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../pipeline/packet_pool.hpp"
+#include "../pipeline/packet_return.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using stages::convert;
+using pipeline::packet;
+using pipeline::packet_return;
+
+namespace {
+  //! Timestamps are rounded so allow a little slop when following on.
+  const pipeline::payload::timestamp_type follow_on_us = 1000;
+
+  pipeline::payload::timestamp_type frames_to_us(pipeline::payload::timestamp_type frames, unsigned int rate) {
+    return frames * 1000000 / rate;
+  }
+}
+
+convert::convert()
+: format_(pipeline::sample_format::none), rate_(0), quality_(dsp::resampler::quality::medium),
+  passthrough_(false), track_start_(0), output_frames_(0), expected_(0)
+{
+  output::logger log(output::source::pipeline);
+  log.trace("convert: using %s conversion kernels\n", dsp::isa_name(dsp::best_isa()));
+}
+
+convert::~convert() {
+  this->release_output();
+}
+
+void convert::abandon() {
+  this->release_output();
+  input_ = pipeline::audio_format();
+}
+
+void convert::flush() {
+}
+
+void convert::finish() {
+  input_ = pipeline::audio_format();
+}
+
+void convert::configure(const char *k, const char *v) {
+  NERVE_ASSERT_PTR(k);
+  NERVE_ASSERT_PTR(v);
+
+  output::logger log(output::source::config);
+
+  if (std::strcmp(k, "format") == 0) {
+    if (std::strcmp(v, "s16") == 0) {
+      format_ = pipeline::sample_format::s16;
+    }
+    else if (std::strcmp(v, "s32") == 0) {
+      format_ = pipeline::sample_format::s32;
+    }
+    else if (std::strcmp(v, "float") == 0) {
+      format_ = pipeline::sample_format::flt;
+    }
+    else if (std::strcmp(v, "double") == 0) {
+      format_ = pipeline::sample_format::dbl;
+    }
+    else {
+      log.error("convert: format must be s16, s32, float or double, not '%s'\n", v);
+      return;
+    }
+  }
+  else if (std::strcmp(k, "rate") == 0) {
+    char *end;
+    const long hz = std::strtol(v, &end, 10);
+    if (*v == '\0' || *end != '\0' || hz <= 0) {
+      log.error("convert: rate must be a number of Hz, not '%s'\n", v);
+      return;
+    }
+    rate_ = (unsigned int) hz;
+  }
+  else if (std::strcmp(k, "quality") == 0) {
+    if (std::strcmp(v, "low") == 0) {
+      quality_ = dsp::resampler::quality::low;
+    }
+    else if (std::strcmp(v, "medium") == 0) {
+      quality_ = dsp::resampler::quality::medium;
+    }
+    else if (std::strcmp(v, "high") == 0) {
+      quality_ = dsp::resampler::quality::high;
+    }
+    else {
+      log.error("convert: quality must be low, medium or high, not '%s'\n", v);
+      return;
+    }
+  }
+  else {
+    log.warn("convert: unknown configuration key '%s'\n", k);
+    return;
+  }
+
+  // Set up again with the new settings.
+  input_ = pipeline::audio_format();
+}
+
+packet_return convert::process(packet *p) {
+  NERVE_CHECK_PTR(p);
+  NERVE_ASSERT(out_.empty(), "can't be given more while debuffering");
+
+  const pipeline::payload &pl = p->payload();
+  const pipeline::audio_format &fmt = pl.format();
+  if (pl.content() != pipeline::payload_content::samples || pl.frames() == 0 || ! fmt.rate()) {
+    return packet_return(p);
+  }
+
+  const bool restart = ! fmt.same_as(input_);
+  if (restart) {
+    this->start(fmt);
+  }
+
+  if (passthrough_) {
+    return packet_return(p);
+  }
+
+  const timestamp_type timestamp = pl.timestamp();
+  const std::size_t frames = pl.frames();
+
+  // New track or something was cut out.
+  if (restart || timestamp + follow_on_us < expected_ || timestamp > expected_ + follow_on_us) {
+    track_start_ = timestamp;
+    output_frames_ = 0;
+  }
+  expected_ = timestamp + frames_to_us(frames, fmt.rate());
+
+  this->unpack(pl);
+
+  if (input_.rate() == output_.rate()) {
+    track_start_ = timestamp;
+    output_frames_ = 0;
+    this->pack(p, &in_[0], frames);
+  }
+  else {
+    out_samples_.resize(resampler_.max_output(frames) * output_.channels());
+    const std::size_t written = resampler_.process(&in_[0], frames, &out_samples_[0]);
+    this->pack(p, &out_samples_[0], written);
+  }
+
+  return this->next_output();
+}
+
+packet_return convert::debuffer() {
+  NERVE_ASSERT(! out_.empty(), "debuffer only when we said we were buffering");
+  return this->next_output();
+}
+
+pipeline::audio_format convert::target(const pipeline::audio_format &in) const {
+  return pipeline::audio_format(
+    format_ == pipeline::sample_format::none ? in.sample_format() : format_,
+    in.channels(),
+    rate_ ? rate_ : in.rate()
+  );
+}
+
+void convert::start(const pipeline::audio_format &in) {
+  input_ = in;
+  output_ = generations_.stamp(this->target(in));
+  passthrough_ = output_ == input_;
+
+  if (! passthrough_ && input_.rate() != output_.rate()) {
+    resampler_.setup(input_.rate(), output_.rate(), input_.channels(), quality_);
+
+    output::logger log(output::source::pipeline);
+    log.trace(
+      "convert: %u Hz to %u Hz with %lu taps in %lu phases\n",
+      input_.rate(), output_.rate(), (unsigned long) resampler_.taps(), (unsigned long) resampler_.phases()
+    );
+  }
+}
+
+void convert::unpack(const pipeline::payload &pl) {
+  const std::size_t count = pl.frames() * pl.format().channels();
+  in_.resize(count);
+
+  switch (pl.format().sample_format()) {
+  case pipeline::sample_format::s16:
+    dsp::to_float((const boost::int16_t *) pl.data(), &in_[0], count);
+    break;
+  case pipeline::sample_format::s32:
+    dsp::to_float((const boost::int32_t *) pl.data(), &in_[0], count);
+    break;
+  case pipeline::sample_format::flt:
+    dsp::to_float((const float *) pl.data(), &in_[0], count);
+    break;
+  case pipeline::sample_format::dbl:
+    dsp::to_float((const double *) pl.data(), &in_[0], count);
+    break;
+  case pipeline::sample_format::none:
+    NERVE_ABORT("can't convert samples of no format");
+  }
+}
+
+void convert::pack(packet *first, const float *samples, std::size_t frames) {
+  // The input has been copied out so its storage is free to write over.
+  if (frames == 0) {
+    first->release();
+    return;
+  }
+
+  const unsigned int channels = output_.channels();
+  const std::size_t frame_bytes = output_.frame_bytes();
+  const std::size_t packet_frames = packet::storage_size / frame_bytes;
+  pipeline::packet_pool *const pool = first->pool();
+
+  packet *p = first;
+  for (std::size_t done = 0; done < frames; done += packet_frames) {
+    if (! p) {
+      if (! pool) {
+        output::logger log(output::source::pipeline);
+        log.warn("convert: dropping %lu frames which don't fit the packet\n", (unsigned long) (frames - done));
+        break;
+      }
+      p = NERVE_CHECK_PTR(pool->acquire());
+    }
+
+    const std::size_t n = std::min(packet_frames, frames - done);
+    const float *const from = samples + done * channels;
+    const std::size_t count = n * channels;
+    unsigned char *const to = p->storage();
+    switch (output_.sample_format()) {
+    case pipeline::sample_format::s16:
+      dsp::from_float(from, (boost::int16_t *) to, count);
+      break;
+    case pipeline::sample_format::s32:
+      dsp::from_float(from, (boost::int32_t *) to, count);
+      break;
+    case pipeline::sample_format::flt:
+      dsp::from_float(from, (float *) to, count);
+      break;
+    case pipeline::sample_format::dbl:
+      dsp::from_float(from, (double *) to, count);
+      break;
+    case pipeline::sample_format::none:
+      NERVE_ABORT("can't convert samples to no format");
+    }
+
+    pipeline::payload &pl = p->payload();
+    pl.clear();
+    pl.data(to, n * frame_bytes);
+    pl.format(output_);
+    pl.timestamp(track_start_ + frames_to_us(output_frames_, output_.rate()));
+    output_frames_ += n;
+
+    out_.push_back(p);
+    p = NULL;
+  }
+}
+
+void convert::release_output() {
+  std::for_each(out_.begin(), out_.end(), boost::bind(&packet::release, _1));
+  out_.clear();
+}
+
+packet_return convert::next_output() {
+  if (out_.empty()) {
+    return packet_return();
+  }
+
+  packet *const p = out_.front();
+  out_.pop_front();
+  return packet_return(p, ! out_.empty());
+}
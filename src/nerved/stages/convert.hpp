@@ -0,0 +1,105 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_CONVERT_HPP_p2h8ws4n
+#define STAGES_CONVERT_HPP_p2h8ws4n
+
+#include "interfaces.hpp"
+
+#include "dsp/resample.hpp"
+
+#include "../pipeline/payload.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Converts samples to a fixed format and rate so whatever is after it (the
+   * output in particular) sees the same thing for every track.  Packets
+   * which already match, and anything which isn't samples, go through
+   * untouched.
+   *
+   * Samples are turned into floats, resampled by dsp::resampler if the rate
+   * is different, and turned back into the output format.  The first packet
+   * of output is written into the packet which came in; if there's more
+   * than fits, the rest come from its pool and are let out by debuffer().
+   *
+   * The resampler's history carries on across track boundaries so joined
+   * tracks stay joined.  It's reset when the input format changes and on
+   * finish and abandon, which loses the last half a filter of samples.
+   *
+   * Channels aren't mixed.  Samples are always interleaved in the pipeline
+   * so there's no planar form to convert from.
+   *
+   * Configuration:
+   * - format: s16, s32, float or double (default: leave it alone).
+   * - rate: in Hz (default: leave it alone).
+   * - quality: low, medium or high, which trades CPU time for a steeper
+   *   filter (default medium).
+   */
+  class convert : public pipeline::process_stage {
+    public:
+    convert();
+    ~convert();
+
+    void abandon();
+    void flush();
+    void finish();
+    void configure(const char *k, const char *v);
+    pipeline::packet_return process(pipeline::packet *);
+    pipeline::packet_return debuffer();
+
+    private:
+    typedef pipeline::payload::timestamp_type timestamp_type;
+
+    //! What this input becomes.
+    pipeline::audio_format target(const pipeline::audio_format &in) const;
+    //! Get ready for a different input format.
+    void start(const pipeline::audio_format &in);
+    //! Convert the input to floats in in_.
+    void unpack(const pipeline::payload &);
+    //! Split floats into packets of the output format.
+    void pack(pipeline::packet *first, const float *samples, std::size_t frames);
+    void release_output();
+    pipeline::packet_return next_output();
+
+    //! \name Configuration
+    //@{
+    pipeline::sample_format::id format_;
+    unsigned int rate_;
+    dsp::resampler::quality_type quality_;
+    //@}
+
+    //! Input format the resampler is set up for.  Cleared to mean it needs
+    //! doing again.
+    pipeline::audio_format input_;
+    pipeline::audio_format output_;
+    //! The input is already what's wanted.
+    bool passthrough_;
+    pipeline::format_generations generations_;
+    dsp::resampler resampler_;
+
+    //! \name Timestamps
+    //! Output frames are counted from the first packet of each track.
+    //@{
+    timestamp_type track_start_;
+    timestamp_type output_frames_;
+    //! Timestamp of the input packet which would follow the last one.
+    timestamp_type expected_;
+    //@}
+
+    //! \name Scratch
+    //! Kept between packets so steady state doesn't allocate.
+    //@{
+    std::vector<float> in_;
+    std::vector<float> out_samples_;
+    //@}
+
+    //! Waiting for debuffer().
+    std::deque<pipeline::packet*> out_;
+  };
+}
+
+#endif
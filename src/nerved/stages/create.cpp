@@ -4,6 +4,7 @@
 
 #include "built_in_stages.hpp"
 #include "stage_data.hpp"
+#include "../pipeline/controls.hpp"
 #include "../pipeline/simple_stages.hpp"
 
 #include "../util/asserts.hpp"
@@ -27,10 +28,20 @@ namespace {
       switch (sd.plugin_id()) {
       case plug_id::ffmpeg:
         return allocate<stages::ffmpeg_input>(alloc);
+      case plug_id::ffmpeg_demux:
+        return allocate<stages::ffmpeg_demux>(alloc);
+      case plug_id::ffmpeg_decode:
+        return allocate<stages::ffmpeg_decode>(alloc);
       case plug_id::sdl:
         return allocate<stages::sdl>(alloc);
+      case plug_id::file_output:
+        return allocate<stages::file_output>(alloc);
+      case plug_id::degapifier:
+        return allocate<stages::degapifier>(alloc);
+      case plug_id::convert:
+        return allocate<stages::convert>(alloc);
       case plug_id::volume:
-        NERVE_ABORT("volume builtin not handled yet");
+        return allocate<stages::volume>(alloc);
       case plug_id::plugin:
       case plug_id::unset:
         NERVE_ABORT("impossible value for built-in plugin");
@@ -58,6 +69,18 @@ pipeline::input_stage *stages::create_input_stage(stage_data &sd, alloc_func all
   return NERVE_CHECK_PTR(static_cast<pipeline::input_stage*>(ret));
 }
 
+pipeline::process_stage *stages::create_process_stage(stage_data &sd, alloc_func alloc) {
+  // TODO:
+  //   Need to modify this when the sd is a loadable plugin.
+  NERVE_ASSERT(
+    stages::get_built_in_plugin_category(sd.plugin_id()) == stage_cat::process,
+    "must only be called for process stage configs"
+  );
+
+  pipeline::simple_stage *const ret = NERVE_CHECK_PTR(create_stage(sd, alloc));
+  return NERVE_CHECK_PTR(static_cast<pipeline::process_stage*>(ret));
+}
+
 pipeline::observer_stage *stages::create_observer_stage(stage_data &sd, alloc_func alloc) {
   // TODO:
   //   Need to modify this when the sd is a loadable plugin.
@@ -69,3 +92,21 @@ pipeline::observer_stage *stages::create_observer_stage(stage_data &sd, alloc_fu
   pipeline::simple_stage *const ret = NERVE_CHECK_PTR(create_stage(sd, alloc));
   return static_cast<pipeline::observer_stage*>(ret);
 }
+
+void stages::add_controls(pipeline::controls &c, pipeline::simple_stage *s, stage_data &sd) {
+  NERVE_ASSERT_PTR(s);
+  if (! sd.built_in()) {
+    return;
+  }
+
+  switch (sd.plugin_id()) {
+  case plug_id::volume:
+    c.gain_stage(static_cast<stages::volume*>(s));
+    break;
+  case plug_id::sdl:
+    c.pause_stage(static_cast<stages::sdl*>(s));
+    break;
+  default:
+    break;
+  }
+}
@@ -4,6 +4,7 @@
 #define STAGES_CREATE_HPP_vo8h7vvo
 
 namespace pipeline {
+  class controls;
   struct input_stage;
   struct output_stage;
   struct simple_stage;
@@ -29,9 +30,17 @@ namespace stages {
   //! Create an input stage.  A non-input stage is invalid.
   pipeline::input_stage *create_input_stage(stage_data &, alloc_func = &pooled::tracked_byte_alloc);
 
+  //! \ingroup grp_stages
+  //! Create a process stage.  A non-process stage is invalid.
+  pipeline::process_stage *create_process_stage(stage_data &, alloc_func = &pooled::tracked_byte_alloc);
+
   //! \ingroup grp_stages
   //! Create an observer stage.  A non-input stage is invalid.
   pipeline::observer_stage *create_observer_stage(stage_data &, alloc_func = &pooled::tracked_byte_alloc);
+
+  //! \ingroup grp_stages
+  //! Give the stage to the controls if it's one they use.
+  void add_controls(pipeline::controls &, pipeline::simple_stage *, stage_data &);
 }
 
 #endif
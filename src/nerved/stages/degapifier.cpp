@@ -0,0 +1,299 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "degapifier.hpp"
+
+#include "dsp/energy.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../pipeline/packet_pool.hpp"
+#include "../pipeline/packet_return.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using stages::degapifier;
+using pipeline::packet;
+using pipeline::packet_return;
+
+namespace {
+  //! Timestamps are rounded so allow a little slop when following on.
+  const pipeline::payload::timestamp_type follow_on_us = 1000;
+
+  pipeline::payload::timestamp_type frames_to_us(std::size_t frames, unsigned int rate) {
+    return (pipeline::payload::timestamp_type) frames * 1000000 / rate;
+  }
+
+  std::size_t us_to_frames(pipeline::payload::timestamp_type us, unsigned int rate) {
+    return us > 0 ? (std::size_t) (us * rate / 1000000) : 0;
+  }
+
+  pipeline::payload::timestamp_type duration(const pipeline::payload &pl) {
+    return frames_to_us(pl.frames(), pl.format().rate());
+  }
+}
+
+const std::size_t degapifier::period_frames;
+
+degapifier::degapifier()
+: window_us_(100000), threshold_(1e-6f), state_(state::head), expected_(0),
+  started_(false), held_us_(0)
+{}
+
+degapifier::~degapifier() {
+  this->drop_held();
+  std::for_each(out_.begin(), out_.end(), boost::bind(&packet::release, _1));
+}
+
+void degapifier::abandon() {
+  this->drop_held();
+  std::for_each(out_.begin(), out_.end(), boost::bind(&packet::release, _1));
+  out_.clear();
+  started_ = false;
+}
+
+void degapifier::flush() {
+}
+
+void degapifier::finish() {
+  // It's only silence and there's no next track to join it to.
+  this->drop_held();
+  started_ = false;
+}
+
+void degapifier::configure(const char *k, const char *v) {
+  NERVE_ASSERT_PTR(k);
+  NERVE_ASSERT_PTR(v);
+
+  output::logger log(output::source::config);
+
+  char *end;
+  if (std::strcmp(k, "window_ms") == 0) {
+    const long ms = std::strtol(v, &end, 10);
+    if (*v == '\0' || *end != '\0' || ms < 0) {
+      log.error("degapifier: window_ms must be a number of milliseconds, not '%s'\n", v);
+      return;
+    }
+    window_us_ = (timestamp_type) ms * 1000;
+  }
+  else if (std::strcmp(k, "threshold_db") == 0) {
+    const double db = std::strtod(v, &end);
+    if (*v == '\0' || *end != '\0' || db > 0) {
+      log.error("degapifier: threshold_db must be a negative number of decibels, not '%s'\n", v);
+      return;
+    }
+    threshold_ = (float) std::pow(10.0, db / 10.0);
+  }
+  else {
+    log.warn("degapifier: unknown configuration key '%s'\n", k);
+  }
+}
+
+packet_return degapifier::process(packet *p) {
+  NERVE_CHECK_PTR(p);
+  NERVE_ASSERT(out_.empty(), "can't be given more while debuffering");
+
+  const pipeline::payload &pl = p->payload();
+  const pipeline::audio_format &fmt = pl.format();
+  if (pl.content() != pipeline::payload_content::samples || pl.empty() || ! fmt.rate() || ! fmt.frame_bytes()) {
+    this->release_held();
+    this->output(p);
+    return this->next_output();
+  }
+
+  if (this->new_track(pl)) {
+    state_ = state::head;
+  }
+
+  started_ = true;
+  format_ = fmt;
+  expected_ = pl.timestamp() + duration(pl);
+
+  if (state_ == state::head) {
+    this->head_step(p);
+  }
+  else {
+    this->body_step(p);
+  }
+
+  return this->next_output();
+}
+
+packet_return degapifier::debuffer() {
+  NERVE_ASSERT(! out_.empty(), "debuffer only when we said we were buffering");
+  return this->next_output();
+}
+
+void degapifier::head_step(packet *p) {
+  pipeline::payload &pl = p->payload();
+  const std::size_t frames = pl.frames();
+  const std::size_t window = us_to_frames(window_us_ - pl.timestamp(), pl.format().rate());
+  const std::size_t lead = this->leading_quiet(pl);
+
+  if (lead < frames && lead <= window) {
+    // Join the loud parts of both tracks.
+    this->drop_held();
+    this->trim_front(pl, lead);
+    state_ = state::body;
+    this->body_step(p);
+  }
+  else if (lead == frames && frames <= window) {
+    this->hold(p);
+  }
+  else {
+    // Too long to be a gap.
+    this->release_held();
+    state_ = state::body;
+    this->body_step(p);
+  }
+}
+
+void degapifier::body_step(packet *p) {
+  const pipeline::payload &pl = p->payload();
+  const std::size_t frames = pl.frames();
+  const std::size_t window = us_to_frames(window_us_, pl.format().rate());
+
+  std::size_t tail = this->trailing_quiet(pl);
+  if (frames - tail > window) {
+    tail = frames - window;
+  }
+
+  if (tail == frames) {
+    this->release_held();
+    this->output(p);
+  }
+  else if (tail == 0) {
+    this->hold(p);
+    this->limit_held();
+  }
+  else {
+    this->release_held();
+    packet *const q = this->split(p, tail);
+    this->output(p);
+    if (q) {
+      this->hold(q);
+      this->limit_held();
+    }
+  }
+}
+
+bool degapifier::quiet(const pipeline::payload &pl, std::size_t period) const {
+  const std::size_t channels = pl.format().channels();
+  const std::size_t first = period * period_frames;
+  const std::size_t frames = std::min(period_frames, pl.frames() - first);
+  const std::size_t start = first * channels;
+  const std::size_t count = frames * channels;
+
+  float ms = 0;
+  switch (pl.format().sample_format()) {
+  case pipeline::sample_format::s16:
+    ms = dsp::mean_square((const boost::int16_t *) pl.data() + start, count);
+    break;
+  case pipeline::sample_format::s32:
+    ms = dsp::mean_square((const boost::int32_t *) pl.data() + start, count);
+    break;
+  case pipeline::sample_format::flt:
+    ms = dsp::mean_square((const float *) pl.data() + start, count);
+    break;
+  case pipeline::sample_format::dbl:
+    ms = dsp::mean_square((const double *) pl.data() + start, count);
+    break;
+  case pipeline::sample_format::none:
+    NERVE_ABORT("can't measure samples of no format");
+  }
+
+  return ms < threshold_;
+}
+
+std::size_t degapifier::leading_quiet(const pipeline::payload &pl) const {
+  const std::size_t frames = pl.frames();
+  const std::size_t periods = (frames + period_frames - 1) / period_frames;
+  std::size_t i = 0;
+  while (i < periods && this->quiet(pl, i)) {
+    ++i;
+  }
+  return std::min(i * period_frames, frames);
+}
+
+std::size_t degapifier::trailing_quiet(const pipeline::payload &pl) const {
+  const std::size_t frames = pl.frames();
+  std::size_t i = (frames + period_frames - 1) / period_frames;
+  while (i > 0 && this->quiet(pl, i - 1)) {
+    --i;
+  }
+  return std::min(i * period_frames, frames);
+}
+
+bool degapifier::new_track(const pipeline::payload &pl) const {
+  return ! started_ || ! pl.format().same_as(format_) || pl.timestamp() + follow_on_us < expected_;
+}
+
+packet *degapifier::split(packet *p, std::size_t frame) {
+  pipeline::packet_pool *const pool = p->pool();
+  if (! pool) {
+    return NULL;
+  }
+
+  pipeline::payload &pl = p->payload();
+  const std::size_t before = frame * pl.format().frame_bytes();
+  const std::size_t after = pl.size() - before;
+
+  packet *const q = NERVE_CHECK_PTR(pool->acquire());
+  std::memcpy(q->storage(), (const unsigned char *) pl.data() + before, after);
+
+  pipeline::payload &ql = q->payload();
+  ql.clear();
+  ql.data(q->storage(), after);
+  ql.format(pl.format());
+  ql.timestamp(pl.timestamp() + frames_to_us(frame, pl.format().rate()));
+
+  pl.data(pl.data(), before);
+  return q;
+}
+
+void degapifier::trim_front(pipeline::payload &pl, std::size_t frames) {
+  const std::size_t bytes = frames * pl.format().frame_bytes();
+  pl.data((unsigned char *) pl.data() + bytes, pl.size() - bytes);
+  pl.timestamp(pl.timestamp() + frames_to_us(frames, pl.format().rate()));
+}
+
+void degapifier::hold(packet *p) {
+  held_.push_back(p);
+  held_us_ += duration(p->payload());
+}
+
+void degapifier::limit_held() {
+  while (! held_.empty() && held_us_ > window_us_) {
+    packet *const p = held_.front();
+    held_.pop_front();
+    held_us_ -= duration(p->payload());
+    this->output(p);
+  }
+}
+
+void degapifier::release_held() {
+  out_.insert(out_.end(), held_.begin(), held_.end());
+  held_.clear();
+  held_us_ = 0;
+}
+
+void degapifier::drop_held() {
+  std::for_each(held_.begin(), held_.end(), boost::bind(&packet::release, _1));
+  held_.clear();
+  held_us_ = 0;
+}
+
+packet_return degapifier::next_output() {
+  if (out_.empty()) {
+    return packet_return();
+  }
+
+  packet *const p = out_.front();
+  out_.pop_front();
+  return packet_return(p, ! out_.empty());
+}
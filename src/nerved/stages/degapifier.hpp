@@ -0,0 +1,116 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_DEGAPIFIER_HPP_c7r2pe9x
+#define STAGES_DEGAPIFIER_HPP_c7r2pe9x
+
+#include "interfaces.hpp"
+
+#include "../pipeline/payload.hpp"
+
+#include <deque>
+
+namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Cuts the silence out of track boundaries.  This is the packet-based
+   * version of the degapifier in gapless-proto.
+   *
+   * Samples are looked at in periods of period_frames.  A period is quiet
+   * when its RMS is below the threshold.  Quiet periods at the end of every
+   * packet are held back.  A packet which is quiet all the way through is
+   * held whole.  If the packet is only partly quiet, the quiet tail is copied
+   * into a packet from the same pool and the original is cut short.  Only
+   * the last window of silence is kept, and it's released as soon as
+   * something loud comes along in the same track.
+   *
+   * A new track starts when the timestamps go backwards or the format
+   * changes.  At the start of a track, quiet periods within the first window
+   * are held.  If something loud turns up in the window, the held silence
+   * from both tracks is dropped and the packet is trimmed to start at the
+   * loud part.  Otherwise everything is let go untouched, because a quiet
+   * intro is probably meant to be there.
+   *
+   * Since only silence is held, it can simply be dropped on finish and
+   * abandon.
+   *
+   * Configuration:
+   * - window_ms: longest silence trimmed from either side of a boundary
+   *   (default 100).
+   * - threshold_db: RMS in dBFS below which a period is quiet (default -60).
+   */
+  class degapifier : public pipeline::process_stage {
+    public:
+    //! Frames which are looked at together.  Trimming is to this precision.
+    static const std::size_t period_frames = 32;
+
+    degapifier();
+    ~degapifier();
+
+    void abandon();
+    void flush();
+    void finish();
+    void configure(const char *k, const char *v);
+    pipeline::packet_return process(pipeline::packet *);
+    pipeline::packet_return debuffer();
+
+    private:
+    typedef pipeline::payload::timestamp_type timestamp_type;
+
+    struct state {
+      enum id {
+        //! Looking for the first loud period of a track.
+        head,
+        //! Holding back the quiet end of every packet.
+        body
+      };
+    };
+
+    void head_step(pipeline::packet *);
+    void body_step(pipeline::packet *);
+
+    //! \name Measurement
+    //@{
+    bool quiet(const pipeline::payload &, std::size_t period) const;
+    //! Frames before the first loud period.
+    std::size_t leading_quiet(const pipeline::payload &) const;
+    //! Frame where the trailing quiet periods start.
+    std::size_t trailing_quiet(const pipeline::payload &) const;
+    //@}
+
+    //! \name Packet handling
+    //@{
+    bool new_track(const pipeline::payload &) const;
+    //! Cut off everything from the frame on and return it in a new packet.
+    pipeline::packet *split(pipeline::packet *, std::size_t frame);
+    void trim_front(pipeline::payload &, std::size_t frames);
+    void hold(pipeline::packet *);
+    //! Let the oldest held packets go until only the window is held.
+    void limit_held();
+    void release_held();
+    void drop_held();
+    void output(pipeline::packet *p) { out_.push_back(p); }
+    pipeline::packet_return next_output();
+    //@}
+
+    timestamp_type window_us_;
+    //! Mean square, which is cheaper to compare than RMS.
+    float threshold_;
+
+    state::id state_;
+    //! Format of the last packet.
+    pipeline::audio_format format_;
+    //! Timestamp of the packet which would follow the last one.
+    timestamp_type expected_;
+    //! Have we seen a packet since the last reset?
+    bool started_;
+
+    //! Silence which might be cut.
+    std::deque<pipeline::packet*> held_;
+    timestamp_type held_us_;
+    //! Waiting for debuffer().
+    std::deque<pipeline::packet*> out_;
+  };
+}
+
+#endif
@@ -0,0 +1,176 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "convert.hpp"
+#include "simd.hpp"
+
+#include <math.h>
+
+#include <cstring>
+
+#if NERVE_DSP_X86
+#  include <immintrin.h>
+#endif
+
+using boost::int16_t;
+using boost::int32_t;
+
+// Clamping is written as max then min the way the vector instructions do it,
+// which is also what sends NaN to the bottom.  Rounding is lrint's nearest,
+// ties to even, like cvtps2dq.
+
+namespace {
+  const float s16_scale = 32768.0f;
+  const float s16_unscale = 1.0f / 32768.0f;
+
+  //! \name Scalar
+  //@{
+  void to_float_s16_scalar(const int16_t *in, float *out, std::size_t n, std::size_t i) {
+    for (; i < n; ++i) {
+      out[i] = (float) in[i] * s16_unscale;
+    }
+  }
+
+  void from_float_s16_scalar(const float *in, int16_t *out, std::size_t n, std::size_t i) {
+    for (; i < n; ++i) {
+      float v = in[i] * s16_scale;
+      v = v > -32768.0f ? v : -32768.0f;
+      v = v < 32767.0f ? v : 32767.0f;
+      out[i] = (int16_t) ::lrintf(v);
+    }
+  }
+
+  void to_float_s16_c(const int16_t *in, float *out, std::size_t n) { to_float_s16_scalar(in, out, n, 0); }
+  void from_float_s16_c(const float *in, int16_t *out, std::size_t n) { from_float_s16_scalar(in, out, n, 0); }
+  //@}
+
+#if NERVE_DSP_X86
+  //! \name SSE2
+  //@{
+  NERVE_DSP_TARGET("sse2")
+  void to_float_s16_sse2(const int16_t *in, float *out, std::size_t n) {
+    const __m128 unscale = _mm_set1_ps(s16_unscale);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m128i x = _mm_loadu_si128((const __m128i *) (in + i));
+      const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+      const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+      _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), unscale));
+      _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), unscale));
+    }
+    to_float_s16_scalar(in, out, n, i);
+  }
+
+  NERVE_DSP_TARGET("sse2")
+  void from_float_s16_sse2(const float *in, int16_t *out, std::size_t n) {
+    const __m128 scale = _mm_set1_ps(s16_scale);
+    const __m128 bottom = _mm_set1_ps(-32768.0f);
+    const __m128 top = _mm_set1_ps(32767.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+      __m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+      a = _mm_min_ps(_mm_max_ps(a, bottom), top);
+      b = _mm_min_ps(_mm_max_ps(b, bottom), top);
+      const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+      _mm_storeu_si128((__m128i *) (out + i), packed);
+    }
+    from_float_s16_scalar(in, out, n, i);
+  }
+  //@}
+
+  //! \name AVX2
+  //@{
+  NERVE_DSP_TARGET("avx2")
+  void to_float_s16_avx2(const int16_t *in, float *out, std::size_t n) {
+    const __m256 unscale = _mm256_set1_ps(s16_unscale);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + i)));
+      const __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + i + 8)));
+      _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), unscale));
+      _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), unscale));
+    }
+    to_float_s16_scalar(in, out, n, i);
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  void from_float_s16_avx2(const float *in, int16_t *out, std::size_t n) {
+    const __m256 scale = _mm256_set1_ps(s16_scale);
+    const __m256 bottom = _mm256_set1_ps(-32768.0f);
+    const __m256 top = _mm256_set1_ps(32767.0f);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m256 a = _mm256_mul_ps(_mm256_loadu_ps(in + i), scale);
+      __m256 b = _mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale);
+      a = _mm256_min_ps(_mm256_max_ps(a, bottom), top);
+      b = _mm256_min_ps(_mm256_max_ps(b, bottom), top);
+      // Packing works within 128 bit lanes so the middle quarters need
+      // swapping back.
+      const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+      _mm256_storeu_si256((__m256i *) (out + i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    from_float_s16_scalar(in, out, n, i);
+  }
+  //@}
+#endif
+
+  struct convert_kernels {
+    void (*to_s16)(const int16_t *, float *, std::size_t);
+    void (*from_s16)(const float *, int16_t *, std::size_t);
+  };
+
+  const convert_kernels table[] = {
+    {&to_float_s16_c, &from_float_s16_c},
+#if NERVE_DSP_X86
+    {&to_float_s16_sse2, &from_float_s16_sse2},
+    {&to_float_s16_avx2, &from_float_s16_avx2},
+#endif
+  };
+
+  const convert_kernels &kernels() { return dsp::select_kernels(table); }
+}
+
+void dsp::to_float(const int16_t *in, float *out, std::size_t count) {
+  kernels().to_s16(in, out, count);
+}
+
+void dsp::from_float(const float *in, int16_t *out, std::size_t count) {
+  kernels().from_s16(in, out, count);
+}
+
+// The rest is either a copy or rare enough not to bother with vectors.
+
+void dsp::to_float(const int32_t *in, float *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = (float) in[i] * (1.0f / 2147483648.0f);
+  }
+}
+
+void dsp::to_float(const float *in, float *out, std::size_t count) {
+  std::memcpy(out, in, count * sizeof(float));
+}
+
+void dsp::to_float(const double *in, float *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = (float) in[i];
+  }
+}
+
+void dsp::from_float(const float *in, int32_t *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    double v = (double) in[i] * 2147483648.0;
+    v = v > -2147483648.0 ? v : -2147483648.0;
+    v = v < 2147483647.0 ? v : 2147483647.0;
+    out[i] = (int32_t) ::lrint(v);
+  }
+}
+
+void dsp::from_float(const float *in, float *out, std::size_t count) {
+  std::memcpy(out, in, count * sizeof(float));
+}
+
+void dsp::from_float(const float *in, double *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = (double) in[i];
+  }
+}
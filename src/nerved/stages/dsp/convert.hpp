@@ -0,0 +1,36 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_DSP_CONVERT_HPP_m4x9tb2e
+#define STAGES_DSP_CONVERT_HPP_m4x9tb2e
+
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+
+namespace dsp {
+  /*!
+   * \ingroup grp_stages
+   * \name Sample conversion kernels
+   *
+   * Convert samples to and from floats where full scale is 1.  Integers are
+   * divided by 2^15 or 2^31 on the way in and multiplied by it on the way out,
+   * then saturated and rounded to nearest.  NaN comes out as the most
+   * negative value.  Floats aren't clipped.
+   *
+   * The int16 kernels are the ones which matter and have vector versions.
+   * Every instruction set gives the same result (see simd.hpp).
+   */
+  //@{
+  void to_float(const boost::int16_t *in, float *out, std::size_t count);
+  void to_float(const boost::int32_t *in, float *out, std::size_t count);
+  void to_float(const float *in, float *out, std::size_t count);
+  void to_float(const double *in, float *out, std::size_t count);
+
+  void from_float(const float *in, boost::int16_t *out, std::size_t count);
+  void from_float(const float *in, boost::int32_t *out, std::size_t count);
+  void from_float(const float *in, float *out, std::size_t count);
+  void from_float(const float *in, double *out, std::size_t count);
+  //@}
+}
+
+#endif
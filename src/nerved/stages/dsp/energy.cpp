@@ -0,0 +1,181 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "energy.hpp"
+#include "simd.hpp"
+
+#if NERVE_DSP_X86
+#  include <immintrin.h>
+#endif
+
+using boost::int16_t;
+using boost::int32_t;
+using boost::uint64_t;
+
+// int16 squares are summed as integers so the order doesn't matter.  Float
+// squares go into eight running sums, one per lane of an AVX register, which
+// are then added pairwise.  The scalar and SSE2 versions copy that order.
+
+namespace {
+  const double s16_full_scale_squared = 32768.0 * 32768.0;
+
+  //! \name Scalar
+  //@{
+  uint64_t sum_squares_s16_scalar(const int16_t *s, std::size_t n, std::size_t j) {
+    uint64_t sum = 0;
+    for (; j < n; ++j) {
+      sum += (uint64_t) ((int32_t) s[j] * (int32_t) s[j]);
+    }
+    return sum;
+  }
+
+  float finish_s16(uint64_t sum, std::size_t n) {
+    return n ? (float) ((double) sum / ((double) n * s16_full_scale_squared)) : 0.0f;
+  }
+
+  //! Sums what the vector loop didn't cover.
+  float finish_flt(float sum, const float *s, std::size_t n, std::size_t j) {
+    for (; j < n; ++j) {
+      sum += s[j] * s[j];
+    }
+    return n ? sum / (float) n : 0.0f;
+  }
+
+  float mean_square_s16_c(const int16_t *s, std::size_t n) {
+    return finish_s16(sum_squares_s16_scalar(s, n, 0), n);
+  }
+
+  float mean_square_flt_c(const float *s, std::size_t n) {
+    float lanes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+      for (std::size_t k = 0; k < 8; ++k) {
+        lanes[k] += s[j + k] * s[j + k];
+      }
+    }
+
+    float t[4];
+    for (std::size_t k = 0; k < 4; ++k) {
+      t[k] = lanes[k] + lanes[k + 4];
+    }
+    return finish_flt((t[0] + t[2]) + (t[1] + t[3]), s, n, j);
+  }
+  //@}
+
+#if NERVE_DSP_X86
+  //! \name SSE2
+  //@{
+  NERVE_DSP_TARGET("sse2")
+  float mean_square_s16_sse2(const int16_t *s, std::size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+      const __m128i x = _mm_loadu_si128((const __m128i *) (s + j));
+      // Pairs of squares.  Only two -32768s make 2^31, which is fine
+      // unsigned.
+      const __m128i m = _mm_madd_epi16(x, x);
+      acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(m, zero));
+      acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(m, zero));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    return finish_s16(lanes[0] + lanes[1] + sum_squares_s16_scalar(s, n, j), n);
+  }
+
+  NERVE_DSP_TARGET("sse2")
+  float mean_square_flt_sse2(const float *s, std::size_t n) {
+    __m128 lo = _mm_setzero_ps();
+    __m128 hi = _mm_setzero_ps();
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+      const __m128 a = _mm_loadu_ps(s + j);
+      const __m128 b = _mm_loadu_ps(s + j + 4);
+      lo = _mm_add_ps(lo, _mm_mul_ps(a, a));
+      hi = _mm_add_ps(hi, _mm_mul_ps(b, b));
+    }
+
+    const __m128 t = _mm_add_ps(lo, hi);
+    const __m128 u = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    const float sum = _mm_cvtss_f32(_mm_add_ss(u, _mm_shuffle_ps(u, u, 1)));
+    return finish_flt(sum, s, n, j);
+  }
+  //@}
+
+  //! \name AVX2
+  //@{
+  NERVE_DSP_TARGET("avx2")
+  float mean_square_s16_avx2(const int16_t *s, std::size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+      const __m256i x = _mm256_loadu_si256((const __m256i *) (s + j));
+      const __m256i m = _mm256_madd_epi16(x, x);
+      acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(m)));
+      acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(m, 1)));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    return finish_s16(lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_squares_s16_scalar(s, n, j), n);
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  float mean_square_flt_avx2(const float *s, std::size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+      const __m256 a = _mm256_loadu_ps(s + j);
+      acc = _mm256_add_ps(acc, _mm256_mul_ps(a, a));
+    }
+
+    const __m128 t = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    const __m128 u = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    const float sum = _mm_cvtss_f32(_mm_add_ss(u, _mm_shuffle_ps(u, u, 1)));
+    return finish_flt(sum, s, n, j);
+  }
+  //@}
+#endif
+
+  struct energy_kernels {
+    float (*s16)(const int16_t *, std::size_t);
+    float (*flt)(const float *, std::size_t);
+  };
+
+  const energy_kernels table[] = {
+    {&mean_square_s16_c, &mean_square_flt_c},
+#if NERVE_DSP_X86
+    {&mean_square_s16_sse2, &mean_square_flt_sse2},
+    {&mean_square_s16_avx2, &mean_square_flt_avx2},
+#endif
+  };
+
+  const energy_kernels &kernels() { return dsp::select_kernels(table); }
+}
+
+float dsp::mean_square(const int16_t *samples, std::size_t count) {
+  return kernels().s16(samples, count);
+}
+
+float dsp::mean_square(const float *samples, std::size_t count) {
+  return kernels().flt(samples, count);
+}
+
+// Wider formats are rare enough not to bother with vectors.
+
+float dsp::mean_square(const int32_t *samples, std::size_t count) {
+  double sum = 0;
+  for (std::size_t j = 0; j < count; ++j) {
+    const double v = samples[j] / 2147483648.0;
+    sum += v * v;
+  }
+  return count ? (float) (sum / (double) count) : 0.0f;
+}
+
+float dsp::mean_square(const double *samples, std::size_t count) {
+  double sum = 0;
+  for (std::size_t j = 0; j < count; ++j) {
+    sum += samples[j] * samples[j];
+  }
+  return count ? (float) (sum / (double) count) : 0.0f;
+}
@@ -0,0 +1,30 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_DSP_ENERGY_HPP_w3k8zd1v
+#define STAGES_DSP_ENERGY_HPP_w3k8zd1v
+
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+
+namespace dsp {
+  /*!
+   * \ingroup grp_stages
+   * \name Energy kernels
+   *
+   * Mean of the squares of some samples where full scale is 1, so the RMS is
+   * the square root.  Zero if there are no samples.  Channels aren't
+   * separated.
+   *
+   * Every instruction set gives the same result (see simd.hpp).  The int16
+   * sums are exact.
+   */
+  //@{
+  float mean_square(const boost::int16_t *samples, std::size_t count);
+  float mean_square(const boost::int32_t *samples, std::size_t count);
+  float mean_square(const float *samples, std::size_t count);
+  float mean_square(const double *samples, std::size_t count);
+  //@}
+}
+
+#endif
@@ -0,0 +1,237 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "gain.hpp"
+#include "simd.hpp"
+
+#include <math.h>
+
+#if NERVE_DSP_X86
+#  include <immintrin.h>
+#endif
+
+using boost::int16_t;
+using boost::int32_t;
+
+// Rounding is lrint's nearest, ties to even (see simd.hpp).  Gains are worked
+// out as from + i * step the same way everywhere.
+
+namespace {
+  //! \name Scalar
+  //@{
+  void gain_s16_scalar(int16_t *s, std::size_t n, float from, float step, std::size_t i) {
+    for (; i < n; ++i) {
+      const float g = from + (float) i * step;
+      float v = (float) s[i] * g;
+      v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+      s[i] = (int16_t) ::lrintf(v);
+    }
+  }
+
+  void gain_s32_scalar(int32_t *s, std::size_t n, float from, float step, std::size_t i) {
+    for (; i < n; ++i) {
+      const float g = from + (float) i * step;
+      double v = (double) s[i] * (double) g;
+      v = v < -2147483648.0 ? -2147483648.0 : (v > 2147483647.0 ? 2147483647.0 : v);
+      s[i] = (int32_t) ::lrint(v);
+    }
+  }
+
+  void gain_flt_scalar(float *s, std::size_t n, float from, float step, std::size_t i) {
+    for (; i < n; ++i) {
+      const float g = from + (float) i * step;
+      s[i] *= g;
+    }
+  }
+
+  void gain_dbl_scalar(double *s, std::size_t n, float from, float step, std::size_t i) {
+    for (; i < n; ++i) {
+      const float g = from + (float) i * step;
+      s[i] *= (double) g;
+    }
+  }
+
+  void gain_s16_c(int16_t *s, std::size_t n, float from, float step) { gain_s16_scalar(s, n, from, step, 0); }
+  void gain_s32_c(int32_t *s, std::size_t n, float from, float step) { gain_s32_scalar(s, n, from, step, 0); }
+  void gain_flt_c(float *s, std::size_t n, float from, float step) { gain_flt_scalar(s, n, from, step, 0); }
+  void gain_dbl_c(double *s, std::size_t n, float from, float step) { gain_dbl_scalar(s, n, from, step, 0); }
+  //@}
+
+#if NERVE_DSP_X86
+  //! \name SSE2
+  //@{
+  NERVE_DSP_TARGET("sse2")
+  inline __m128 gains_sse2(std::size_t i, __m128 from, __m128 step) {
+    const __m128 index = _mm_add_ps(_mm_set1_ps((float) i), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+    return _mm_add_ps(from, _mm_mul_ps(index, step));
+  }
+
+  NERVE_DSP_TARGET("sse2")
+  void gain_s16_sse2(int16_t *s, std::size_t n, float from, float step) {
+    const __m128 f = _mm_set1_ps(from);
+    const __m128 st = _mm_set1_ps(step);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m128i x = _mm_loadu_si128((const __m128i *) (s + i));
+      // Sign extend by putting them in the top half and shifting down.
+      const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+      const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+      const __m128 vlo = _mm_mul_ps(_mm_cvtepi32_ps(lo), gains_sse2(i, f, st));
+      const __m128 vhi = _mm_mul_ps(_mm_cvtepi32_ps(hi), gains_sse2(i + 4, f, st));
+      _mm_storeu_si128((__m128i *) (s + i), _mm_packs_epi32(_mm_cvtps_epi32(vlo), _mm_cvtps_epi32(vhi)));
+    }
+    gain_s16_scalar(s, n, from, step, i);
+  }
+
+  NERVE_DSP_TARGET("sse2")
+  void gain_s32_sse2(int32_t *s, std::size_t n, float from, float step) {
+    const __m128 f = _mm_set1_ps(from);
+    const __m128 st = _mm_set1_ps(step);
+    const __m128d min = _mm_set1_pd(-2147483648.0);
+    const __m128d max = _mm_set1_pd(2147483647.0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m128i x = _mm_loadu_si128((const __m128i *) (s + i));
+      const __m128 g = gains_sse2(i, f, st);
+      __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(x), _mm_cvtps_pd(g));
+      __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)), _mm_cvtps_pd(_mm_movehl_ps(g, g)));
+      lo = _mm_min_pd(_mm_max_pd(lo, min), max);
+      hi = _mm_min_pd(_mm_max_pd(hi, min), max);
+      _mm_storeu_si128((__m128i *) (s + i), _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi)));
+    }
+    gain_s32_scalar(s, n, from, step, i);
+  }
+
+  NERVE_DSP_TARGET("sse2")
+  void gain_flt_sse2(float *s, std::size_t n, float from, float step) {
+    const __m128 f = _mm_set1_ps(from);
+    const __m128 st = _mm_set1_ps(step);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      _mm_storeu_ps(s + i, _mm_mul_ps(_mm_loadu_ps(s + i), gains_sse2(i, f, st)));
+    }
+    gain_flt_scalar(s, n, from, step, i);
+  }
+
+  NERVE_DSP_TARGET("sse2")
+  void gain_dbl_sse2(double *s, std::size_t n, float from, float step) {
+    const __m128 f = _mm_set1_ps(from);
+    const __m128 st = _mm_set1_ps(step);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const __m128 g = gains_sse2(i, f, st);
+      _mm_storeu_pd(s + i, _mm_mul_pd(_mm_loadu_pd(s + i), _mm_cvtps_pd(g)));
+      _mm_storeu_pd(s + i + 2, _mm_mul_pd(_mm_loadu_pd(s + i + 2), _mm_cvtps_pd(_mm_movehl_ps(g, g))));
+    }
+    gain_dbl_scalar(s, n, from, step, i);
+  }
+  //@}
+
+  //! \name AVX2
+  //@{
+  NERVE_DSP_TARGET("avx2")
+  inline __m256 gains_avx2(std::size_t i, __m256 from, __m256 step) {
+    const __m256 index = _mm256_add_ps(
+      _mm256_set1_ps((float) i),
+      _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f)
+    );
+    return _mm256_add_ps(from, _mm256_mul_ps(index, step));
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  void gain_s16_avx2(int16_t *s, std::size_t n, float from, float step) {
+    const __m256 f = _mm256_set1_ps(from);
+    const __m256 st = _mm256_set1_ps(step);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m256i x = _mm256_loadu_si256((const __m256i *) (s + i));
+      const __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x));
+      const __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1));
+      const __m256 vlo = _mm256_mul_ps(_mm256_cvtepi32_ps(lo), gains_avx2(i, f, st));
+      const __m256 vhi = _mm256_mul_ps(_mm256_cvtepi32_ps(hi), gains_avx2(i + 8, f, st));
+      // Packing works within each 128 bit lane so the quarters come out as
+      // lo0 hi0 lo1 hi1.
+      const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(vlo), _mm256_cvtps_epi32(vhi));
+      _mm256_storeu_si256((__m256i *) (s + i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    gain_s16_scalar(s, n, from, step, i);
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  void gain_s32_avx2(int32_t *s, std::size_t n, float from, float step) {
+    const __m256 f = _mm256_set1_ps(from);
+    const __m256 st = _mm256_set1_ps(step);
+    const __m256d min = _mm256_set1_pd(-2147483648.0);
+    const __m256d max = _mm256_set1_pd(2147483647.0);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256i x = _mm256_loadu_si256((const __m256i *) (s + i));
+      const __m256 g = gains_avx2(i, f, st);
+      __m256d lo = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), _mm256_cvtps_pd(_mm256_castps256_ps128(g)));
+      __m256d hi = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), _mm256_cvtps_pd(_mm256_extractf128_ps(g, 1)));
+      lo = _mm256_min_pd(_mm256_max_pd(lo, min), max);
+      hi = _mm256_min_pd(_mm256_max_pd(hi, min), max);
+      const __m256i out = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvtpd_epi32(lo)), _mm256_cvtpd_epi32(hi), 1);
+      _mm256_storeu_si256((__m256i *) (s + i), out);
+    }
+    gain_s32_scalar(s, n, from, step, i);
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  void gain_flt_avx2(float *s, std::size_t n, float from, float step) {
+    const __m256 f = _mm256_set1_ps(from);
+    const __m256 st = _mm256_set1_ps(step);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      _mm256_storeu_ps(s + i, _mm256_mul_ps(_mm256_loadu_ps(s + i), gains_avx2(i, f, st)));
+    }
+    gain_flt_scalar(s, n, from, step, i);
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  void gain_dbl_avx2(double *s, std::size_t n, float from, float step) {
+    const __m256 f = _mm256_set1_ps(from);
+    const __m256 st = _mm256_set1_ps(step);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const __m256 g = gains_avx2(i, f, st);
+      _mm256_storeu_pd(s + i, _mm256_mul_pd(_mm256_loadu_pd(s + i), _mm256_cvtps_pd(_mm256_castps256_ps128(g))));
+      _mm256_storeu_pd(s + i + 4, _mm256_mul_pd(_mm256_loadu_pd(s + i + 4), _mm256_cvtps_pd(_mm256_extractf128_ps(g, 1))));
+    }
+    gain_dbl_scalar(s, n, from, step, i);
+  }
+  //@}
+#endif
+
+  struct gain_kernels {
+    void (*s16)(int16_t *, std::size_t, float, float);
+    void (*s32)(int32_t *, std::size_t, float, float);
+    void (*flt)(float *, std::size_t, float, float);
+    void (*dbl)(double *, std::size_t, float, float);
+  };
+
+  const gain_kernels table[] = {
+    {&gain_s16_c, &gain_s32_c, &gain_flt_c, &gain_dbl_c},
+#if NERVE_DSP_X86
+    {&gain_s16_sse2, &gain_s32_sse2, &gain_flt_sse2, &gain_dbl_sse2},
+    {&gain_s16_avx2, &gain_s32_avx2, &gain_flt_avx2, &gain_dbl_avx2},
+#endif
+  };
+
+  const gain_kernels &kernels() { return dsp::select_kernels(table); }
+}
+
+void dsp::apply_gain(int16_t *samples, std::size_t count, float from, float step) {
+  kernels().s16(samples, count, from, step);
+}
+
+void dsp::apply_gain(int32_t *samples, std::size_t count, float from, float step) {
+  kernels().s32(samples, count, from, step);
+}
+
+void dsp::apply_gain(float *samples, std::size_t count, float from, float step) {
+  kernels().flt(samples, count, from, step);
+}
+
+void dsp::apply_gain(double *samples, std::size_t count, float from, float step) {
+  kernels().dbl(samples, count, from, step);
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_DSP_GAIN_HPP_h2c9wn4r
+#define STAGES_DSP_GAIN_HPP_h2c9wn4r
+
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+
+namespace dsp {
+  /*!
+   * \ingroup grp_stages
+   * \name Gain kernels
+   *
+   * Multiply interleaved samples in place.  Sample i is multiplied by
+   * `from + i * step`, so a ramp moves a tiny bit between the channels of a
+   * frame, which can't be heard and means the kernels don't need to know how
+   * many channels there are.  Use a step of 0 for a constant gain.
+   *
+   * Integers saturate and round to nearest.  Floats aren't clipped.  Every
+   * instruction set gives the same result (see simd.hpp).
+   *
+   * Integer gains must stay below 65536 so the intermediate fits an int32.
+   */
+  //@{
+  void apply_gain(boost::int16_t *samples, std::size_t count, float from, float step);
+  void apply_gain(boost::int32_t *samples, std::size_t count, float from, float step);
+  void apply_gain(float *samples, std::size_t count, float from, float step);
+  void apply_gain(double *samples, std::size_t count, float from, float step);
+  //@}
+}
+
+#endif
@@ -0,0 +1,237 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "resample.hpp"
+#include "simd.hpp"
+
+#include "../../util/asserts.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if NERVE_DSP_X86
+#  include <immintrin.h>
+#endif
+
+using dsp::resampler;
+using boost::uint64_t;
+
+// Taps always come in eights.  Products go into eight running sums, one per
+// lane of an AVX register, which are then added pairwise, the same as the
+// float energy kernels.
+
+namespace {
+  //! \name Dot products
+  //@{
+  float dot_c(const float *a, const float *b, std::size_t n) {
+    float lanes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (std::size_t j = 0; j < n; j += 8) {
+      for (std::size_t k = 0; k < 8; ++k) {
+        lanes[k] += a[j + k] * b[j + k];
+      }
+    }
+
+    float t[4];
+    for (std::size_t k = 0; k < 4; ++k) {
+      t[k] = lanes[k] + lanes[k + 4];
+    }
+    return (t[0] + t[2]) + (t[1] + t[3]);
+  }
+
+#if NERVE_DSP_X86
+  NERVE_DSP_TARGET("sse2")
+  float dot_sse2(const float *a, const float *b, std::size_t n) {
+    __m128 lo = _mm_setzero_ps();
+    __m128 hi = _mm_setzero_ps();
+    for (std::size_t j = 0; j < n; j += 8) {
+      lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j)));
+      hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(b + j + 4)));
+    }
+
+    const __m128 t = _mm_add_ps(lo, hi);
+    const __m128 u = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    return _mm_cvtss_f32(_mm_add_ss(u, _mm_shuffle_ps(u, u, 1)));
+  }
+
+  NERVE_DSP_TARGET("avx2")
+  float dot_avx2(const float *a, const float *b, std::size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (std::size_t j = 0; j < n; j += 8) {
+      acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j)));
+    }
+
+    const __m128 t = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    const __m128 u = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    return _mm_cvtss_f32(_mm_add_ss(u, _mm_shuffle_ps(u, u, 1)));
+  }
+#endif
+
+  struct dot_kernels {
+    float (*dot)(const float *, const float *, std::size_t);
+  };
+
+  const dot_kernels table[] = {
+    {&dot_c},
+#if NERVE_DSP_X86
+    {&dot_sse2},
+    {&dot_avx2},
+#endif
+  };
+  //@}
+
+  //! \name Filter design
+  //@{
+  struct design {
+    std::size_t taps;
+    //! Kaiser window shape.  Bigger is more stopband, wider transition.
+    double beta;
+    //! Cutoff as a fraction of the lower Nyquist frequency.
+    double cutoff;
+  };
+
+  const design designs[] = {
+    {16, 5.0, 0.85},
+    {32, 7.0, 0.90},
+    {64, 9.5, 0.95}
+  };
+
+  //! Modified Bessel function of the first kind, order 0.
+  double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double half = x / 2.0;
+    for (int k = 1; k < 50 && term > sum * 1e-12; ++k) {
+      term *= (half / k) * (half / k);
+      sum += term;
+    }
+    return sum;
+  }
+
+  const double pi = 3.14159265358979323846;
+
+  double sinc(double x) {
+    return x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+  }
+
+  uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b) {
+      const uint64_t t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+  //@}
+}
+
+const std::size_t resampler::max_phases;
+const std::size_t resampler::max_taps;
+
+resampler::resampler()
+: up_(1), down_(1), taps_(8), phases_(1), channels_(0), position_(0), fraction_(0)
+{}
+
+void resampler::setup(unsigned int in_rate, unsigned int out_rate, unsigned int channels, quality_type q) {
+  NERVE_ASSERT(in_rate && out_rate, "rates must be set");
+  NERVE_ASSERT(q <= quality::high, "quality out of range");
+
+  const uint64_t g = gcd(in_rate, out_rate);
+  up_ = out_rate / g;
+  down_ = in_rate / g;
+  channels_ = channels;
+  phases_ = (std::size_t) std::min<uint64_t>(up_, max_phases);
+
+  const design &d = designs[q];
+  const double ratio = std::min(1.0, (double) out_rate / in_rate);
+  const double fc = 0.5 * d.cutoff * ratio;
+
+  taps_ = (std::size_t) std::ceil(d.taps / ratio);
+  taps_ = std::min(max_taps, (taps_ + 7) & ~(std::size_t) 7);
+
+  const double half = (double) (taps_ / 2);
+  const double window_scale = 1.0 / bessel_i0(d.beta);
+  filter_.resize(phases_ * taps_);
+  for (std::size_t p = 0; p < phases_; ++p) {
+    const double frac = (double) p / phases_;
+    float *const coeffs = &filter_[p * taps_];
+
+    double sum = 0.0;
+    for (std::size_t t = 0; t < taps_; ++t) {
+      // Distance from the output sample to this tap's input sample.
+      const double x = ((double) t - half + 1.0 - frac) / half;
+      const double w = bessel_i0(d.beta * std::sqrt(std::max(0.0, 1.0 - x * x))) * window_scale;
+      const double h = 2.0 * fc * sinc(2.0 * fc * x * half) * w;
+      coeffs[t] = (float) h;
+      sum += h;
+    }
+
+    // Every phase passes DC at unity or there's a whine at the phase rate.
+    for (std::size_t t = 0; t < taps_; ++t) {
+      coeffs[t] = (float) (coeffs[t] / sum);
+    }
+  }
+
+  history_.resize(channels_);
+  this->reset();
+}
+
+void resampler::reset() {
+  // Start with the first real sample in the middle of the taps.
+  const std::size_t lead = taps_ / 2 - 1;
+  for (std::size_t c = 0; c < history_.size(); ++c) {
+    history_[c].assign(lead, 0.0f);
+  }
+  position_ = lead;
+  fraction_ = 0;
+}
+
+std::size_t resampler::max_output(std::size_t frames) const {
+  return (std::size_t) ((uint64_t) frames * up_ / down_) + 1;
+}
+
+std::size_t resampler::process(const float *in, std::size_t frames, float *out) {
+  NERVE_ASSERT(channels_ != 0, "setup() must be called first");
+
+  for (unsigned int c = 0; c < channels_; ++c) {
+    std::vector<float> &h = history_[c];
+    const std::size_t base = h.size();
+    h.resize(base + frames);
+    for (std::size_t i = 0; i < frames; ++i) {
+      h[base + i] = in[i * channels_ + c];
+    }
+  }
+
+  const dot_kernels &k = dsp::select_kernels(table);
+  const std::size_t half = taps_ / 2;
+  const std::size_t size = history_[0].size();
+  std::size_t written = 0;
+  while (position_ + half < size) {
+    const std::size_t phase = (std::size_t) (fraction_ * phases_ / up_);
+    const float *const coeffs = &filter_[phase * taps_];
+    const std::size_t first = position_ + 1 - half;
+    for (unsigned int c = 0; c < channels_; ++c) {
+      *out++ = k.dot(&history_[c][first], coeffs, taps_);
+    }
+    ++written;
+
+    fraction_ += down_;
+    position_ += (std::size_t) (fraction_ / up_);
+    fraction_ %= up_;
+  }
+
+  // Keep only what the next output will look at.
+  const std::size_t drop = std::min(position_ + 1 - half, size);
+  for (unsigned int c = 0; c < channels_; ++c) {
+    history_[c].erase(history_[c].begin(), history_[c].begin() + drop);
+  }
+  position_ -= drop;
+
+  return written;
+}
+
+std::size_t resampler::flush(float *out) {
+  // Enough silence to move the last real input past the middle of the taps.
+  const std::vector<float> silence(this->delay() * channels_, 0.0f);
+  const std::size_t written = this->process(&silence[0], this->delay(), out);
+  this->reset();
+  return written;
+}
@@ -0,0 +1,100 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_DSP_RESAMPLE_HPP_k7d2vq5s
+#define STAGES_DSP_RESAMPLE_HPP_k7d2vq5s
+
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace dsp {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Changes the sample rate of interleaved floats with a polyphase
+   * windowed-sinc filter.
+   *
+   * The ratio is reduced to up/down and the position of each output sample
+   * is kept exactly as a whole number of input samples and a fraction over
+   * up, so there's no drift however long the stream is.  Each fraction has
+   * its own set of taps (a phase).  When there would be too many phases,
+   * nearby fractions share one.
+   *
+   * The quality sets the number of taps, the Kaiser window and how close to
+   * Nyquist the cutoff is.  Every output sample costs taps() multiply-adds
+   * per channel, so the cost is fixed by the quality and the rates.  Taps
+   * are scaled up when downsampling so the cutoff can move down.
+   *
+   * Output is delayed by half the taps.  flush() pushes that out at the end
+   * of the stream and reset() throws it away.
+   *
+   * The sums are vectorised and every instruction set gives the same output
+   * (see simd.hpp).
+   */
+  class resampler : boost::noncopyable {
+    public:
+    //! A namespace for the quality enum.
+    struct quality {
+      enum id {
+        low,
+        medium,
+        high
+      };
+    };
+
+    typedef quality::id quality_type;
+
+    //! Most phases in the filter table.
+    static const std::size_t max_phases = 1024;
+    //! Most taps per phase however much we're downsampling.
+    static const std::size_t max_taps = 256;
+
+    resampler();
+
+    //! Design the filter and reset.
+    void setup(unsigned int in_rate, unsigned int out_rate, unsigned int channels, quality_type q);
+
+    //! Forget the history, as if starting a new stream.
+    void reset();
+
+    //! The most frames process() writes for this many frames in.
+    std::size_t max_output(std::size_t frames) const;
+
+    //! Returns the number of frames written to out.
+    std::size_t process(const float *in, std::size_t frames, float *out);
+
+    //! Input frames which are still in the filter.
+    std::size_t delay() const { return taps_ / 2; }
+
+    //! Write what's left of the stream and reset.  Writes at most
+    //! max_output(delay()) frames; returns how many.
+    std::size_t flush(float *out);
+
+    //! Multiply-adds per output sample.
+    std::size_t taps() const { return taps_; }
+    std::size_t phases() const { return phases_; }
+
+    private:
+    //! Pairs of frames which line up.  Output frame n is at input frame
+    //! n * down / up.
+    boost::uint64_t up_;
+    boost::uint64_t down_;
+
+    std::size_t taps_;
+    std::size_t phases_;
+    unsigned int channels_;
+    //! The taps of each phase one after the other.
+    std::vector<float> filter_;
+
+    //! Input samples of each channel which are still needed.
+    std::vector<std::vector<float> > history_;
+    //! Whole part of the position of the next output in history_.
+    std::size_t position_;
+    //! Fractional part over up_.
+    boost::uint64_t fraction_;
+  };
+}
+
+#endif
@@ -0,0 +1,60 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "simd.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace {
+  dsp::cpu_features detect() {
+    dsp::cpu_features f;
+    f.sse2 = false;
+    f.avx2 = false;
+
+#if NERVE_DSP_X86
+    // We might be called before the library's own initialiser.
+    __builtin_cpu_init();
+    f.sse2 = __builtin_cpu_supports("sse2");
+    f.avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    return f;
+  }
+
+  // Nothing is better than avx2.
+  boost::atomic<int> limit(dsp::isa::avx2);
+}
+
+const dsp::cpu_features &dsp::cpu() {
+  // Local so that other static initialisers can use it.
+  static const cpu_features detected = detect();
+  return detected;
+}
+
+dsp::isa::id dsp::best_isa() {
+  const int highest = limit.load(boost::memory_order_relaxed);
+  if (cpu().avx2 && highest >= isa::avx2) {
+    return isa::avx2;
+  }
+  else if (cpu().sse2 && highest >= isa::sse2) {
+    return isa::sse2;
+  }
+  return isa::scalar;
+}
+
+void dsp::limit_isa(isa::id highest) {
+  limit.store(highest, boost::memory_order_relaxed);
+}
+
+const char *dsp::isa_name(isa::id i) {
+  switch (i) {
+  case isa::scalar:
+    return "scalar";
+  case isa::sse2:
+    return "sse2";
+  case isa::avx2:
+    return "avx2";
+  }
+
+  NERVE_ABORT("impossible isa");
+  return NULL;
+}
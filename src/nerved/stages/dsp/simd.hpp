@@ -0,0 +1,97 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+/*!
+ * \file
+ *
+ * What's needed to write vector kernels and pick between them at runtime.
+ *
+ * Kernels for a particular instruction set are written as ordinary functions
+ * marked with NERVE_DSP_TARGET, so the rest of the build doesn't need any
+ * -m flags and the binary runs on any x86.  Only use the intrinsics inside
+ * `#if NERVE_DSP_X86` and only call them when cpu() says it's OK.
+ *
+ * Each file puts its kernels in a struct of function pointers and makes a
+ * table of them indexed by isa; select_kernels() picks from it.
+ *
+ * Every instruction set gives exactly the same output as the scalar
+ * kernels, so output can be compared byte for byte between machines (and
+ * the tests do).  That means sums are always added up in the same order,
+ * which the scalar kernels copy from the widest vector, everything rounds
+ * to nearest with ties to even the way the vector conversions do, and the
+ * build turns off contraction into fused multiply-adds for the kernel files.
+ */
+
+#ifndef STAGES_DSP_SIMD_HPP_f5u8kq2w
+#define STAGES_DSP_SIMD_HPP_f5u8kq2w
+
+// Target attributes with intrinsics need gcc 4.9.  Define NERVE_DSP_X86 to 0
+// to build only the scalar kernels.
+#ifndef NERVE_DSP_X86
+#  if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#    define NERVE_DSP_X86 1
+#  else
+#    define NERVE_DSP_X86 0
+#  endif
+#endif
+
+#if NERVE_DSP_X86
+#  define NERVE_DSP_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define NERVE_DSP_TARGET(isa)
+#endif
+
+#include "../../util/asserts.hpp"
+
+#include <cstddef>
+
+namespace dsp {
+  //! \ingroup grp_stages
+  //! Instruction sets which kernels can use.  All false when NERVE_DSP_X86 is
+  //! off.
+  struct cpu_features {
+    bool sse2;
+    bool avx2;
+  };
+
+  //! \ingroup grp_stages
+  //! Detected on the first call.
+  const cpu_features &cpu();
+
+  //! \ingroup grp_stages
+  //! Instruction sets in the order of a table of kernels.
+  struct isa {
+    enum id {
+      scalar,
+      sse2,
+      avx2
+    };
+  };
+
+  //! \ingroup grp_stages
+  //! The best which cpu() has and which isn't above the limit.  Always
+  //! scalar when NERVE_DSP_X86 is off.
+  isa::id best_isa();
+
+  //! \ingroup grp_stages
+  //! Never use anything better than this, e.g to compare the kernels.  Not
+  //! for when kernels are running in other threads.
+  void limit_isa(isa::id highest);
+
+  //! \ingroup grp_stages
+  //! For logging.
+  const char *isa_name(isa::id);
+
+  //! \ingroup grp_stages
+  //! The kernels to use from a table indexed by isa.  Without NERVE_DSP_X86
+  //! the table only needs the scalar ones.
+  template<class Kernels, std::size_t N>
+  const Kernels &select_kernels(const Kernels (&table)[N]) {
+    const std::size_t i = (std::size_t) best_isa();
+    NERVE_ASSERT(i < N, "the table must have kernels for every isa the cpu might have");
+    return table[i];
+  }
+}
+
+#endif
@@ -0,0 +1,76 @@
+// Copyright (C) 2008-2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "audio_stream.hpp"
+#include "decode_audio.hpp"
+#include "file.hpp"
+
+#include "../../output/logging.hpp"
+#include "../../util/asserts.hpp"
+
+using namespace ffmpeg;
+
+bool audio_stream::open(ffmpeg::file &f) {
+  NERVE_ASSERT(f.is_open(), "can't find a stream in a file which isn't open");
+  this->close();
+
+  output::logger log(output::source::pipeline);
+
+  AVStream *const found = find_audio_stream(f);
+  if (! found) {
+    log.error("%s: no audio stream found\n", f.file_name());
+    return false;
+  }
+
+  AVCodecContext *const ctx = NERVE_CHECK_PTR(found->codec);
+  AVCodec *const codec = ::avcodec_find_decoder(ctx->codec_id);
+  if (! codec) {
+    log.error("%s: unsupported codec (id %d)\n", f.file_name(), (int) ctx->codec_id);
+    return false;
+  }
+
+  boost::mutex::scoped_lock lock(codec_mutex());
+  if (::avcodec_open(ctx, codec) < 0) {
+    log.error("%s: could not initialise the codec\n", f.file_name());
+    return false;
+  }
+
+  stream_ = found;
+  codec_ = codec;
+  return true;
+}
+
+void audio_stream::close() {
+  if (stream_) {
+    boost::mutex::scoped_lock lock(codec_mutex());
+    ::avcodec_close(stream_->codec);
+    stream_ = NULL;
+    codec_ = NULL;
+  }
+}
+
+pipeline::audio_format audio_stream::format() const {
+  return decoded_format(av_codec_context());
+}
+
+namespace {
+  // Constructed before there are threads to race on it.
+  boost::mutex codec_open_mutex;
+}
+
+boost::mutex &ffmpeg::codec_mutex() {
+  return codec_open_mutex;
+}
+
+AVStream *ffmpeg::find_audio_stream(ffmpeg::file &f) {
+  NERVE_ASSERT(f.is_open(), "can't find a stream in a file which isn't open");
+
+  // TODO:
+  //   It would be nicer to inspect all the streams and choose the best one.
+  AVFormatContext *const fmt = f.av_format_context();
+  for (std::size_t i = 0; i < f.num_streams(); ++i) {
+    if (NERVE_CHECK_PTR(fmt->streams[i])->codec->codec_type == CODEC_TYPE_AUDIO) {
+      return fmt->streams[i];
+    }
+  }
+  return NULL;
+}
@@ -3,16 +3,76 @@
 #ifndef STAGES_FFMPEG_AUDIO_STREAM_HPP_svxdkfa8
 #define STAGES_FFMPEG_AUDIO_STREAM_HPP_svxdkfa8
 
+#include "avlibs.hpp"
+
+#include "../../pipeline/payload.hpp"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+#include <algorithm> // swap
+
 namespace ffmpeg {
-  struct file;
+  class file;
 
   //! \ingroup grp_ffmpeg
-  //! Reference to an audio stream in a given file.
-  class audio_stream {
+  //! Reference to an audio stream in a given file and the open decoder for it.
+  //! The file must outlive it.
+  class audio_stream : boost::noncopyable {
     public:
+    //! \name Resources
+    //@{
+
+    audio_stream() : stream_(NULL), codec_(NULL) {}
+    ~audio_stream() { this->close(); }
+
+    //! Find the first audio stream and open a decoder for it.  False if there
+    //! isn't one or the codec isn't supported, in which case nothing is open.
     bool open(ffmpeg::file &f);
-    void swap(audio_stream &other);
+    void close();
+    bool is_open() const { return stream_ != NULL; }
+
+    void swap(audio_stream &other) {
+      std::swap(this->stream_, other.stream_);
+      std::swap(this->codec_, other.codec_);
+    }
+
+    //@}
+
+    //! Index of the stream in the file's frames.
+    int index() const { return stream_->index; }
+
+    //! Throw away anything the decoder has buffered, e.g after a seek.
+    void flush() { ::avcodec_flush_buffers(&av_codec_context()); }
+
+    //! What the decoder produces.  The sample format is none if it's
+    //! something the pipeline doesn't deal with.
+    pipeline::audio_format format() const;
+
+    //! Timestamps of frames are in this.
+    AVRational time_base_q() const { return stream_->time_base; }
+
+    //! \name FFmpeg Accessors
+    //@{
+    AVStream &av_stream() { return *stream_; }
+    const AVStream &av_stream() const { return *stream_; }
+    AVCodecContext &av_codec_context() { return *stream_->codec; }
+    const AVCodecContext &av_codec_context() const { return *stream_->codec; }
+    //@}
+
+    private:
+    AVStream *stream_;
+    AVCodec *codec_;
   };
+
+  //! \ingroup grp_ffmpeg
+  //! The first audio stream in the file, or NULL.  Nothing is opened.
+  AVStream *find_audio_stream(ffmpeg::file &);
+
+  //! \ingroup grp_ffmpeg
+  //! avcodec_open and avcodec_close aren't thread-safe so anything which
+  //! calls them holds this.
+  boost::mutex &codec_mutex();
 }
 
 #endif
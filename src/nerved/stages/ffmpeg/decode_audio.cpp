@@ -0,0 +1,63 @@
+// Copyright (C) 2008-2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "decode_audio.hpp"
+#include "audio_stream.hpp"
+#include "frame.hpp"
+
+#include "../../util/asserts.hpp"
+
+#include <climits>
+
+bool ffmpeg::decode_audio(sample_buffer &dest, audio_source &source) {
+  return decode_audio(dest, source.frame(), source.stream().av_codec_context());
+}
+
+bool ffmpeg::decode_audio(sample_buffer &dest, ffmpeg::frame &fr, AVCodecContext &codec) {
+  NERVE_CHECK_PTR(dest.data());
+  NERVE_ASSERT(dest.capacity() >= AVCODEC_MAX_AUDIO_FRAME_SIZE, "ffmpeg won't decode into less than this");
+  NERVE_ASSERT(((std::size_t) dest.data() & 15) == 0, "ffmpeg needs aligned output");
+
+  AVCodecContext *const ctx = &codec;
+  int16_t *const out = (int16_t *) dest.data();
+  const int capacity = dest.capacity() > INT_MAX ? INT_MAX : (int) dest.capacity();
+
+  dest.size(0);
+
+  // Some codecs give nothing until they've had a few goes at the data.
+  while (! fr.consumed()) {
+    int size = capacity;
+    const int used = ::avcodec_decode_audio3(ctx, out, &size, &fr.remaining_packet());
+    if (used < 0) {
+      fr.consume(fr.remaining());
+      return false;
+    }
+
+    fr.consume(used);
+
+    if (size > 0) {
+      dest.size((std::size_t) size);
+      return true;
+    }
+    else if (used == 0) {
+      // It wants no more of this frame.
+      fr.consume(fr.remaining());
+    }
+  }
+
+  return true;
+}
+
+pipeline::audio_format ffmpeg::decoded_format(const AVCodecContext &ctx) {
+  using pipeline::sample_format;
+
+  sample_format::id sf;
+  switch (ctx.sample_fmt) {
+  case SAMPLE_FMT_S16: sf = sample_format::s16; break;
+  case SAMPLE_FMT_S32: sf = sample_format::s32; break;
+  case SAMPLE_FMT_FLT: sf = sample_format::flt; break;
+  case SAMPLE_FMT_DBL: sf = sample_format::dbl; break;
+  default: sf = sample_format::none; break;
+  }
+
+  return pipeline::audio_format(sf, (unsigned int) ctx.channels, (unsigned int) ctx.sample_rate);
+}
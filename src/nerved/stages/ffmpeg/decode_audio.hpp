@@ -3,35 +3,75 @@
 #ifndef STAGES_FFMPEG_DECODE_AUDIO_HPP_l3499fbm
 #define STAGES_FFMPEG_DECODE_AUDIO_HPP_l3499fbm
 
+#include "avlibs.hpp"
+
+#include "../../pipeline/payload.hpp"
+
+#include <cstddef>
+
 namespace ffmpeg {
   class audio_stream;
   class frame;
 
   //! \ingroup grp_ffmpeg
-  //! Basically just a specially aligned buffer.  Used with decoding.
+  //! Specially aligned memory which is decoded into.  It doesn't own the
+  //! memory; normally it's a pipeline packet's storage so that the samples
+  //! never need to be copied.
   class sample_buffer {
     public:
+    sample_buffer() : data_(NULL), capacity_(0), size_(0) {}
+
+    //! Decode into this memory from now on.  It must be aligned to at least
+    //! 16 bytes and be no smaller than AVCODEC_MAX_AUDIO_FRAME_SIZE.
+    void reset(void *data, std::size_t capacity) {
+      data_ = data;
+      capacity_ = capacity;
+      size_ = 0;
+    }
+
+    void *data() const { return data_; }
+    std::size_t capacity() const { return capacity_; }
+
+    //! Bytes which were decoded.
+    std::size_t size() const { return size_; }
+    void size(std::size_t s) { size_ = s; }
+
+    private:
+    void *data_;
+    std::size_t capacity_;
+    std::size_t size_;
   };
 
   //! \ingroup grp_ffmpeg
   //! A simple convenience structure which puts an audio stream with a
-  //! frame read from a file.
+  //! frame read from a file.  Decoding uses up the frame.
   class audio_source {
     public:
-
-    // TODO:
-    //   Constness might not be right.
-
-    audio_source(const frame &f, audio_stream &s)
+    audio_source(ffmpeg::frame &f, audio_stream &s)
     : stream_(s), frame_(f) { }
 
+    audio_stream &stream() { return stream_; }
+    ffmpeg::frame &frame() { return frame_; }
+
     private:
     audio_stream &stream_;
-    const frame &frame_;
+    ffmpeg::frame &frame_;
   };
 
   //! \ingroup grp_ffmpeg
-  //! Decode from +source+ into +dest+.
-  void decode_audio(sample_buffer &dest, audio_source &source);
+  //! Decode from +source+ into +dest+ until at least one sample is produced or
+  //! the frame is used up.  The size of +dest+ is set to the bytes decoded,
+  //! which can be zero.  False if the codec gives up on the frame, in which
+  //! case the rest of it is dropped.
+  bool decode_audio(sample_buffer &dest, audio_source &source);
+
+  //! \ingroup grp_ffmpeg
+  //! As above but with any open decoder.
+  bool decode_audio(sample_buffer &dest, ffmpeg::frame &, AVCodecContext &);
+
+  //! \ingroup grp_ffmpeg
+  //! What an open decoder produces.  The sample format is none if it's
+  //! something the pipeline doesn't deal with.
+  pipeline::audio_format decoded_format(const AVCodecContext &);
 }
 #endif
@@ -0,0 +1,150 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "decoder.hpp"
+#include "audio_stream.hpp"
+#include "decode_audio.hpp"
+
+#include "../../output/logging.hpp"
+#include "../../util/asserts.hpp"
+
+#include <boost/cstdint.hpp>
+
+#include <cstring>
+
+using ffmpeg::decoder;
+
+namespace {
+  // Both ends are in the same process so there's no need to care about
+  // endianness or versions.  The magic number catches a config which pairs
+  // the decoder with something else.
+  struct codec_header {
+    static const boost::uint32_t magic_value = 0x6e766368;
+
+    boost::uint32_t magic;
+    boost::int32_t codec_id;
+    boost::int32_t sample_rate;
+    boost::int32_t channels;
+    boost::int32_t sample_fmt;
+    boost::int32_t bits_per_coded_sample;
+    boost::int32_t block_align;
+    boost::int32_t bit_rate;
+    boost::int32_t frame_size;
+    boost::int32_t extradata_size;
+    // Followed by the extradata.
+  };
+}
+
+std::size_t ffmpeg::write_codec_header(void *dest, std::size_t capacity, const AVCodecContext &ctx) {
+  NERVE_ASSERT_PTR(dest);
+
+  const std::size_t extra = ctx.extradata ? (std::size_t) ctx.extradata_size : 0;
+  const std::size_t size = sizeof(codec_header) + extra;
+  if (size > capacity) {
+    return 0;
+  }
+
+  codec_header h;
+  h.magic = codec_header::magic_value;
+  h.codec_id = ctx.codec_id;
+  h.sample_rate = ctx.sample_rate;
+  h.channels = ctx.channels;
+  h.sample_fmt = ctx.sample_fmt;
+  h.bits_per_coded_sample = ctx.bits_per_coded_sample;
+  h.block_align = ctx.block_align;
+  h.bit_rate = ctx.bit_rate;
+  h.frame_size = ctx.frame_size;
+  h.extradata_size = (boost::int32_t) extra;
+
+  unsigned char *const out = (unsigned char *) dest;
+  std::memcpy(out, &h, sizeof(h));
+  if (extra) {
+    std::memcpy(out + sizeof(h), ctx.extradata, extra);
+  }
+  return size;
+}
+
+bool decoder::open(const void *header, const std::size_t size) {
+  NERVE_ASSERT_PTR(header);
+  this->close();
+
+  output::logger log(output::source::pipeline);
+
+  codec_header h;
+  if (size < sizeof(h)) {
+    log.error("ffmpeg decoder: codec header is too small\n");
+    return false;
+  }
+
+  std::memcpy(&h, header, sizeof(h));
+  if (h.magic != codec_header::magic_value || h.extradata_size < 0 || size < sizeof(h) + h.extradata_size) {
+    log.error("ffmpeg decoder: not a codec header from the ffmpeg demuxer\n");
+    return false;
+  }
+
+  AVCodec *const codec = ::avcodec_find_decoder((CodecID) h.codec_id);
+  if (! codec) {
+    log.error("ffmpeg decoder: unsupported codec (id %d)\n", (int) h.codec_id);
+    return false;
+  }
+
+  context_ = ::avcodec_alloc_context();
+  if (! context_) {
+    log.error("ffmpeg decoder: couldn't allocate a codec context\n");
+    return false;
+  }
+
+  context_->codec_type = CODEC_TYPE_AUDIO;
+  context_->codec_id = (CodecID) h.codec_id;
+  context_->sample_rate = h.sample_rate;
+  context_->channels = h.channels;
+  context_->sample_fmt = (SampleFormat) h.sample_fmt;
+  context_->bits_per_coded_sample = h.bits_per_coded_sample;
+  context_->block_align = h.block_align;
+  context_->bit_rate = h.bit_rate;
+  context_->frame_size = h.frame_size;
+
+  if (h.extradata_size > 0) {
+    // Decoders read past the end with no checks so it must be padded.
+    context_->extradata = (uint8_t *) ::av_mallocz(h.extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (! context_->extradata) {
+      log.error("ffmpeg decoder: couldn't allocate the codec's extra data\n");
+      this->close();
+      return false;
+    }
+    std::memcpy(context_->extradata, (const unsigned char *) header + sizeof(h), h.extradata_size);
+    context_->extradata_size = h.extradata_size;
+  }
+
+  bool opened;
+  {
+    boost::mutex::scoped_lock lock(codec_mutex());
+    opened = ::avcodec_open(context_, codec) >= 0;
+  }
+
+  if (! opened) {
+    log.error("ffmpeg decoder: could not initialise the codec\n");
+    this->close();
+    return false;
+  }
+
+  codec_ = codec;
+  return true;
+}
+
+void decoder::close() {
+  if (codec_) {
+    boost::mutex::scoped_lock lock(codec_mutex());
+    ::avcodec_close(context_);
+    codec_ = NULL;
+  }
+
+  if (context_) {
+    ::av_freep(&context_->extradata);
+    ::av_free(context_);
+    context_ = NULL;
+  }
+}
+
+pipeline::audio_format decoder::format() const {
+  return decoded_format(av_codec_context());
+}
@@ -0,0 +1,61 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_FFMPEG_DECODER_HPP_r8c1kxuw
+#define STAGES_FFMPEG_DECODER_HPP_r8c1kxuw
+
+#include "avlibs.hpp"
+
+#include "../../pipeline/payload.hpp"
+
+#include <boost/utility.hpp>
+
+#include <cstddef>
+
+namespace ffmpeg {
+  //! \ingroup grp_ffmpeg
+  //! Timestamp of compressed data when the demuxer doesn't know it.  The
+  //! decoder carries on counting from the samples instead.
+  const pipeline::payload::timestamp_type unknown_timestamp = -1;
+
+  //! \ingroup grp_ffmpeg
+  //! Copy what's needed to open a decoder out of a demuxer's codec context so
+  //! that it can go down the pipeline.  Returns the bytes written, or zero if
+  //! it needs more than capacity.
+  std::size_t write_codec_header(void *dest, std::size_t capacity, const AVCodecContext &);
+
+  /*!
+   * \ingroup grp_ffmpeg
+   *
+   * A decoder which isn't attached to a file.  It's opened from a header made
+   * by write_codec_header(), so the demuxer can be on another thread (or
+   * already on to the next file) without the two sharing anything.
+   */
+  class decoder : boost::noncopyable {
+    public:
+    decoder() : context_(NULL), codec_(NULL) {}
+    ~decoder() { this->close(); }
+
+    //! False if the header is bad or the codec can't be opened, in which case
+    //! nothing is open.
+    bool open(const void *header, std::size_t size);
+    void close();
+    bool is_open() const { return codec_ != NULL; }
+
+    //! Throw away anything buffered, e.g after a seek.
+    void flush() { ::avcodec_flush_buffers(context_); }
+
+    pipeline::audio_format format() const;
+
+    //! \name FFmpeg Accessors
+    //@{
+    AVCodecContext &av_codec_context() { return *context_; }
+    const AVCodecContext &av_codec_context() const { return *context_; }
+    //@}
+
+    private:
+    AVCodecContext *context_;
+    AVCodec *codec_;
+  };
+}
+
+#endif
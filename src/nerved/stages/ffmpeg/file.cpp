@@ -1,11 +1,26 @@
 // Copyright (C) 2008-2011, James Webber.
 // Distributed under a 3-clause BSD license.  See COPYING.
 #include "file.hpp"
+#include "frame.hpp"
+
+#include "../../output/logging.hpp"
+#include "../../util/asserts.hpp"
+
+#include <boost/thread/once.hpp>
 
 using namespace ffmpeg;
 
-file::file(const char *const file) {
-  // I need a get_last_error message function, or at least some kind of errno?.
+namespace {
+  boost::once_flag registered = BOOST_ONCE_INIT;
+
+  void register_formats() { ::av_register_all(); }
+}
+
+bool file::open(const char *const file) {
+  boost::call_once(registered, &register_formats);
+  this->close();
+
+  output::logger log(output::source::pipeline);
 
   // no docs somewhere...
   // TODO: I will need to use this later on.
@@ -13,51 +28,26 @@ file::file(const char *const file) {
   // http://www.dranger.com/ffmpeg/data.html#AVFormatParameters
   AVFormatParameters *const parameters = NULL;
   // what is this buffer size for?
-  const std::size_t buffer_size = 0;
+  const int buffer_size = 0;
 
-  int ret = ::av_open_input_file(&format_, file, forced_format, buffer_size, parameters);
+  int ret = ::av_open_input_file(&format_, NERVE_CHECK_PTR(file), forced_format, buffer_size, parameters);
   if (ret != 0) {
     // TODO: why?  Have to do some of my own validation here I guess.
-    throw file_error("couldn't open file");
+    log.error("%s: couldn't open file (error %d)\n", file, ret);
+    format_ = NULL;
+    return false;
   }
-  assert(format_ != NULL);
+  NERVE_CHECK_PTR(format_);
 
+  // Note: this is negative on error in the newer ffmpegs.
   ret = ::av_find_stream_info(format_);
-  // TODO:
-  //   this fails whenever I open one of my .avi with error code 22.  I can't work
-  //   out what this means, and since the code is exactly the same as the tutorial
-  //   it's a bit of a mystery.
-  if (ret != 0) {
-    std::cerr << "error num: " <<  ret << " becomes " << strerror(ret) << std::endl;
-    // TODO: say why.
-    //
-    switch (ret) {
-      // case AVERROR_UNKNOWN: // duplicated AVERROR_INVALIDDATA
-      // std::cout << "AVERROR_UNKNOWN" << std::endl; break;
-    case AVERROR_IO:
-      std::cout << "AVERROR_IO" << std::endl; break;
-    case AVERROR_NUMEXPECTED:
-      std::cout << "AVERROR_NUMEXPECTED" << std::endl; break;
-    case AVERROR_INVALIDDATA:
-      std::cout << "AVERROR_INVALIDDATA" << std::endl; break;
-    case AVERROR_NOMEM:
-      std::cout << "AVERROR_NOMEM" << std::endl; break;
-    case AVERROR_NOFMT:
-      std::cout << "AVERROR_NOFMT" << std::endl; break;
-    case AVERROR_NOTSUPP:
-      std::cout << "AVERROR_NOTSUPP" << std::endl; break;
-    case AVERROR_NOENT:
-      std::cout << "AVERROR_NOENT" << std::endl; break;
-    case AVERROR_EOF:
-      std::cout << "AVERROR_EOF" << std::endl; break;
-    case AVERROR_PATCHWELCOME:
-      std::cout << "AVERROR_PATCHWELCOME" << std::endl; break;
-    default:
-      std::cout << "unexpected error code" << std::endl; break;
-    }
-
-    throw stream_error("could not find codec parameters");
+  if (ret < 0) {
+    log.error("%s: could not find codec parameters (error %d)\n", file, ret);
+    this->close();
+    return false;
   }
+
+  return true;
 }
 
 void file::dump() const {
@@ -67,8 +57,7 @@ void file::dump() const {
   ::dump_format(format_, index, file_name(), is_output);
 }
 
-
-human_duration_type file::human_durtion() const {
+file::human_duration_type file::human_durtion() const {
   human_duration_type d;
   d.secs = duration() / AV_TIME_BASE;
   const int us = duration() % AV_TIME_BASE;
@@ -79,3 +68,23 @@ human_duration_type file::human_durtion() const {
   d.ms = (100 * us) / AV_TIME_BASE;
   return d;
 }
+
+bool ffmpeg::read_frame(ffmpeg::frame &fr, ffmpeg::file &f) {
+  NERVE_ASSERT(f.is_open(), "can't read from a file which isn't open");
+  fr.clear();
+
+  AVPacket &p = fr.av_packet();
+  if (::av_read_frame(f.av_format_context(), &p) < 0) {
+    return false;
+  }
+
+  // Otherwise the data belongs to the demuxer and goes away on the next read,
+  // which would be a problem for anything which queues frames.
+  if (::av_dup_packet(&p) < 0) {
+    fr.clear();
+    return false;
+  }
+
+  fr.reset_remaining();
+  return true;
+}
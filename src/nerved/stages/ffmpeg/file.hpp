@@ -8,7 +8,7 @@
 #include <algorithm> // swap
 
 namespace ffmpeg {
-  struct frame;
+  class frame;
 
   //! \ingroup grp_ffmpeg
   //! Human-readable duration.
@@ -32,13 +32,18 @@ namespace ffmpeg {
 
     file() : format_(NULL) {}
     //! Open the header and inspect the streams.
-    file(const char * const file) { this->open(file); }
-    ~file() {
+    file(const char * const file) : format_(NULL) { this->open(file); }
+    ~file() { this->close(); }
+    //! Open the header and inspect the streams.  False if it can't be
+    //! played, in which case nothing is open.
+    bool open(const char *const);
+    void close() {
       if (format_) {
         ::av_close_input_file(format_);
+        format_ = NULL;
       }
     }
-    bool open(const char *const);
+    bool is_open() const { return format_ != NULL; }
     void swap(ffmpeg::file &other) {
       std::swap(this->format_, other.format_);
     }
@@ -102,14 +107,15 @@ namespace ffmpeg {
     //@}
 
     //! Print the format to stderr.
-    void dump();
+    void dump() const;
 
     private:
     AVFormatContext *format_;
   };
 
   //! \ingroup grp_ffmpeg
-  //! Read a frame out of file.
-  void read_frame(ffmpeg::frame &, ffmpeg::file &);
+  //! Read the next frame of any stream out of file.  The frame owns its data
+  //! afterwards.  False at the end of the file or on an error.
+  bool read_frame(ffmpeg::frame &, ffmpeg::file &);
 }
 #endif
@@ -3,10 +3,98 @@
 #ifndef STAGES_FFMPEG_FRAME_HPP_sswqquz5
 #define STAGES_FFMPEG_FRAME_HPP_sswqquz5
 
+#include "avlibs.hpp"
+
+#include <boost/utility.hpp>
+
+#include <cstring>
+
 namespace ffmpeg {
   //! \ingroup grp_ffmpeg
-  //! A frame which is read from a file.
-  class frame {
+  //! A frame which is read from a file, i.e an AVPacket of compressed data.
+  //! It owns the packet's data.  Some codecs decode a packet in more than one
+  //! go so the frame remembers how much of it is left.
+  class frame : boost::noncopyable {
+    public:
+    frame() : end_(false) {
+      ::av_init_packet(&packet_);
+      packet_.data = NULL;
+      packet_.size = 0;
+      remaining_ = packet_;
+    }
+
+    ~frame() { ::av_free_packet(&packet_); }
+
+    //! Drop the data so the frame can be read into again.
+    void clear() {
+      ::av_free_packet(&packet_);
+      ::av_init_packet(&packet_);
+      packet_.data = NULL;
+      packet_.size = 0;
+      remaining_ = packet_;
+      end_ = false;
+    }
+
+    //! Called after reading into av_packet().
+    void reset_remaining() { remaining_ = packet_; }
+
+    //! Copy compressed data in from somewhere other than a file, e.g a
+    //! pipeline packet.  False if it couldn't be allocated.
+    bool assign(const void *data, int size) {
+      this->clear();
+      // This pads it as the decoders need.
+      if (::av_new_packet(&packet_, size) != 0) {
+        return false;
+      }
+      std::memcpy(packet_.data, data, size);
+      remaining_ = packet_;
+      return true;
+    }
+
+    //! \name Stream end
+    //! A frame with no data which marks the end of what was read.
+    //@{
+    bool end() const { return end_; }
+    void end(bool e) { end_ = e; }
+    //@}
+
+    //! \name Packet accessors
+    //@{
+    int stream_index() const { return packet_.stream_index; }
+    //! In the stream's time base.  AV_NOPTS_VALUE if it's not known.
+    int64_t presentation_timestamp() const { return packet_.pts; }
+    //@}
+
+    //! \name Decoding
+    //@{
+
+    //! Bytes which are yet to be decoded.
+    int remaining() const { return remaining_.size; }
+    bool consumed() const { return remaining_.size <= 0; }
+    //! Has none of it been decoded yet?
+    bool untouched() const { return remaining_.data == packet_.data; }
+
+    //! The undecoded part as a packet for the decoder.
+    AVPacket &remaining_packet() { return remaining_; }
+
+    //! Mark n bytes as decoded.
+    void consume(int n) {
+      remaining_.data += n;
+      remaining_.size -= n;
+    }
+
+    //@}
+
+    //! \name FFmpeg Accessors
+    //@{
+    const AVPacket &av_packet() const { return packet_; }
+    AVPacket &av_packet() { return packet_; }
+    //@}
+
+    private:
+    AVPacket packet_;
+    AVPacket remaining_;
+    bool end_;
   };
 }
 
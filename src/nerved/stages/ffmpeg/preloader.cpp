@@ -0,0 +1,141 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "preloader.hpp"
+#include "decode_audio.hpp"
+
+#include "../../pipeline/packet.hpp"
+#include "../../pipeline/packet_pool.hpp"
+#include "../../output/logging.hpp"
+#include "../../util/asserts.hpp"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+using ffmpeg::preloader;
+
+void preloader::cue(const char *path, pipeline::packet_pool *pool) {
+  NERVE_ASSERT_PTR(path);
+  this->cancel();
+
+  path_ = path;
+  pool_ = pool;
+  cancel_.store(false);
+  thread_.reset(new boost::thread(boost::bind(&preloader::preload_thread, this)));
+}
+
+void preloader::cancel() {
+  if (! thread_) {
+    return;
+  }
+
+  cancel_.store(true);
+  thread_->join();
+  thread_.reset();
+  this->close();
+}
+
+bool preloader::take(ffmpeg::file &f, ffmpeg::audio_stream &s, preroll_type &preroll) {
+  if (! thread_) {
+    return false;
+  }
+
+  thread_->join();
+  thread_.reset();
+
+  const bool ok = ok_;
+  if (ok) {
+    f.swap(file_);
+    s.swap(stream_);
+    preroll.swap(preroll_);
+  }
+
+  // Which is now the old track if it worked.
+  this->close();
+  return ok;
+}
+
+void preloader::close() {
+  // The stream refers to the file.
+  stream_.close();
+  file_.close();
+  frame_.clear();
+  std::for_each(preroll_.begin(), preroll_.end(), boost::bind(&pipeline::packet::release, _1));
+  preroll_.clear();
+  ok_ = false;
+}
+
+void preloader::preload_thread() {
+  ok_ = false;
+
+  if (! file_.open(path_.c_str())) {
+    return;
+  }
+
+  if (! stream_.open(file_)) {
+    this->close();
+    return;
+  }
+
+  const pipeline::audio_format format = stream_.format();
+  if (format.sample_format() == pipeline::sample_format::none || ! format.rate() || ! format.channels()) {
+    output::logger log(output::source::pipeline);
+    log.error("%s: the decoder's output format isn't supported\n", path_.c_str());
+    this->close();
+    return;
+  }
+
+  if (! this->preroll()) {
+    this->close();
+    return;
+  }
+
+  ok_ = true;
+}
+
+bool preloader::preroll() {
+  const pipeline::audio_format format = stream_.format();
+  const std::size_t want = (std::size_t) format.rate() * preroll_ms_ / 1000 * format.frame_bytes();
+
+  if (want == 0 || ! pool_) {
+    return true;
+  }
+
+  sample_buffer buffer;
+  std::size_t have = 0;
+  while (have < want) {
+    if (cancel_.load()) {
+      return false;
+    }
+
+    // A track shorter than the preroll.  The read-ahead finds the end later.
+    if (! read_frame(frame_, file_)) {
+      break;
+    }
+
+    if (frame_.stream_index() != stream_.index()) {
+      continue;
+    }
+
+    while (! frame_.consumed()) {
+      pipeline::packet *const p = NERVE_CHECK_PTR(pool_->acquire());
+      buffer.reset(p->storage(), pipeline::packet::storage_size);
+      if (! decode_audio(buffer, frame_, stream_.av_codec_context())) {
+        output::logger log(output::source::pipeline);
+        log.warn("%s: dropped a frame which couldn't be decoded\n", path_.c_str());
+      }
+
+      if (buffer.size() == 0) {
+        p->release();
+        continue;
+      }
+
+      p->payload().data(p->storage(), buffer.size());
+      preroll_.push_back(p);
+      have += buffer.size();
+    }
+  }
+
+  frame_.clear();
+  return true;
+}
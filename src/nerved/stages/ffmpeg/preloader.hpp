@@ -0,0 +1,89 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_FFMPEG_PRELOADER_HPP_d4kr9bte
+#define STAGES_FFMPEG_PRELOADER_HPP_d4kr9bte
+
+#include "file.hpp"
+#include "audio_stream.hpp"
+#include "frame.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+#include <deque>
+#include <string>
+
+namespace pipeline {
+  class packet;
+  class packet_pool;
+}
+
+namespace ffmpeg {
+  /*!
+   * \ingroup grp_ffmpeg
+   *
+   * Opens the next track on a helper thread and decodes the start of it, so
+   * that going from one track to the next costs a few swaps rather than an
+   * open, a probe and a decode.
+   *
+   * Only whole frames are pre-decoded so the file is left exactly where the
+   * samples end.  They're decoded straight into packets from the pipeline's
+   * pool, one decode per packet the same as the normal read, so they can be
+   * sent on as they are.  Everything is used from the one pipeline thread;
+   * the helper thread is joined before anything it made is touched.
+   */
+  class preloader : boost::noncopyable {
+    public:
+    //! Packets whose payload has only the data set.  Whoever has them owns
+    //! them.
+    typedef std::deque<pipeline::packet*> preroll_type;
+
+    static const unsigned int default_preroll_ms = 200;
+
+    preloader() : preroll_ms_(default_preroll_ms), pool_(NULL), ok_(false), cancel_(false) {}
+    ~preloader() { this->cancel(); }
+
+    //! How much to decode in advance.  Zero means only open it.
+    void preroll_ms(unsigned int ms) { preroll_ms_ = ms; }
+    unsigned int preroll_ms() const { return preroll_ms_; }
+
+    //! Start on the track in the background.  Anything cued before is thrown
+    //! away.  The path is copied.  The preroll comes from the pool; without
+    //! one the track is only opened.
+    void cue(const char *path, pipeline::packet_pool *pool);
+
+    //! Throw away the cued track.  Waits for the helper thread.
+    void cancel();
+
+    //! Is there a track cued (ready or not)?
+    bool cued() const { return thread_.get() != NULL; }
+
+    //! Wait for the cued track and swap it into the arguments.  Whatever was
+    //! in them is closed.  False if it couldn't be opened, in which case the
+    //! arguments are left alone.  Either way nothing is cued afterwards.
+    bool take(ffmpeg::file &, ffmpeg::audio_stream &, preroll_type &preroll);
+
+    private:
+    void preload_thread();
+    //! Returns false if it was cancelled.
+    bool preroll();
+    void close();
+
+    unsigned int preroll_ms_;
+
+    std::string path_;
+    pipeline::packet_pool *pool_;
+    ffmpeg::file file_;
+    ffmpeg::audio_stream stream_;
+    ffmpeg::frame frame_;
+    preroll_type preroll_;
+    bool ok_;
+
+    boost::scoped_ptr<boost::thread> thread_;
+    boost::atomic<bool> cancel_;
+  };
+}
+
+#endif
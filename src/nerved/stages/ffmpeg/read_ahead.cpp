@@ -0,0 +1,88 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "read_ahead.hpp"
+#include "file.hpp"
+
+#include "../../util/asserts.hpp"
+
+#include <boost/bind.hpp>
+
+using ffmpeg::read_ahead;
+
+void read_ahead::depth(std::size_t d) {
+  NERVE_ASSERT(! frames_, "can't change the depth once frames are allocated");
+  NERVE_ASSERT(d > 0, "must read at least one frame ahead");
+  depth_ = d;
+}
+
+void read_ahead::allocate() {
+  // One more than the frames so nothing ever throttles on the high mark.
+  const para::pipe_limits limits(depth_ + 1, depth_ + 1, depth_ / 2);
+  free_.limits(limits);
+  filled_.limits(limits);
+
+  frames_.reset(new frame[depth_]);
+  for (std::size_t i = 0; i < depth_; ++i) {
+    frame *f = &frames_[i];
+    free_.write(f);
+  }
+}
+
+void read_ahead::start(ffmpeg::file &f, int stream_index) {
+  NERVE_ASSERT(! running_, "must stop the read-ahead before starting it again");
+  NERVE_ASSERT(f.is_open(), "can't read ahead from a file which isn't open");
+
+  if (! frames_) {
+    this->allocate();
+  }
+
+  stop_.store(false);
+  ended_ = false;
+  running_ = true;
+  thread_.reset(new boost::thread(boost::bind(&read_ahead::reader_thread, this, boost::ref(f), stream_index)));
+}
+
+void read_ahead::stop() {
+  if (! running_) {
+    return;
+  }
+
+  // The reader might be waiting for a free frame so we have to keep feeding
+  // them back until it notices.
+  stop_.store(true);
+  while (! ended_) {
+    this->recycle(this->next());
+  }
+
+  thread_->join();
+  thread_.reset();
+  running_ = false;
+}
+
+ffmpeg::frame *read_ahead::next() {
+  NERVE_ASSERT(running_, "can't read frames without starting");
+  NERVE_ASSERT(! ended_, "there are no frames after the end");
+  frame *const f = NERVE_CHECK_PTR(filled_.read());
+  ended_ = f->end();
+  return f;
+}
+
+void read_ahead::reader_thread(ffmpeg::file &f, const int stream_index) {
+  for (;;) {
+    frame *fr = free_.read();
+
+    bool ok = ! stop_.load();
+    while (ok && (ok = read_frame(*fr, f)) && fr->stream_index() != stream_index) {
+      ok = ! stop_.load();
+    }
+
+    if (! ok) {
+      fr->clear();
+      fr->end(true);
+      filled_.write(fr);
+      return;
+    }
+
+    filled_.write(fr);
+  }
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_FFMPEG_READ_AHEAD_HPP_q0e4wzdn
+#define STAGES_FFMPEG_READ_AHEAD_HPP_q0e4wzdn
+
+#include "frame.hpp"
+
+#include "../../para/pipes.hpp"
+#include "../../util/asserts.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+#include <cstddef>
+
+namespace ffmpeg {
+  class file;
+
+  /*!
+   * \ingroup grp_ffmpeg
+   *
+   * Demuxes a file on its own thread so that a slow read only stalls the
+   * decoder when the whole queue has been used up.  There is a fixed number of
+   * frames which go round two single-producer single-consumer pipes: the
+   * reader takes a free frame, fills it from the file and passes it on; the
+   * decoder takes a filled frame and gives it back when it's used it.
+   *
+   * Only frames of the given stream are passed on.  The last frame is marked
+   * with end() and has no data.  Everything other than the constructor and
+   * depth() must be called from the one decoding thread.
+   */
+  class read_ahead : boost::noncopyable {
+    public:
+    static const std::size_t default_depth = 32;
+
+    read_ahead() : depth_(default_depth), running_(false), ended_(false), stop_(false) {}
+    ~read_ahead() { this->stop(); }
+
+    //! Number of frames which may be read ahead.  Can't be changed once
+    //! started for the first time.
+    void depth(std::size_t d);
+    std::size_t depth() const { return depth_; }
+
+    //! Start reading frames of the stream index.  The file must stay open
+    //! until stop().
+    void start(ffmpeg::file &, int stream_index);
+
+    //! Stop and join the thread.  Frames which were read and not taken are
+    //! thrown away.  Every frame taken by next() must be recycled first.
+    void stop();
+
+    bool running() const { return running_; }
+
+    //! Take the next frame, waiting for the reader if there isn't one.  Must
+    //! be recycled after.  After the end frame there are no more.
+    frame *next();
+
+    //! Give back a frame from next().
+    void recycle(frame *f) {
+      NERVE_ASSERT_PTR(f);
+      free_.write(f);
+    }
+
+    private:
+    typedef para::parking_sync<boost::condition_variable, boost::mutex> sync_type;
+    typedef para::pipe<frame*, sync_type, para::ring_queue_selector> pipe_type;
+
+    void allocate();
+    void reader_thread(ffmpeg::file &, int stream_index);
+
+    std::size_t depth_;
+    boost::scoped_array<frame> frames_;
+
+    //! Decoder writes, reader reads.
+    pipe_type free_;
+    //! Reader writes, decoder reads.  Always has room for every frame so the
+    //! reader never waits on it.
+    pipe_type filled_;
+
+    boost::scoped_ptr<boost::thread> thread_;
+    bool running_;
+    //! Has the decoder had the end frame?
+    bool ended_;
+    boost::atomic<bool> stop_;
+  };
+}
+
+#endif
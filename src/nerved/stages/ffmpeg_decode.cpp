@@ -0,0 +1,134 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "ffmpeg_decode.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../pipeline/packet_pool.hpp"
+#include "../pipeline/packet_return.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+namespace ff = ::ffmpeg;
+using stages::ffmpeg_decode;
+using pipeline::packet;
+using pipeline::packet_return;
+
+void ffmpeg_decode::abandon() {
+  this->drop_held();
+  frame_.clear();
+  if (decoder_.is_open()) {
+    decoder_.flush();
+  }
+}
+
+void ffmpeg_decode::flush() {
+}
+
+void ffmpeg_decode::finish() {
+  this->drop_held();
+  frame_.clear();
+  decoder_.close();
+}
+
+void ffmpeg_decode::configure(const char *k, const char *) {
+  NERVE_ASSERT_PTR(k);
+  output::logger log(output::source::config);
+  log.warn("ffmpeg_decode: unknown configuration key '%s'\n", k);
+}
+
+packet_return ffmpeg_decode::process(packet *p) {
+  NERVE_CHECK_PTR(p);
+  NERVE_ASSERT(held_ == NULL, "can't be given more while debuffering");
+
+  const pipeline::payload &pl = p->payload();
+
+  switch (pl.content()) {
+  case pipeline::payload_content::samples:
+    return packet_return(p);
+  case pipeline::payload_content::codec_header:
+    frame_.clear();
+    next_timestamp_ = 0;
+    if (decoder_.open(pl.data(), pl.size())) {
+      if (decoder_.format().sample_format() == pipeline::sample_format::none) {
+        output::logger log(output::source::pipeline);
+        log.error("ffmpeg_decode: the decoder's sample format isn't supported\n");
+        decoder_.close();
+      }
+    }
+    p->release();
+    return packet_return();
+  case pipeline::payload_content::compressed:
+    break;
+  }
+
+  if (! decoder_.is_open() || ! frame_.assign(pl.data(), (int) pl.size())) {
+    p->release();
+    return packet_return();
+  }
+
+  if (pl.timestamp() != ff::unknown_timestamp) {
+    next_timestamp_ = pl.timestamp();
+  }
+
+  // The compressed data was copied out so p can be decoded into.
+  if (! this->decode_into(p)) {
+    p->release();
+    return packet_return();
+  }
+
+  return this->decode_ahead(p);
+}
+
+packet_return ffmpeg_decode::debuffer() {
+  packet *const out = NERVE_CHECK_PTR(held_);
+  held_ = NULL;
+  return this->decode_ahead(out);
+}
+
+packet_return ffmpeg_decode::decode_ahead(packet *out) {
+  if (! frame_.consumed()) {
+    packet *const next = NERVE_CHECK_PTR(NERVE_CHECK_PTR(out->pool())->acquire());
+    if (this->decode_into(next)) {
+      held_ = next;
+      return packet_return(out, true);
+    }
+    next->release();
+  }
+
+  return packet_return(out);
+}
+
+bool ffmpeg_decode::decode_into(packet *p) {
+  buffer_.reset(p->storage(), packet::storage_size);
+
+  if (! ff::decode_audio(buffer_, frame_, decoder_.av_codec_context())) {
+    output::logger log(output::source::pipeline);
+    log.warn("ffmpeg_decode: dropped a frame which couldn't be decoded\n");
+  }
+
+  if (buffer_.size() == 0) {
+    return false;
+  }
+
+  // Cheap, and it keeps up if the decoder changes its mind.
+  const pipeline::audio_format &format = generations_.stamp(decoder_.format());
+
+  pipeline::payload &pl = p->payload();
+  pl.clear();
+  pl.data(buffer_.data(), buffer_.size());
+  pl.format(format);
+  pl.timestamp(next_timestamp_);
+
+  if (format.rate()) {
+    next_timestamp_ += (pipeline::payload::timestamp_type) pl.frames() * AV_TIME_BASE / format.rate();
+  }
+
+  return true;
+}
+
+void ffmpeg_decode::drop_held() {
+  if (held_) {
+    held_->release();
+    held_ = NULL;
+  }
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_FFMPEG_DECODE_HPP_m3z7sqpe
+#define STAGES_FFMPEG_DECODE_HPP_m3z7sqpe
+
+#include "interfaces.hpp"
+
+#include "ffmpeg/decoder.hpp"
+#include "ffmpeg/decode_audio.hpp"
+#include "ffmpeg/frame.hpp"
+
+#include "../pipeline/payload.hpp"
+
+namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Decodes what an ffmpeg_demux stage reads.  Packets of samples pass through
+   * untouched and anything else is dropped.
+   *
+   * A compressed frame can decode to more than one packet.  The first one
+   * reuses the input packet and the rest come from its pool.  One packet is
+   * always decoded ahead so we only say we're buffering when there really is
+   * more to come.
+   */
+  class ffmpeg_decode : public pipeline::process_stage {
+    public:
+    ffmpeg_decode() : held_(NULL), next_timestamp_(0) {}
+    ~ffmpeg_decode() { this->drop_held(); }
+
+    void abandon();
+    void flush();
+    void finish();
+    void configure(const char *k, const char *v);
+    pipeline::packet_return process(pipeline::packet *);
+    pipeline::packet_return debuffer();
+
+    private:
+    //! Returns out, and holds the next packet if the frame has any more.
+    pipeline::packet_return decode_ahead(pipeline::packet *out);
+    //! Decode as much as one packet's worth.  False if there were no samples.
+    bool decode_into(pipeline::packet *);
+    void drop_held();
+
+    ::ffmpeg::decoder decoder_;
+    ::ffmpeg::frame frame_;
+    ::ffmpeg::sample_buffer buffer_;
+
+    //! Decoded and waiting for debuffer().
+    pipeline::packet *held_;
+    pipeline::payload::timestamp_type next_timestamp_;
+    pipeline::format_generations generations_;
+  };
+}
+
+#endif
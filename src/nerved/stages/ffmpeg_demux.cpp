@@ -0,0 +1,174 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "ffmpeg_demux.hpp"
+
+#include "ffmpeg/audio_stream.hpp"
+#include "ffmpeg/decoder.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <cstring>
+
+namespace ff = ::ffmpeg;
+using stages::ffmpeg_demux;
+
+void ffmpeg_demux::abandon() {
+}
+
+void ffmpeg_demux::flush() {
+}
+
+void ffmpeg_demux::finish() {
+}
+
+void ffmpeg_demux::configure(const char *k, const char *) {
+  NERVE_ASSERT_PTR(k);
+  output::logger log(output::source::config);
+  log.warn("ffmpeg_demux: unknown configuration key '%s'\n", k);
+}
+
+void ffmpeg_demux::skip(skip_type loc) {
+  if (loc) {
+    output::logger log(output::source::pipeline);
+    log.warn("ffmpeg_demux: can only skip to the end of the track\n");
+    return;
+  }
+
+  if (! file_.is_open()) {
+    return;
+  }
+
+  this->unload();
+  finish_pending_ = ! this->next_track();
+}
+
+void ffmpeg_demux::load(load_type loc) {
+  next_.clear();
+
+  // The file says why it couldn't be opened.
+  ff::file new_file;
+  if (! new_file.open(loc)) {
+    output::logger log(output::source::pipeline);
+    log.error("%s: not loaded\n", loc);
+    return;
+  }
+
+  AVStream *const new_stream = ff::find_audio_stream(new_file);
+  if (! new_stream) {
+    output::logger log(output::source::pipeline);
+    log.error("%s: no audio stream found\n", loc);
+    return;
+  }
+
+  this->unload();
+  finish_pending_ = false;
+  file_.swap(new_file);
+  stream_ = new_stream;
+  header_pending_ = true;
+}
+
+void ffmpeg_demux::cue(load_type loc) {
+  NERVE_ASSERT_PTR(loc);
+  next_ = loc;
+}
+
+void ffmpeg_demux::unload() {
+  frame_.clear();
+  file_.close();
+  stream_ = NULL;
+  header_pending_ = false;
+}
+
+bool ffmpeg_demux::next_track() {
+  if (next_.empty()) {
+    return false;
+  }
+
+  // The decoder is told about the new codec in the usual way.
+  const std::string next = next_;
+  this->load(next.c_str());
+  return file_.is_open();
+}
+
+pipeline::packet *ffmpeg_demux::read(pipeline::packet *p) {
+  NERVE_CHECK_PTR(p);
+  pipeline::payload &pl = p->payload();
+  pl.clear();
+
+  if (finish_pending_) {
+    finish_pending_ = false;
+    p->event(pipeline::packet::event::finish);
+    return p;
+  }
+
+  // Not asked while we're idle, but an empty packet does no harm.
+  if (! file_.is_open()) {
+    return p;
+  }
+
+  unsigned char *const storage = p->storage();
+  const std::size_t capacity = pipeline::packet::storage_size;
+  const AVCodecContext &ctx = *NERVE_CHECK_PTR(stream_->codec);
+
+  if (header_pending_) {
+    header_pending_ = false;
+    const std::size_t size = ff::write_codec_header(storage, capacity, ctx);
+    if (size == 0) {
+      output::logger log(output::source::pipeline);
+      log.error("%s: codec header doesn't fit in a packet\n", file_.file_name());
+      this->unload();
+      p->event(pipeline::packet::event::finish);
+      return p;
+    }
+
+    pl.data(storage, size);
+    pl.content(pipeline::payload_content::codec_header);
+    return p;
+  }
+
+  for (;;) {
+    if (! ff::read_frame(frame_, file_)) {
+      this->unload();
+      if (this->next_track()) {
+        return this->read(p);
+      }
+
+      p->event(pipeline::packet::event::finish);
+      return p;
+    }
+
+    if (frame_.stream_index() != stream_->index) {
+      continue;
+    }
+
+    if ((std::size_t) frame_.remaining() > capacity) {
+      output::logger log(output::source::pipeline);
+      log.warn("%s: dropped a frame of %d bytes which doesn't fit in a packet\n", file_.file_name(), frame_.remaining());
+      continue;
+    }
+
+    break;
+  }
+
+  const AVPacket &av = frame_.av_packet();
+  std::memcpy(storage, av.data, av.size);
+  pl.data(storage, av.size);
+  pl.content(pipeline::payload_content::compressed);
+  pl.format(pipeline::audio_format(pipeline::sample_format::none, ctx.channels, ctx.sample_rate));
+
+  if (av.pts == AV_NOPTS_VALUE) {
+    pl.timestamp(ff::unknown_timestamp);
+  }
+  else {
+    const int64_t start = stream_->start_time == AV_NOPTS_VALUE ? 0 : stream_->start_time;
+    pl.timestamp(::av_rescale_q(av.pts - start, stream_->time_base, AV_TIME_BASE_Q));
+  }
+
+  frame_.clear();
+  return p;
+}
+
+void ffmpeg_demux::pause() {
+}
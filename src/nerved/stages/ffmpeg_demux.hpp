@@ -0,0 +1,61 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_FFMPEG_DEMUX_HPP_wy5o0c2h
+#define STAGES_FFMPEG_DEMUX_HPP_wy5o0c2h
+
+#include "interfaces.hpp"
+
+#include "ffmpeg/file.hpp"
+#include "ffmpeg/frame.hpp"
+
+#include <string>
+
+namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * The file reading half of ffmpeg_input.  Packets are compressed frames of
+   * the audio stream, which only an ffmpeg_decode stage can do anything with.
+   * Each file starts with a codec header packet which opens the decoder.
+   *
+   * The point is to put the I/O on a different job to the decoding.  A cued
+   * track is opened when the current one ends, which is cheap enough here
+   * because nothing is decoded and the job is there to wait on I/O.
+   */
+  class ffmpeg_demux : public pipeline::input_stage {
+    public:
+    typedef pipeline::input_stage::skip_type skip_type;
+    typedef pipeline::input_stage::load_type load_type;
+
+    ffmpeg_demux() : stream_(NULL), header_pending_(false), finish_pending_(false) {}
+
+    void abandon();
+    void flush();
+    void finish();
+    void configure(const char *k, const char *v);
+    void skip(skip_type);
+    void load(load_type);
+    void cue(load_type);
+    void pause();
+    pipeline::packet *read(pipeline::packet *);
+    bool idle() const { return ! file_.is_open() && ! finish_pending_; }
+
+    private:
+    void unload();
+    //! Load the cued track.  False if there isn't one which can be read.
+    bool next_track();
+
+    ::ffmpeg::file file_;
+    //! The audio stream in file_.
+    AVStream *stream_;
+    ::ffmpeg::frame frame_;
+    //! The next read gives the codec header.
+    bool header_pending_;
+    //! The next read gives a finish because the track was skipped.
+    bool finish_pending_;
+    //! Path of the cued track, or empty.
+    std::string next_;
+  };
+}
+
+#endif
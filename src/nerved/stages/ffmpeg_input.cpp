@@ -2,9 +2,15 @@
 // Distributed under a 3-clause BSD license.  See COPYING.
 #include "ffmpeg_input.hpp"
 
+#include "../pipeline/packet.hpp"
+#include "../output/logging.hpp"
 #include "../util/asserts.hpp"
 
+#include <boost/bind.hpp>
+
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 
 namespace ff = ::ffmpeg;
 using stages::ffmpeg_input;
@@ -23,47 +29,200 @@ void ffmpeg_input::finish() {
 }
 
 void ffmpeg_input::configure(const char *k, const char *v) {
+  NERVE_ASSERT_PTR(k);
+  NERVE_ASSERT_PTR(v);
+
   // TODO:
-  //   This is another one which needs errors reported.
+  //   This is another one which needs errors reported properly, i.e failing
+  //   the configuration.
+  output::logger log(output::source::config);
+
+  if (std::strcmp(k, "read_ahead") == 0) {
+    char *end;
+    const long n = std::strtol(v, &end, 10);
+    if (*v == '\0' || *end != '\0' || n < 1) {
+      log.error("ffmpeg: read_ahead must be a positive number of frames, not '%s'\n", v);
+      return;
+    }
+    reader_.depth((std::size_t) n);
+  }
+  else if (std::strcmp(k, "preroll") == 0) {
+    char *end;
+    const long ms = std::strtol(v, &end, 10);
+    if (*v == '\0' || *end != '\0' || ms < 0) {
+      log.error("ffmpeg: preroll must be a number of milliseconds, not '%s'\n", v);
+      return;
+    }
+    preloader_.preroll_ms((unsigned int) ms);
+  }
+  else {
+    log.warn("ffmpeg: unknown configuration key '%s'\n", k);
+  }
 }
 
-void ffmpeg_input::skip(skip_type) {
+void ffmpeg_input::skip(skip_type loc) {
+  if (loc) {
+    output::logger log(output::source::pipeline);
+    log.warn("ffmpeg: can only skip to the end of the track\n");
+    return;
+  }
+
+  if (! reader_.running()) {
+    return;
+  }
+
+  // The same as reaching the end, except the finish waits for the next read.
+  this->unload();
+  finish_pending_ = ! this->next_track();
 }
 
 void ffmpeg_input::load(load_type loc) {
+  // Whatever was cued was meant to follow the old track.
+  preloader_.cancel();
+
   ff::file new_file;
   if (! new_file.open(loc)) {
     // TODO:
     //   how is an error reported?  We need to generate a new load event
-    //   somehow.  Also a proper useful error string would be very good.
+    //   somehow.
     return;
   }
 
   ff::audio_stream new_stream;
 
   if (! new_stream.open(new_file)) {
-    // report error
     return;
   }
 
-  // So we don't have to worry about memory so much.
+  const pipeline::audio_format new_format = new_stream.format();
+  if (new_format.sample_format() == pipeline::sample_format::none || ! new_format.rate() || ! new_format.channels()) {
+    output::logger log(output::source::pipeline);
+    log.error("%s: the decoder's output format isn't supported\n", loc);
+    return;
+  }
+
+  this->unload();
+  finish_pending_ = false;
+
+  // So we don't have to worry about memory so much.  The old ones are closed
+  // when the new_ variables go.
   file_.swap(new_file);
   stream_.swap(new_stream);
+  format_ = generations_.stamp(new_format);
+  next_timestamp_ = 0;
+
+  reader_.start(file_, stream_.index());
+}
+
+void ffmpeg_input::cue(load_type loc) {
+  preloader_.cue(loc, pool_);
 }
 
-pipeline::packet *ffmpeg_input::read() {
-  ff::read_frame(frame_, file_);
-  ff::audio_source source(frame_, stream_);
-  ff::decode_audio(buffer_, source);
+void ffmpeg_input::unload() {
+  if (current_) {
+    reader_.recycle(current_);
+    current_ = NULL;
+  }
+  reader_.stop();
+  std::for_each(preroll_.begin(), preroll_.end(), boost::bind(&pipeline::packet::release, _1));
+  preroll_.clear();
+}
 
-  // TODO:
-  //   Set up the pipeline::packet.  Note: we want the option to later separate
-  //   out he decoder and the file reader, so I'll need the ability to put
-  //   whatever special stuff necessary on to actual resultant packet.
+bool ffmpeg_input::next_track() {
+  if (! preloader_.cued()) {
+    return false;
+  }
+
+  this->unload();
+  if (! preloader_.take(file_, stream_, preroll_)) {
+    return false;
+  }
+
+  format_ = generations_.stamp(stream_.format());
+  next_timestamp_ = 0;
+  reader_.start(file_, stream_.index());
+  return true;
+}
 
+pipeline::packet *ffmpeg_input::read_preroll(pipeline::packet *fresh) {
+  pipeline::packet *const p = NERVE_CHECK_PTR(preroll_.front());
+  preroll_.pop_front();
+  fresh->release();
+
+  pipeline::payload &pl = p->payload();
+  pl.format(format_);
+  pl.timestamp(next_timestamp_);
+  next_timestamp_ += (pipeline::payload::timestamp_type) pl.frames() * AV_TIME_BASE / format_.rate();
+  return p;
+}
+
+pipeline::packet *ffmpeg_input::read(pipeline::packet *p) {
+  NERVE_CHECK_PTR(p);
+  pipeline::payload &pl = p->payload();
+  pl.clear();
+  pool_ = p->pool();
+
+  if (finish_pending_) {
+    finish_pending_ = false;
+    p->event(pipeline::packet::event::finish);
+    return p;
+  }
+
+  // Not asked while we're idle, but an empty packet does no harm.
+  if (! reader_.running()) {
+    return p;
+  }
+
+  if (! preroll_.empty()) {
+    return this->read_preroll(p);
+  }
 
-  NERVE_NIMPL("returning data from a whatsit");
-  return NULL;
+  // Decode straight into the packet.
+  buffer_.reset(p->storage(), pipeline::packet::storage_size);
+
+  do {
+    if (! current_) {
+      current_ = reader_.next();
+      if (current_->end()) {
+        this->unload();
+        if (! this->next_track()) {
+          p->event(pipeline::packet::event::finish);
+          return p;
+        }
+        else if (! preroll_.empty()) {
+          return this->read_preroll(p);
+        }
+        continue;
+      }
+
+      // Timestamps are only known at the start of a frame, if at all.
+      // Otherwise we carry on counting from the samples.
+      const int64_t pts = current_->presentation_timestamp();
+      if (pts != AV_NOPTS_VALUE) {
+        const AVStream &s = stream_.av_stream();
+        const int64_t start = s.start_time == AV_NOPTS_VALUE ? 0 : s.start_time;
+        next_timestamp_ = ::av_rescale_q(pts - start, stream_.time_base_q(), AV_TIME_BASE_Q);
+      }
+    }
+
+    ff::audio_source source(*current_, stream_);
+    if (! ff::decode_audio(buffer_, source)) {
+      output::logger log(output::source::pipeline);
+      log.warn("%s: dropped a frame which couldn't be decoded\n", file_.file_name());
+    }
+
+    if (current_->consumed()) {
+      reader_.recycle(current_);
+      current_ = NULL;
+    }
+  } while (buffer_.size() == 0);
+
+  pl.data(buffer_.data(), buffer_.size());
+  pl.format(format_);
+  pl.timestamp(next_timestamp_);
+
+  next_timestamp_ += (pipeline::payload::timestamp_type) pl.frames() * AV_TIME_BASE / format_.rate();
+  return p;
 }
 
 void ffmpeg_input::pause() {
@@ -9,27 +9,77 @@
 #include "ffmpeg/audio_stream.hpp"
 #include "ffmpeg/decode_audio.hpp"
 #include "ffmpeg/frame.hpp"
+#include "ffmpeg/preloader.hpp"
+#include "ffmpeg/read_ahead.hpp"
+
+#include "../pipeline/payload.hpp"
 
 namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Decodes a file with ffmpeg straight into the pipeline's packets.  The file
+   * is demuxed on a read-ahead thread (see ffmpeg::read_ahead) so the decoder
+   * is only held up when the storage is slower than playback for longer than
+   * the queue lasts.
+   *
+   * A cued track is opened and its start decoded on another thread (see
+   * ffmpeg::preloader) so that it follows the current one without a gap.
+   * The start is decoded into packets from the same pool as the ones we're
+   * given to fill, which is learnt from the first of those.
+   *
+   * Configuration:
+   * - read_ahead: number of compressed frames to queue (default 32).
+   * - preroll: milliseconds of the cued track to decode in advance (default
+   *   200).
+   */
   class ffmpeg_input : public pipeline::input_stage {
     public:
     typedef pipeline::input_stage::skip_type skip_type;
     typedef pipeline::input_stage::load_type load_type;
 
+    ffmpeg_input() : pool_(NULL), current_(NULL), next_timestamp_(0), finish_pending_(false) {}
+    ~ffmpeg_input() { this->unload(); }
+
     void abandon();
     void flush();
     void finish();
     void configure(const char *k, const char *v);
     void skip(skip_type);
     void load(load_type);
+    void cue(load_type);
     void pause();
-    pipeline::packet *read();
+    pipeline::packet *read(pipeline::packet *);
+    bool idle() const { return ! reader_.running() && ! finish_pending_; }
 
     private:
+    //! Stop reading and give back the frame we were decoding.
+    void unload();
+    //! Swap in the cued track and start reading it.  False if there isn't
+    //! one which can be played.
+    bool next_track();
+    //! Swap the next preroll packet for the fresh one.
+    pipeline::packet *read_preroll(pipeline::packet *fresh);
+
     ::ffmpeg::file file_;
     ::ffmpeg::audio_stream stream_;
-    ::ffmpeg::frame frame_;
+    ::ffmpeg::read_ahead reader_;
     ::ffmpeg::sample_buffer buffer_;
+
+    ::ffmpeg::preloader preloader_;
+    //! Decoded start of the track, from the preloader.
+    ::ffmpeg::preloader::preroll_type preroll_;
+    pipeline::packet_pool *pool_;
+
+    //! Frame being decoded, if any.
+    ::ffmpeg::frame *current_;
+    pipeline::audio_format format_;
+    //! So a track in the same format as the last keeps its generation.
+    pipeline::format_generations generations_;
+    //! Where the next packet starts in microseconds.
+    pipeline::payload::timestamp_type next_timestamp_;
+    //! The next read gives a finish because the track was skipped.
+    bool finish_pending_;
   };
 }
 
@@ -0,0 +1,280 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "file_output.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+using stages::file_output;
+
+namespace {
+  const std::size_t wav_header_size = 44;
+  const long wav_riff_size_at = 4;
+  const long wav_data_size_at = 40;
+
+  void put_le(unsigned char *to, boost::uint32_t value, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; ++i) {
+      to[i] = (unsigned char) (value >> (8 * i));
+    }
+  }
+
+  bool write_le32(std::FILE *f, long at, boost::uint32_t value) {
+    unsigned char b[4];
+    put_le(b, value, 4);
+    return std::fseek(f, at, SEEK_SET) == 0 && std::fwrite(b, 1, 4, f) == 4;
+  }
+
+  //! Sizes are left at zero to be filled in later.
+  void make_wav_header(unsigned char *h, const pipeline::audio_format &fmt) {
+    const bool floating = fmt.sample_format() == pipeline::sample_format::flt ||
+      fmt.sample_format() == pipeline::sample_format::dbl;
+    const boost::uint32_t block = (boost::uint32_t) fmt.frame_bytes();
+
+    std::memset(h, 0, wav_header_size);
+    std::memcpy(h, "RIFF", 4);
+    std::memcpy(h + 8, "WAVEfmt ", 8);
+    put_le(h + 16, 16, 4);
+    // PCM or IEEE float.
+    put_le(h + 20, floating ? 3 : 1, 2);
+    put_le(h + 22, fmt.channels(), 2);
+    put_le(h + 24, fmt.rate(), 4);
+    put_le(h + 28, fmt.rate() * block, 4);
+    put_le(h + 32, block, 2);
+    put_le(h + 34, (boost::uint32_t) pipeline::sample_format::bytes(fmt.sample_format()) * 8, 2);
+    std::memcpy(h + 36, "data", 4);
+  }
+
+  bool ends_with(const std::string &s, const char *suffix) {
+    const std::size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+  }
+}
+
+file_output::file_output()
+: file_format_(file_format::unset), file_(NULL), data_bytes_(0),
+  accepting_(false), dropped_(false), failed_(false), timing_(false), frames_(0), audio_us_(0)
+{}
+
+file_output::~file_output() {
+  this->close();
+}
+
+void file_output::abandon() {
+  // Everything has already been written.
+}
+
+void file_output::flush() {
+  this->update();
+}
+
+void file_output::finish() {
+  this->update();
+  this->report();
+}
+
+void file_output::configure(const char *k, const char *v) {
+  NERVE_ASSERT_PTR(k);
+  NERVE_ASSERT_PTR(v);
+
+  output::logger log(output::source::config);
+
+  if (std::strcmp(k, "path") == 0) {
+    path_ = v;
+  }
+  else if (std::strcmp(k, "format") == 0) {
+    if (std::strcmp(v, "raw") == 0) {
+      file_format_ = file_format::raw;
+    }
+    else if (std::strcmp(v, "wav") == 0) {
+      file_format_ = file_format::wav;
+    }
+    else if (std::strcmp(v, "null") == 0) {
+      file_format_ = file_format::null;
+    }
+    else {
+      log.error("file_output: format must be raw, wav or null, not '%s'\n", v);
+    }
+  }
+  else {
+    log.warn("file_output: unknown configuration key '%s'\n", k);
+  }
+}
+
+void file_output::output(pipeline::packet *p, ::pipeline::outputter *) {
+  NERVE_CHECK_PTR(p);
+  const pipeline::payload &pl = p->payload();
+  if (pl.content() != pipeline::payload_content::samples || pl.empty()) {
+    return;
+  }
+
+  if (! accepting_) {
+    return;
+  }
+
+  if (! timing_) {
+    timing_ = true;
+    started_ = boost::posix_time::microsec_clock::universal_time();
+  }
+
+  const std::size_t frames = pl.frames();
+  frames_ += frames;
+  if (format_.rate()) {
+    audio_us_ += (boost::uint64_t) frames * 1000000 / format_.rate();
+  }
+
+  if (! file_) {
+    return;
+  }
+
+  if (std::fwrite(pl.data(), 1, pl.size(), file_) != pl.size()) {
+    output::logger log(output::source::pipeline);
+    log.error("file_output: error writing %s: %s\n", path_.c_str(), std::strerror(errno));
+    failed_ = true;
+    this->close();
+    return;
+  }
+
+  data_bytes_ += pl.size();
+}
+
+void file_output::reconfigure(pipeline::packet *p) {
+  NERVE_CHECK_PTR(p);
+  const pipeline::audio_format &fmt = p->payload().format();
+
+  if (file_ && file_format_ == file_format::wav) {
+    accepting_ = fmt == format_;
+    if (! accepting_ && ! dropped_) {
+      output::logger log(output::source::pipeline);
+      log.error("file_output: %s is a WAV of %u channels at %u Hz; dropping samples in any other format\n", path_.c_str(), format_.channels(), format_.rate());
+      dropped_ = true;
+    }
+    return;
+  }
+
+  format_ = fmt;
+  accepting_ = true;
+  if (! file_ && ! failed_) {
+    this->open(fmt);
+  }
+}
+
+bool file_output::open(const pipeline::audio_format &fmt) {
+  NERVE_ASSERT(file_ == NULL, "must close before opening again");
+
+  if (file_format_ == file_format::unset) {
+    if (path_.empty()) {
+      file_format_ = file_format::null;
+    }
+    else {
+      file_format_ = ends_with(path_, ".wav") ? file_format::wav : file_format::raw;
+    }
+  }
+
+  if (file_format_ == file_format::null) {
+    return true;
+  }
+
+  output::logger log(output::source::pipeline);
+
+  if (path_.empty()) {
+    log.error("file_output: a path is needed to write a file\n");
+    failed_ = true;
+    return false;
+  }
+
+  if (file_format_ == file_format::wav && fmt.frame_bytes() == 0) {
+    log.error("file_output: can't write a WAV of samples with an unknown format\n");
+    failed_ = true;
+    return false;
+  }
+
+  file_ = std::fopen(path_.c_str(), "wb");
+  if (! file_) {
+    log.error("file_output: couldn't open %s: %s\n", path_.c_str(), std::strerror(errno));
+    failed_ = true;
+    return false;
+  }
+
+  data_bytes_ = 0;
+  dropped_ = false;
+
+  if (file_format_ == file_format::wav) {
+    unsigned char header[wav_header_size];
+    make_wav_header(header, fmt);
+    if (std::fwrite(header, 1, wav_header_size, file_) != wav_header_size) {
+      log.error("file_output: error writing %s: %s\n", path_.c_str(), std::strerror(errno));
+      failed_ = true;
+      this->close();
+      return false;
+    }
+  }
+
+  log.trace("file_output: writing to %s\n", path_.c_str());
+  return true;
+}
+
+void file_output::close() {
+  if (! file_) {
+    return;
+  }
+
+  this->update();
+  std::fclose(file_);
+  file_ = NULL;
+}
+
+void file_output::update() {
+  if (! file_) {
+    return;
+  }
+
+  if (file_format_ == file_format::wav) {
+    // A WAV can't be any bigger so the sizes are wrong but at least it plays.
+    const boost::uint64_t max = 0xffffffffu - (wav_header_size - 8);
+    const boost::uint32_t data = (boost::uint32_t) (data_bytes_ < max ? data_bytes_ : max);
+
+    const bool ok =
+      write_le32(file_, wav_riff_size_at, data + (wav_header_size - 8)) &&
+      write_le32(file_, wav_data_size_at, data) &&
+      std::fseek(file_, 0, SEEK_END) == 0;
+
+    if (! ok) {
+      output::logger log(output::source::pipeline);
+      log.error("file_output: couldn't update the header of %s: %s\n", path_.c_str(), std::strerror(errno));
+    }
+  }
+
+  std::fflush(file_);
+}
+
+void file_output::report() {
+  if (! timing_) {
+    return;
+  }
+
+  const boost::posix_time::time_duration elapsed =
+    boost::posix_time::microsec_clock::universal_time() - started_;
+  const double wall = elapsed.total_microseconds() / 1e6;
+  const double audio = audio_us_ / 1e6;
+
+  output::logger log(output::source::pipeline);
+  if (wall > 0) {
+    log.info(
+      "file_output: %.0f frames (%.3fs of audio) in %.3fs: %.0f frames/s, %.1fx realtime\n",
+      (double) frames_, audio, wall, frames_ / wall, audio / wall
+    );
+  }
+  else {
+    log.info("file_output: %.0f frames (%.3fs of audio)\n", (double) frames_, audio);
+  }
+
+  timing_ = false;
+  frames_ = 0;
+  audio_us_ = 0;
+}
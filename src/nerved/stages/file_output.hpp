@@ -0,0 +1,84 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_FILE_OUTPUT_HPP_q8d2mx5e
+#define STAGES_FILE_OUTPUT_HPP_q8d2mx5e
+
+#include "interfaces.hpp"
+
+#include "../pipeline/payload.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <cstdio>
+#include <string>
+
+namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Writes samples to a file, or throws them away, as fast as they come.
+   * There's no pacing at all so this measures how fast everything before it
+   * in the pipeline goes; the rate is logged on every finish.  Without a
+   * sound card it's also the only way to hear anything.
+   *
+   * A WAV file takes the format of the first packet.  Anything in a different
+   * format is dropped because WAV can't change format.  The header's sizes
+   * are filled in on every finish and flush, so the file is valid whenever
+   * the pipeline isn't running.  Raw files write whatever comes.
+   *
+   * Configuration:
+   * - path: file to write to.  Without it everything is discarded.
+   * - format: raw, wav or null.  The default is wav when the path ends in
+   *   .wav, null when there is no path and raw otherwise.
+   */
+  class file_output : public pipeline::output_stage {
+    public:
+    file_output();
+    ~file_output();
+
+    void abandon();
+    void flush();
+    void finish();
+    void configure(const char *k, const char *v);
+    void output(pipeline::packet *, ::pipeline::outputter *);
+    void reconfigure(pipeline::packet *);
+
+    private:
+    struct file_format {
+      enum id { unset, raw, wav, null };
+    };
+
+    //! Open the file if it's not already and write the header.
+    bool open(const pipeline::audio_format &);
+    void close();
+    //! Fill in the WAV header's sizes and flush stdio.
+    void update();
+    //! Log the throughput since the last report.
+    void report();
+
+    std::string path_;
+    file_format::id file_format_;
+
+    std::FILE *file_;
+    //! Of the file, and of the packets for a raw file.
+    pipeline::audio_format format_;
+    //! Bytes of samples written, which excludes the header.
+    boost::uint64_t data_bytes_;
+    //! Packets are in a format the file can take.
+    bool accepting_;
+    //! Only complain once about each of these.
+    bool dropped_;
+    bool failed_;
+
+    //! \name Throughput
+    //@{
+    boost::posix_time::ptime started_;
+    bool timing_;
+    boost::uint64_t frames_;
+    boost::uint64_t audio_us_;
+    //@}
+  };
+}
+
+#endif
@@ -38,6 +38,21 @@ plugin_id_type stages::get_built_in_plugin_id(const char *name) {
   else if (std::strcmp(name, "volume") == 0) {
     return plug_id::volume;
   }
+  else if (std::strcmp(name, "ffmpeg_demux") == 0) {
+    return plug_id::ffmpeg_demux;
+  }
+  else if (std::strcmp(name, "ffmpeg_decode") == 0) {
+    return plug_id::ffmpeg_decode;
+  }
+  else if (std::strcmp(name, "file_output") == 0) {
+    return plug_id::file_output;
+  }
+  else if (std::strcmp(name, "degapifier") == 0) {
+    return plug_id::degapifier;
+  }
+  else if (std::strcmp(name, "convert") == 0) {
+    return plug_id::convert;
+  }
   else {
     return plug_id::unset;
   }
@@ -51,6 +66,16 @@ const char *stages::get_plugin_enum_name(stages::plugin_id_type p) {
     return "ffmpeg";
   case plug_id::volume:
     return "volume";
+  case plug_id::ffmpeg_demux:
+    return "ffmpeg_demux";
+  case plug_id::ffmpeg_decode:
+    return "ffmpeg_decode";
+  case plug_id::file_output:
+    return "file_output";
+  case plug_id::degapifier:
+    return "degapifier";
+  case plug_id::convert:
+    return "convert";
   case plug_id::unset:
     return "(unset)";
   case plug_id::plugin:
@@ -66,10 +91,15 @@ category_type stages::get_built_in_plugin_category(plugin_id_type p) {
   case plug_id::plugin:
     return stage_cat::unset;
   case plug_id::sdl:
+  case plug_id::file_output:
     return stage_cat::output;
   case plug_id::ffmpeg:
+  case plug_id::ffmpeg_demux:
     return stage_cat::input;
   case plug_id::volume:
+  case plug_id::ffmpeg_decode:
+  case plug_id::degapifier:
+  case plug_id::convert:
     return stage_cat::process;
   }
 
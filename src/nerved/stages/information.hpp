@@ -24,7 +24,12 @@ namespace stages {
       ffmpeg,
       //! Meaning not built in.
       plugin,
-      volume
+      volume,
+      ffmpeg_demux,
+      ffmpeg_decode,
+      file_output,
+      degapifier,
+      convert
     };
   }
 
@@ -1,35 +1,401 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
 #include "sdl.hpp"
 
+#include "dsp/convert.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
 using stages::sdl;
 
+namespace {
+  inline boost::int16_t to_s16(boost::int16_t v) { return v; }
+  inline boost::int16_t to_s16(boost::int32_t v) { return (boost::int16_t) (v >> 16); }
+
+  template<class F>
+  inline boost::int16_t float_to_s16(F v) {
+    if (v >= (F) 1) {
+      return 32767;
+    }
+    else if (v <= (F) -1) {
+      return -32767;
+    }
+    return (boost::int16_t) (v * (F) 32767 + (v >= 0 ? (F) 0.5 : (F) -0.5));
+  }
+
+  inline boost::int16_t to_s16(float v) { return float_to_s16(v); }
+  inline boost::int16_t to_s16(double v) { return float_to_s16(v); }
+}
+
+const std::size_t sdl::convert_samples;
+
+sdl::sdl()
+: open_(false), playing_(false), paused_(false), resampling_(false), buffer_ms_(250), samples_(1024),
+  reopen_on_rate_(false), prefill_(0), refill_(0), period_ms_(0), silence_(0), cut_(0), underruns_(0),
+  wants_space_(false), low_water_(0), space_(SDL_CreateSemaphore(0))
+{
+  if (! space_) {
+    NERVE_ABORT("sdl: couldn't create a semaphore");
+  }
+}
+
+sdl::~sdl() {
+  this->close();
+  SDL_DestroySemaphore(space_);
+}
+
 void sdl::abandon() {
+  if (! open_) {
+    return;
+  }
+
+  if (resampling_) {
+    resampler_.reset();
+  }
+
+  // The callback can't have been called yet so we can do it ourselves.
+  if (! playing_) {
+    ring_.skip_to(ring_.write_index());
+  }
+  else {
+    cut_.store(ring_.write_index(), boost::memory_order_release);
+  }
 }
 
 void sdl::flush() {
+  this->drain();
 }
 
 void sdl::finish() {
+  // The end of the stream is still in the resampler's filter.
+  if (open_ && resampling_) {
+    resample_out_.resize(resampler_.max_output(resampler_.delay()) * format_.channels());
+    const std::size_t frames = resampler_.flush(&resample_out_[0]);
+    this->write_floats(&resample_out_[0], frames * format_.channels());
+  }
+  this->drain();
 }
 
 void sdl::configure(const char *k, const char *v) {
+  NERVE_ASSERT_PTR(k);
+  NERVE_ASSERT_PTR(v);
+
+  output::logger log(output::source::config);
+
+  char *end;
+  const long n = std::strtol(v, &end, 10);
+  const bool positive = *v != '\0' && *end == '\0' && n > 0;
+
+  if (std::strcmp(k, "rate_change") == 0) {
+    if (std::strcmp(v, "resample") == 0) {
+      reopen_on_rate_ = false;
+    }
+    else if (std::strcmp(v, "reopen") == 0) {
+      reopen_on_rate_ = true;
+    }
+    else {
+      log.error("sdl: rate_change must be resample or reopen, not '%s'\n", v);
+    }
+  }
+  else if (std::strcmp(k, "buffer_ms") == 0) {
+    if (! positive) {
+      log.error("sdl: buffer_ms must be a positive number of milliseconds, not '%s'\n", v);
+      return;
+    }
+    buffer_ms_ = (unsigned int) n;
+  }
+  else if (std::strcmp(k, "samples") == 0) {
+    if (! positive || n > 65535) {
+      log.error("sdl: samples must be a number of frames up to 65535, not '%s'\n", v);
+      return;
+    }
+    samples_ = (unsigned int) n;
+  }
+  else {
+    log.warn("sdl: unknown configuration key '%s'\n", k);
+  }
+}
+
+void sdl::output(pipeline::packet *p, ::pipeline::outputter *) {
+  NERVE_CHECK_PTR(p);
+  const pipeline::payload &pl = p->payload();
+  if (pl.content() != pipeline::payload_content::samples || pl.empty()) {
+    return;
+  }
+
+  if (! open_) {
+    return;
+  }
+
+  if (resampling_) {
+    this->write_resampled(pl);
+    return;
+  }
+
+  const std::size_t count = pl.frames() * format_.channels();
+  switch (format_.sample_format()) {
+  case pipeline::sample_format::s16:
+    this->write(pl.data(), count * sizeof(boost::int16_t));
+    break;
+  case pipeline::sample_format::s32:
+    this->write_converted((const boost::int32_t *) pl.data(), count);
+    break;
+  case pipeline::sample_format::flt:
+    this->write_converted((const float *) pl.data(), count);
+    break;
+  case pipeline::sample_format::dbl:
+    this->write_converted((const double *) pl.data(), count);
+    break;
+  case pipeline::sample_format::none:
+    NERVE_ABORT("can't open for a format of none");
+  }
 }
 
-void sdl::output(pipeline::packet *, ::pipeline::outputter *) {
+void sdl::reconfigure(pipeline::packet *p) {
+  NERVE_CHECK_PTR(p);
+  const pipeline::audio_format &fmt = p->payload().format();
+
+  const bool same_rate = fmt.rate() == device_.rate();
+  if (open_ && fmt.channels() == device_.channels() && (same_rate || ! reopen_on_rate_) &&
+      fmt.sample_format() != pipeline::sample_format::none && fmt.rate()) {
+    format_ = fmt;
+    resampling_ = ! same_rate;
+    if (resampling_) {
+      resampler_.setup(fmt.rate(), device_.rate(), fmt.channels(), dsp::resampler::quality::medium);
+
+      output::logger log(output::source::pipeline);
+      log.trace("sdl: resampling %u Hz to the device's %u Hz\n", fmt.rate(), device_.rate());
+    }
+    return;
+  }
+
+  // The end of the last format still gets played, unless we're paused.
+  this->drain();
+  this->close();
+  if (! this->open(fmt)) {
+    // Try again with the next packet instead of dropping everything until
+    // the format changes.
+    this->forget_format();
+  }
 }
 
-void sdl::reconfigure(pipeline::packet *) {
+bool sdl::open(const pipeline::audio_format &format) {
+  NERVE_ASSERT(! open_, "must close before opening again");
+
+  output::logger log(output::source::pipeline);
+
+  if (format.sample_format() == pipeline::sample_format::none || ! format.rate() || ! format.channels()) {
+    log.error("sdl: can't play samples of an unknown format\n");
+    return false;
+  }
+
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+    log.error("sdl: couldn't initialise audio: %s\n", SDL_GetError());
+    return false;
+  }
+
+  // The callback isn't running so this is safe.
+  const std::size_t frame_bytes = sizeof(boost::int16_t) * format.channels();
+  ring_.reserve((std::size_t) format.rate() * buffer_ms_ / 1000 * frame_bytes);
+  cut_.store(ring_.write_index());
+  prefill_ = ring_.capacity() / 2;
+  refill_ = std::max(ring_.capacity() / 4, (std::size_t) 1);
+  period_ms_ = (Uint32) (((boost::uint64_t) samples_ * 1000 + format.rate() - 1) / format.rate());
+
+  SDL_AudioSpec desired;
+  std::memset(&desired, 0, sizeof(desired));
+  desired.freq = format.rate();
+  desired.format = AUDIO_S16SYS;
+  desired.channels = (Uint8) format.channels();
+  desired.samples = (Uint16) samples_;
+  desired.callback = &sdl::callback;
+  desired.userdata = this;
+
+  // No obtained spec means SDL converts to whatever the hardware wants.
+  if (SDL_OpenAudio(&desired, NULL) < 0) {
+    log.error("sdl: couldn't open audio: %s\n", SDL_GetError());
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    return false;
+  }
+
+  silence_ = desired.silence;
+  format_ = format;
+  device_ = format;
+  resampling_ = false;
+  open_ = true;
+  return true;
 }
 
-#if 0
-    sdl::audio aud;
-    sdl::device dev(aud);
-    {
-      sdl::audio_spec::callback_type cb = sdl_callback;
-      sdl::audio_spec desired(cb);
-      // std::cout << "Opening audio:" << std::endl;
-      // desired.dump_spec(std::cout, "  ") << std::endl;
-      dev.reopen(desired);
-      std::cout << "SDL Got:" << std::endl;
-      dev.obtained().dump_spec(std::cout, "  ") << std::endl;
+void sdl::close() {
+  if (! open_) {
+    return;
+  }
+
+  // Waits for the callback to finish.
+  SDL_CloseAudio();
+  SDL_QuitSubSystem(SDL_INIT_AUDIO);
+  open_ = false;
+  {
+    lock_type lk(pause_mutex_);
+    playing_ = false;
+  }
+
+  const unsigned long underruns = underruns_.exchange(0);
+  if (underruns) {
+    output::logger log(output::source::pipeline);
+    log.warn("sdl: the audio callback ran out of data %lu times\n", underruns);
+  }
+}
+
+void sdl::start() {
+  if (playing_) {
+    return;
+  }
+
+  lock_type lk(pause_mutex_);
+  playing_ = true;
+  if (! paused_) {
+    SDL_PauseAudio(0);
+  }
+}
+
+void sdl::pause(bool paused) {
+  lock_type lk(pause_mutex_);
+  paused_ = paused;
+  // Otherwise it's done when the ring is full enough.
+  if (playing_) {
+    SDL_PauseAudio(paused ? 1 : 0);
+  }
+}
+
+template<class T>
+void sdl::write_converted(const T *samples, std::size_t count) {
+  while (count) {
+    const std::size_t n = count < convert_samples ? count : convert_samples;
+    for (std::size_t i = 0; i < n; ++i) {
+      convert_[i] = to_s16(samples[i]);
+    }
+    this->write(convert_, n * sizeof(boost::int16_t));
+    samples += n;
+    count -= n;
+  }
+}
+
+void sdl::write_resampled(const pipeline::payload &pl) {
+  const unsigned int channels = format_.channels();
+  const std::size_t frames = pl.frames();
+  const std::size_t count = frames * channels;
+
+  resample_in_.resize(count);
+  switch (format_.sample_format()) {
+  case pipeline::sample_format::s16:
+    dsp::to_float((const boost::int16_t *) pl.data(), &resample_in_[0], count);
+    break;
+  case pipeline::sample_format::s32:
+    dsp::to_float((const boost::int32_t *) pl.data(), &resample_in_[0], count);
+    break;
+  case pipeline::sample_format::flt:
+    dsp::to_float((const float *) pl.data(), &resample_in_[0], count);
+    break;
+  case pipeline::sample_format::dbl:
+    dsp::to_float((const double *) pl.data(), &resample_in_[0], count);
+    break;
+  case pipeline::sample_format::none:
+    NERVE_ABORT("can't resample a format of none");
+  }
+
+  resample_out_.resize(resampler_.max_output(frames) * channels);
+  const std::size_t written = resampler_.process(&resample_in_[0], frames, &resample_out_[0]) * channels;
+  this->write_floats(&resample_out_[0], written);
+}
+
+void sdl::write_floats(const float *samples, std::size_t count) {
+  for (std::size_t done = 0; done < count; done += convert_samples) {
+    const std::size_t n = std::min(convert_samples, count - done);
+    dsp::from_float(&samples[done], convert_, n);
+    this->write(convert_, n * sizeof(boost::int16_t));
+  }
+}
+
+void sdl::write(const void *data, std::size_t bytes) {
+  const unsigned char *p = (const unsigned char *) data;
+  for (;;) {
+    const std::size_t n = ring_.write(p, bytes);
+    p += n;
+    bytes -= n;
+
+    if (! playing_ && ring_.readable() >= prefill_) {
+      this->start();
     }
-#endif
+
+    if (bytes == 0) {
+      return;
+    }
+
+    this->start();
+    this->wait_for_space(std::min(bytes, refill_));
+  }
+}
+
+void sdl::drain() {
+  if (! open_) {
+    return;
+  }
+
+  if (this->drained()) {
+    return;
+  }
+
+  this->start();
+  while (! this->drained()) {
+    // The callback isn't running so this would never finish.
+    if (this->paused()) {
+      return;
+    }
+    this->wait_for_space(ring_.capacity());
+  }
+}
+
+bool sdl::paused() {
+  lock_type lk(pause_mutex_);
+  return paused_;
+}
+
+void sdl::wait_for_space(std::size_t bytes) {
+  NERVE_ASSERT(bytes > 0 && bytes <= ring_.capacity(), "can't wait for more space than the ring has");
+  low_water_.store(ring_.capacity() - bytes, boost::memory_order_relaxed);
+  wants_space_.store(true, boost::memory_order_seq_cst);
+
+  if (ring_.writable() < bytes) {
+    SDL_SemWaitTimeout(space_, period_ms_);
+  }
+
+  // A post which we didn't wait for only makes the next wait return early.
+  wants_space_.store(false, boost::memory_order_relaxed);
+}
+
+void sdl::callback(void *user, Uint8 *stream, int length) {
+  sdl &self = *static_cast<sdl*>(user);
+
+  self.ring_.skip_to(self.cut_.load(boost::memory_order_acquire));
+
+  const std::size_t n = self.ring_.read(stream, (std::size_t) length);
+  if (n < (std::size_t) length) {
+    std::memset(stream + n, self.silence_, length - n);
+    self.underruns_.fetch_add(1, boost::memory_order_relaxed);
+  }
+
+  // Even when nothing was read; a cut makes space too.  Only the exchange
+  // which clears the flag posts, so there's one post per wait.
+  if (self.wants_space_.load(boost::memory_order_seq_cst) &&
+      self.ring_.readable() <= self.low_water_.load(boost::memory_order_relaxed) &&
+      self.wants_space_.exchange(false, boost::memory_order_acq_rel)) {
+    SDL_SemPost(self.space_);
+  }
+}
@@ -5,15 +5,143 @@
 
 #include "interfaces.hpp"
 
+#include "dsp/resample.hpp"
+
+#include "../para/rings.hpp"
+#include "../pipeline/controls.hpp"
+#include "../pipeline/payload.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <SDL.h>
+
+#include <vector>
+
 namespace stages {
-  class sdl : public pipeline::output_stage {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Plays through SDL's audio device.  Packets are copied into a wait-free
+   * byte ring which the audio callback reads from, so the callback never
+   * allocates, frees or locks.  When the ring is full the pipeline thread
+   * waits on a semaphore until the callback has read enough to make a
+   * quarter of the ring free, which is what paces the pipeline.  The
+   * callback only posts when the pipeline thread has said it's waiting, and
+   * the wait times out after a callback's period in case a post is missed.
+   *
+   * SDL only plays 16 bit samples so anything else is converted on the way
+   * into the ring.  There is only one SDL audio device so there can only be
+   * one of these running.
+   *
+   * Pausing (from any thread) pauses the device.  The pipeline carries on
+   * until the ring is full and then waits.  A drain while paused doesn't
+   * wait, so what's in the ring is played after the unpause or, when the
+   * device is reopened, thrown away.
+   *
+   * Reopening the device leaves a gap, so it's only done when the number of
+   * channels changes.  A change of sample format is handled by the
+   * conversion anyway, and a change of rate is resampled to the rate the
+   * device is already open at.
+   *
+   * Configuration:
+   * - buffer_ms: length of the ring (default 250).
+   * - samples: frames per callback (default 1024).
+   * - rate_change: resample (the default) or reopen, which plays every rate
+   *   natively at the cost of a gap when it changes.
+   */
+  class sdl : public pipeline::output_stage, public pipeline::pause_control {
     public:
+    sdl();
+    ~sdl();
+
     void abandon();
     void flush();
     void finish();
     void configure(const char *k, const char *v);
     void output(pipeline::packet *, ::pipeline::outputter *);
     void reconfigure(pipeline::packet *);
+
+    //! Thread-safe.
+    void pause(bool paused);
+
+    private:
+    typedef boost::mutex mutex_type;
+    typedef mutex_type::scoped_lock lock_type;
+
+    //! Runs on SDL's audio thread.
+    static void callback(void *self, Uint8 *stream, int length);
+
+    bool open(const pipeline::audio_format &);
+    void close();
+    void start();
+
+    //! Convert to 16 bit and write, waiting for space as necessary.
+    template<class T>
+    void write_converted(const T *samples, std::size_t count);
+    //! The same, but through the resampler.
+    void write_resampled(const pipeline::payload &);
+    //! Write what the resampler made.
+    void write_floats(const float *samples, std::size_t count);
+    void write(const void *data, std::size_t bytes);
+    //! Wait for the callback to play everything in the ring, unless paused.
+    void drain();
+    //! Wait until there's room for this many bytes, or for a callback's
+    //! period.  Check again afterwards.
+    void wait_for_space(std::size_t bytes);
+
+    bool drained() const { return ring_.writable() == ring_.capacity(); }
+    bool paused();
+
+    para::spsc_byte_ring ring_;
+    //! Of the packets, not the ring.
+    pipeline::audio_format format_;
+    //! What the device was opened for.
+    pipeline::audio_format device_;
+    bool open_;
+    //! The device has been started.  Only changed by the pipeline thread,
+    //! with pause_mutex_ held.
+    bool playing_;
+
+    mutex_type pause_mutex_;
+    //! Protected by pause_mutex_.
+    bool paused_;
+
+    //! Packets are at a different rate from the device.
+    bool resampling_;
+    dsp::resampler resampler_;
+    std::vector<float> resample_in_;
+    std::vector<float> resample_out_;
+
+    unsigned int buffer_ms_;
+    unsigned int samples_;
+    bool reopen_on_rate_;
+    //! Unpause once there's this much in the ring.
+    std::size_t prefill_;
+    //! A full ring is written to again once this much is free.
+    std::size_t refill_;
+    //! How long the callback's buffer lasts, rounded up.
+    Uint32 period_ms_;
+    Uint8 silence_;
+
+    //! \name Shared with the callback
+    //@{
+    //! The callback skips to here, to throw away what's been abandoned.
+    boost::atomic<std::size_t> cut_;
+    boost::atomic<unsigned long> underruns_;
+    //! Set by the pipeline thread before it waits.  Cleared by whichever
+    //! of them sees it first.
+    boost::atomic<bool> wants_space_;
+    //! Post once there's no more than this to read.
+    boost::atomic<std::size_t> low_water_;
+    //! Posted by the callback.  SDL posts with sem_post or the Windows
+    //! equivalent, neither of which locks.
+    SDL_sem *space_;
+    //@}
+
+    static const std::size_t convert_samples = 4096;
+    boost::int16_t convert_[convert_samples];
   };
 }
 
@@ -0,0 +1,167 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#include "volume.hpp"
+
+#include "dsp/gain.hpp"
+#include "dsp/simd.hpp"
+
+#include "../pipeline/packet.hpp"
+#include "../pipeline/packet_return.hpp"
+#include "../output/logging.hpp"
+#include "../util/asserts.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using stages::volume;
+using pipeline::packet;
+using pipeline::packet_return;
+
+const float volume::max_gain = 16.0f;
+
+volume::volume()
+: ramp_ms_(20), current_(1.0f), ramp_target_(1.0f), ramp_step_(0.0f), ramp_frames_left_(0) {
+  this->gain(1.0f);
+
+  output::logger log(output::source::pipeline);
+  log.trace("volume: using %s gain kernels\n", dsp::isa_name(dsp::best_isa()));
+}
+
+void volume::abandon() {
+  // Nothing continues from before so there's nothing to click against.
+  current_ = ramp_target_ = this->gain();
+  ramp_frames_left_ = 0;
+}
+
+void volume::flush() {
+}
+
+void volume::finish() {
+}
+
+void volume::configure(const char *k, const char *v) {
+  NERVE_ASSERT_PTR(k);
+  NERVE_ASSERT_PTR(v);
+
+  output::logger log(output::source::config);
+
+  char *end;
+  if (std::strcmp(k, "gain") == 0 || std::strcmp(k, "gain_db") == 0) {
+    const double value = std::strtod(v, &end);
+    if (*v == '\0' || *end != '\0') {
+      log.error("volume: %s must be a number, not '%s'\n", k, v);
+      return;
+    }
+
+    const bool db = std::strcmp(k, "gain_db") == 0;
+    if (! db && value < 0) {
+      log.error("volume: gain can't be negative\n");
+      return;
+    }
+
+    const float wanted = (float) (db ? std::pow(10.0, value / 20.0) : value);
+    this->gain(wanted);
+    if (this->gain() < wanted) {
+      log.warn("volume: gain is limited to %g\n", (double) max_gain);
+    }
+
+    // Start there rather than ramping up to it.
+    current_ = ramp_target_ = this->gain();
+  }
+  else if (std::strcmp(k, "ramp_ms") == 0) {
+    const long ms = std::strtol(v, &end, 10);
+    if (*v == '\0' || *end != '\0' || ms < 0) {
+      log.error("volume: ramp_ms must be a number of milliseconds, not '%s'\n", v);
+      return;
+    }
+    ramp_ms_ = (unsigned int) ms;
+  }
+  else {
+    log.warn("volume: unknown configuration key '%s'\n", k);
+  }
+}
+
+packet_return volume::process(packet *p) {
+  NERVE_CHECK_PTR(p);
+  pipeline::payload &pl = p->payload();
+  if (pl.content() != pipeline::payload_content::samples || pl.empty()) {
+    return packet_return(p);
+  }
+
+  const pipeline::audio_format &fmt = pl.format();
+  const float target = this->gain();
+  if (target != ramp_target_ && fmt.channels()) {
+    std::size_t frames = (std::size_t) fmt.rate() * ramp_ms_ / 1000;
+    if (frames == 0) {
+      frames = 1;
+    }
+
+    ramp_target_ = target;
+    ramp_frames_left_ = frames;
+    ramp_step_ = (target - current_) / (float) (frames * fmt.channels());
+  }
+
+  switch (fmt.sample_format()) {
+  case pipeline::sample_format::s16:
+    this->apply((boost::int16_t *) pl.data(), pl.frames(), fmt.channels());
+    break;
+  case pipeline::sample_format::s32:
+    this->apply((boost::int32_t *) pl.data(), pl.frames(), fmt.channels());
+    break;
+  case pipeline::sample_format::flt:
+    this->apply((float *) pl.data(), pl.frames(), fmt.channels());
+    break;
+  case pipeline::sample_format::dbl:
+    this->apply((double *) pl.data(), pl.frames(), fmt.channels());
+    break;
+  case pipeline::sample_format::none:
+    break;
+  }
+
+  return packet_return(p);
+}
+
+packet_return volume::debuffer() {
+  NERVE_ABORT("volume never buffers so it can't be debuffered");
+  return packet_return();
+}
+
+void volume::gain(float linear) {
+  // Also catches NaN.
+  if (! (linear > 0.0f)) {
+    linear = 0.0f;
+  }
+  else if (linear > max_gain) {
+    linear = max_gain;
+  }
+
+  boost::uint32_t bits;
+  std::memcpy(&bits, &linear, sizeof(bits));
+  target_.store(bits, boost::memory_order_relaxed);
+}
+
+float volume::gain() const {
+  const boost::uint32_t bits = target_.load(boost::memory_order_relaxed);
+  float linear;
+  std::memcpy(&linear, &bits, sizeof(linear));
+  return linear;
+}
+
+template<class T>
+void volume::apply(T *samples, std::size_t frames, unsigned int channels) {
+  std::size_t done = 0;
+
+  if (ramp_frames_left_) {
+    done = ramp_frames_left_ < frames ? ramp_frames_left_ : frames;
+    const std::size_t count = done * channels;
+    dsp::apply_gain(samples, count, current_, ramp_step_);
+
+    ramp_frames_left_ -= done;
+    current_ = ramp_frames_left_ ? current_ + (float) count * ramp_step_ : ramp_target_;
+  }
+
+  if (done < frames && current_ != 1.0f) {
+    dsp::apply_gain(samples + done * channels, (frames - done) * channels, current_, 0.0f);
+  }
+}
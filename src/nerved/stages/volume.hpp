@@ -0,0 +1,71 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+#ifndef STAGES_VOLUME_HPP_t6n1cw8j
+#define STAGES_VOLUME_HPP_t6n1cw8j
+
+#include "interfaces.hpp"
+
+#include "../pipeline/controls.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+
+namespace stages {
+  /*!
+   * \ingroup grp_stages
+   *
+   * Applies a gain to the samples in place.  Changes are ramped linearly over
+   * a few milliseconds so they don't click.  Anything which isn't samples
+   * passes through.
+   *
+   * The gain can be changed from any thread while the pipeline runs (i.e by
+   * the server's volume command); the stage picks it up at the next packet.
+   * The multiplying is done by dsp::apply_gain, which uses whatever vector
+   * unit there is.
+   *
+   * Configuration:
+   * - gain: linear multiplier (default 1).
+   * - gain_db: the same thing in decibels.
+   * - ramp_ms: how long a change takes (default 20).
+   */
+  class volume : public pipeline::process_stage, public pipeline::gain_control {
+    public:
+    //! Integer samples can't go above this.  That's +24dB.
+    static const float max_gain;
+
+    volume();
+
+    void abandon();
+    void flush();
+    void finish();
+    void configure(const char *k, const char *v);
+    pipeline::packet_return process(pipeline::packet *);
+    pipeline::packet_return debuffer();
+
+    //! Thread-safe.  Clamped to [0, max_gain].
+    void gain(float linear);
+    float gain() const;
+
+    private:
+    //! Apply current_, ramping towards ramp_target_.
+    template<class T>
+    void apply(T *samples, std::size_t frames, unsigned int channels);
+
+    //! Bits of the float so it can be atomic.
+    boost::atomic<boost::uint32_t> target_;
+
+    unsigned int ramp_ms_;
+    //! \name Pipeline thread only
+    //@{
+    float current_;
+    float ramp_target_;
+    //! Change in gain per sample (not per frame).
+    float ramp_step_;
+    std::size_t ramp_frames_left_;
+    //@}
+  };
+}
+
+#endif
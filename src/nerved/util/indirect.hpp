@@ -106,6 +106,9 @@ struct indirect_owned_polymorph :
   using parent_type::size;
   using parent_type::clear;
 
+  //! Take ownership of something which was allocated with tracked_byte_alloc.
+  using parent_type::push_back;
+
   //! Allocate a polymorphic relation of T and push it to the back of the
   //! container
   template<class U>
@@ -146,7 +149,7 @@ struct indirect_owned_monotype : protected
 
   T *alloc_back() {
     T *v = pooled::alloc<T>();
-    push_back(v);
+    this->push_back(v);
     return v;
   }
 };
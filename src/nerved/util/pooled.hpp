@@ -56,6 +56,27 @@ namespace pooled {
     return p;
   }
 
+  template<class T, class P1, class P2>
+  T *alloc2(P1 &p1, P2 &p2) {
+    T * const p = (T*) boost::singleton_pool<boost::fast_pool_allocator_tag, sizeof(T)>::malloc();
+    new (p) T(p1, p2);
+    return p;
+  }
+
+  template<class T, class P1, class P2, class P3>
+  T *alloc3(P1 &p1, P2 &p2, P3 &p3) {
+    T * const p = (T*) boost::singleton_pool<boost::fast_pool_allocator_tag, sizeof(T)>::malloc();
+    new (p) T(p1, p2, p3);
+    return p;
+  }
+
+  template<class T, class P1, class P2, class P3, class P4>
+  T *alloc4(P1 &p1, P2 &p2, P3 &p3, P4 &p4) {
+    T * const p = (T*) boost::singleton_pool<boost::fast_pool_allocator_tag, sizeof(T)>::malloc();
+    new (p) T(p1, p2, p3, p4);
+    return p;
+  }
+
   //! \ingroup grp_pooled
   //! This *does not* work polymorphically because we'd have to store the number
   //! of bytes allocated.
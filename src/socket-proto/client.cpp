@@ -9,8 +9,10 @@ enum { max_length = 1024 };
 
 int main(int argc, char* argv[]) {
   try {
-    if (argc != 2) {
-      std::cerr << "Usage: stream_client <file>\n";
+    if (argc < 3) {
+      std::cerr << "Usage: stream_client <file> <command>...\n";
+      std::cerr << "Sends each command as a line and prints what comes back until the\n";
+      std::cerr << "server closes, e.g stream_client /tmp/nerve.socket 'subscribe position 500'\n";
       return 1;
     }
 
@@ -19,23 +21,22 @@ int main(int argc, char* argv[]) {
     stream_protocol::socket s(io_service);
     s.connect(stream_protocol::endpoint(argv[1]));
 
-    char request[max_length];
-    // if (isatty(fileno(stdin)) && isatty(fileno(stdout))) {
-    //   std::cout << "Enter message: ";
-    //   std::cin.getline(request, max_length);
-    // }
-    // else {
-      std::strcpy(request, "uber pantsness\n");
-    // }
-
-    size_t request_length = std::strlen(request);
-    boost::asio::write(s, boost::asio::buffer(request, request_length));
+    for (int i = 2; i < argc; ++i) {
+      boost::asio::write(s, boost::asio::buffer(argv[i], std::strlen(argv[i])));
+      boost::asio::write(s, boost::asio::buffer("\n", 1));
+    }
 
+    // Subscriptions keep sending so this goes on until the server stops.
     char reply[max_length];
-    size_t reply_length = boost::asio::read(s, boost::asio::buffer(reply, request_length));
-    std::cout << "Reply is: ";
-    std::cout.write(reply, reply_length);
-    std::cout << "\n";
+    boost::system::error_code error;
+    for (;;) {
+      size_t reply_length = s.read_some(boost::asio::buffer(reply), error);
+      if (error) {
+        break;
+      }
+      std::cout.write(reply, reply_length);
+      std::cout.flush();
+    }
   }
   catch (std::exception& e) {
     std::cerr << "Exception: " << e.what() << "\n";
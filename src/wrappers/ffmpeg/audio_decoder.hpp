@@ -6,6 +6,7 @@
 #ifndef FFMPEG_AUDIO_DECODER_HPP_vbszml7j
 #define FFMPEG_AUDIO_DECODER_HPP_vbszml7j
 
+#include <cassert>
 #include <cstring>
 #include <cstdlib>
 #include <iostream>
@@ -30,9 +31,19 @@ class audio_decoder {
     //! Decode a frame into this object's buffer.
     void decode(ffmpeg::packet &packet) {
       // std::cout << "decode at offset " << packet.position() << std::endl;
-      buffer_size_ = 0;
-      int used_buffer_size = buffer_type::byte_size;
-      int bytes_read = decode(buffer_.ptr(), &used_buffer_size, &(packet.av_packet()));
+      buffer_size_ = decode(packet, buffer_.ptr(), buffer_type::byte_size);
+    }
+
+    //! Decode a frame straight into output and return the bytes used.  This
+    //! avoids copying out of this object's buffer.  The output must be aligned
+    //! to at least 16 bytes and hold AVCODEC_MAX_AUDIO_FRAME_SIZE bytes or
+    //! ffmpeg refuses it.
+    std::size_t decode(ffmpeg::packet &packet, void *output, std::size_t capacity) {
+      assert(((std::size_t) output) % alignment == 0);
+      assert(capacity >= AVCODEC_MAX_AUDIO_FRAME_SIZE);
+
+      int used_buffer_size = (int) capacity;
+      int bytes_read = decode((int16_t *) output, &used_buffer_size, &(packet.av_packet()));
       // std::cout << "read " << bytes_read  << " and used " << used_buffer_size << " of the buffer." << std::endl;
 
       if (bytes_read < packet.size())  {
@@ -44,11 +55,11 @@ class audio_decoder {
       if (used_buffer_size <= 0) {
         // TODO: more detail.
         std::cerr << "warning: nothing to decode." << std::endl;
+        return 0;
       }
-      else {
-        // don't set this unless we know it's unsigned.
-        buffer_size_ = (std::size_t) used_buffer_size;
-      }
+
+      // don't set this unless we know it's unsigned.
+      return (std::size_t) used_buffer_size;
     }
 
     //! \name Accessors
@@ -86,13 +97,8 @@ class audio_decoder {
 
     ffmpeg::audio_stream &stream_;
 
-    // TODO:
-    //   There is a reasonable argument for making this dynamically allocated.
-    //   If we don't dynamically allocate then there is always an extra copy
-    //   when we take the data from this buffer.  On the other hand, this buffer
-    //   is rather big, mostly empty, and doesn't have any properties.  The
-    //   alternative would be to write directly into whatever the structure the
-    //   rest of the program wants, but that's not very generic.
+    // Only used by decode(packet).  Callers who want to avoid the copy out of
+    // here give their own buffer instead.
     static const std::size_t alignment = 16;
     typedef aligned_memory<alignment, AVCODEC_MAX_AUDIO_FRAME_SIZE / sizeof(int16_t), int16_t> buffer_type;
     buffer_type buffer_;
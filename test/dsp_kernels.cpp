@@ -0,0 +1,240 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+// Every instruction set's kernels must give exactly the same output as the
+// scalar ones (see stages/dsp/simd.hpp).  Each test runs the same input
+// through every isa the machine has and compares the bytes.
+
+#define BOOST_TEST_MODULE dsp_kernels
+#include <boost/test/included/unit_test.hpp>
+
+#include "stages/dsp/convert.hpp"
+#include "stages/dsp/energy.hpp"
+#include "stages/dsp/gain.hpp"
+#include "stages/dsp/resample.hpp"
+#include "stages/dsp/simd.hpp"
+
+#include <boost/cstdint.hpp>
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using boost::int16_t;
+using boost::int32_t;
+using boost::uint32_t;
+
+namespace {
+  // Odd so the vector loops leave something for the scalar tails.
+  const std::size_t count = 4099;
+
+  //! The same numbers every run.
+  class numbers {
+    public:
+    numbers() : state_(12345) {}
+
+    uint32_t next() {
+      state_ = state_ * 1664525u + 1013904223u;
+      return state_;
+    }
+
+    //! In [-range, range].
+    double uniform(double range) {
+      return ((double) this->next() / 4294967295.0 * 2.0 - 1.0) * range;
+    }
+
+    private:
+    uint32_t state_;
+  };
+
+  //! The isas this machine has, scalar first.
+  std::vector<dsp::isa::id> isas() {
+    std::vector<dsp::isa::id> v;
+    v.push_back(dsp::isa::scalar);
+    if (dsp::cpu().sse2) {
+      v.push_back(dsp::isa::sse2);
+    }
+    if (dsp::cpu().avx2) {
+      v.push_back(dsp::isa::avx2);
+    }
+
+    if (v.size() == 1) {
+      BOOST_TEST_MESSAGE("no vector instructions here; only the scalar kernels are run");
+    }
+    return v;
+  }
+
+  //! Puts the limit back however the test ends.
+  struct isa_limit {
+    explicit isa_limit(dsp::isa::id i) { dsp::limit_isa(i); }
+    ~isa_limit() { dsp::limit_isa(dsp::isa::avx2); }
+  };
+
+  template<class T>
+  bool same_bytes(const std::vector<T> &a, const std::vector<T> &b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(&a[0], &b[0], a.size() * sizeof(T)) == 0);
+  }
+
+  template<class T>
+  bool same_bytes(T a, T b) {
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+  }
+
+  //! Loud enough that gains above 1 saturate some of them.
+  template<class T>
+  std::vector<T> integer_samples() {
+    numbers n;
+    std::vector<T> v(count);
+    const double range = (double) std::numeric_limits<T>::max();
+    for (std::size_t i = 0; i < count; ++i) {
+      v[i] = (T) n.uniform(range);
+    }
+    v[0] = std::numeric_limits<T>::min();
+    v[1] = std::numeric_limits<T>::max();
+    return v;
+  }
+
+  template<class T>
+  std::vector<T> float_samples(double range) {
+    numbers n;
+    std::vector<T> v(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      v[i] = (T) n.uniform(range);
+    }
+    return v;
+  }
+
+  template<class T>
+  void check_gain(const std::vector<T> &input, float from, float step) {
+    const std::vector<dsp::isa::id> which = isas();
+
+    std::vector<T> expected(input);
+    {
+      isa_limit limit(dsp::isa::scalar);
+      dsp::apply_gain(&expected[0], expected.size(), from, step);
+    }
+
+    for (std::size_t i = 1; i < which.size(); ++i) {
+      isa_limit limit(which[i]);
+      std::vector<T> got(input);
+      dsp::apply_gain(&got[0], got.size(), from, step);
+      BOOST_CHECK_MESSAGE(same_bytes(expected, got), dsp::isa_name(which[i]) << " gain differs from scalar");
+    }
+  }
+
+  std::vector<float> resample(dsp::isa::id which, unsigned int in_rate, unsigned int out_rate, const std::vector<float> &in) {
+    isa_limit limit(which);
+    const unsigned int channels = 2;
+    const std::size_t frames = in.size() / channels;
+
+    dsp::resampler r;
+    r.setup(in_rate, out_rate, channels, dsp::resampler::quality::high);
+    std::vector<float> out((r.max_output(frames) + r.max_output(r.delay())) * channels);
+    std::size_t written = r.process(&in[0], frames, &out[0]);
+    written += r.flush(&out[written * channels]);
+    out.resize(written * channels);
+    return out;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(gain_s16) {
+  const std::vector<int16_t> in = integer_samples<int16_t>();
+  check_gain(in, 1.0f, 0.0f);
+  check_gain(in, 1.7f, 0.0f);
+  check_gain(in, 0.2f, 0.0004f);
+}
+
+BOOST_AUTO_TEST_CASE(gain_s32) {
+  const std::vector<int32_t> in = integer_samples<int32_t>();
+  check_gain(in, 1.0f, 0.0f);
+  check_gain(in, 1.7f, 0.0f);
+  check_gain(in, 0.2f, 0.0004f);
+}
+
+BOOST_AUTO_TEST_CASE(gain_float) {
+  const std::vector<float> flt = float_samples<float>(1.5);
+  check_gain(flt, 0.5f, 0.0f);
+  check_gain(flt, 2.0f, -0.0003f);
+
+  const std::vector<double> dbl = float_samples<double>(1.5);
+  check_gain(dbl, 0.5f, 0.0f);
+  check_gain(dbl, 2.0f, -0.0003f);
+}
+
+BOOST_AUTO_TEST_CASE(energy) {
+  const std::vector<dsp::isa::id> which = isas();
+  const std::vector<int16_t> s16 = integer_samples<int16_t>();
+  const std::vector<float> flt = float_samples<float>(1.0);
+
+  float expected_s16, expected_flt;
+  {
+    isa_limit limit(dsp::isa::scalar);
+    expected_s16 = dsp::mean_square(&s16[0], s16.size());
+    expected_flt = dsp::mean_square(&flt[0], flt.size());
+  }
+
+  for (std::size_t i = 1; i < which.size(); ++i) {
+    isa_limit limit(which[i]);
+    BOOST_CHECK_MESSAGE(
+      same_bytes(expected_s16, dsp::mean_square(&s16[0], s16.size())),
+      dsp::isa_name(which[i]) << " int16 energy differs from scalar"
+    );
+    BOOST_CHECK_MESSAGE(
+      same_bytes(expected_flt, dsp::mean_square(&flt[0], flt.size())),
+      dsp::isa_name(which[i]) << " float energy differs from scalar"
+    );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(convert) {
+  const std::vector<dsp::isa::id> which = isas();
+  const std::vector<int16_t> s16 = integer_samples<int16_t>();
+
+  // Out of range, halfway between two integers and not a number.
+  std::vector<float> flt = float_samples<float>(1.2);
+  flt[0] = 0.5f / 32768.0f;
+  flt[1] = 1.5f / 32768.0f;
+  flt[2] = -2.5f / 32768.0f;
+  flt[3] = std::numeric_limits<float>::quiet_NaN();
+  flt[4] = std::numeric_limits<float>::infinity();
+  flt[5] = -std::numeric_limits<float>::infinity();
+
+  std::vector<float> expected_to(s16.size());
+  std::vector<int16_t> expected_from(flt.size());
+  {
+    isa_limit limit(dsp::isa::scalar);
+    dsp::to_float(&s16[0], &expected_to[0], s16.size());
+    dsp::from_float(&flt[0], &expected_from[0], flt.size());
+  }
+
+  for (std::size_t i = 1; i < which.size(); ++i) {
+    isa_limit limit(which[i]);
+    std::vector<float> to(s16.size());
+    std::vector<int16_t> from(flt.size());
+    dsp::to_float(&s16[0], &to[0], s16.size());
+    dsp::from_float(&flt[0], &from[0], flt.size());
+    BOOST_CHECK_MESSAGE(same_bytes(expected_to, to), dsp::isa_name(which[i]) << " to_float differs from scalar");
+    BOOST_CHECK_MESSAGE(same_bytes(expected_from, from), dsp::isa_name(which[i]) << " from_float differs from scalar");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(resampler) {
+  const std::vector<dsp::isa::id> which = isas();
+  const std::vector<float> in = float_samples<float>(0.9);
+
+  const std::vector<float> up = resample(dsp::isa::scalar, 44100, 48000, in);
+  const std::vector<float> down = resample(dsp::isa::scalar, 48000, 44100, in);
+  BOOST_CHECK(! up.empty());
+  BOOST_CHECK(! down.empty());
+
+  for (std::size_t i = 1; i < which.size(); ++i) {
+    BOOST_CHECK_MESSAGE(
+      same_bytes(up, resample(which[i], 44100, 48000, in)),
+      dsp::isa_name(which[i]) << " upsampling differs from scalar"
+    );
+    BOOST_CHECK_MESSAGE(
+      same_bytes(down, resample(which[i], 48000, 44100, in)),
+      dsp::isa_name(which[i]) << " downsampling differs from scalar"
+    );
+  }
+}
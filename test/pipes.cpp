@@ -0,0 +1,300 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+// The lock-free rings and the pipes built on them.  The single-threaded cases
+// check exact states, which is only possible when the other side isn't
+// running.  The threaded ones pass numbered values from one thread to another
+// and check that nothing is lost or reordered.
+
+#define BOOST_TEST_MODULE pipes
+#include <boost/test/included/unit_test.hpp>
+
+#include "para/pipes.hpp"
+#include "para/rings.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+  typedef boost::condition_variable condition_type;
+  typedef boost::mutex lockable_type;
+
+  //! Counts the values a cut throws away, from either side.
+  struct count_discarded {
+    static boost::atomic<unsigned long> count;
+    void operator()(int) const { count.fetch_add(1, boost::memory_order_relaxed); }
+  };
+
+  boost::atomic<unsigned long> count_discarded::count(0);
+
+  typedef para::pipe<
+    int, para::parking_sync<condition_type, lockable_type>, para::ring_queue_selector, count_discarded
+  > parking_pipe;
+
+  typedef para::pipe<
+    int, para::basic_monitor_sync<condition_type, lockable_type>, para::simple_queue_selector
+  > locking_pipe;
+
+  //! Small enough that the writer often waits for the reader.
+  const para::pipe_limits threaded_limits(16, 12, 4);
+
+  //! Write 1 to n, in batches unless batch is 1.
+  void write_numbers(parking_pipe &p, int n, std::size_t batch) {
+    std::vector<int> v;
+    for (int i = 1; i <= n; ++i) {
+      v.push_back(i);
+      if (v.size() == batch || i == n) {
+        if (batch == 1) {
+          p.write(v[0]);
+        }
+        else {
+          p.write_batch(v.begin(), v.end());
+        }
+        v.clear();
+      }
+    }
+  }
+
+  //! Write 1 to n with a priority value after every interval numbers, which
+  //! cuts whatever the reader hasn't got to.  The priority value is minus the
+  //! number before it.
+  void write_with_cuts(parking_pipe &p, int n, int interval) {
+    for (int i = 1; i <= n; ++i) {
+      p.write(i);
+      if (i % interval == 0 && i != n) {
+        int marker = -i;
+        p.write_priority(marker);
+      }
+    }
+  }
+
+  //! Fill to the high mark then read down to the low mark, checking the writer
+  //! isn't let back in until it gets there.
+  template<class Pipe>
+  void check_hysteresis() {
+    const para::pipe_limits limits(8, 6, 1);
+    Pipe p(limits);
+
+    for (int i = 1; i <= 5; ++i) {
+      BOOST_CHECK(p.writable(1));
+      p.write(i);
+    }
+
+    // The write which reaches the high mark throttles the writer.
+    BOOST_CHECK(p.writable(1));
+    int six = 6;
+    p.write(six);
+    BOOST_CHECK(! p.writable(1));
+
+    // Reading below the high mark isn't enough.
+    int expected = 1;
+    for (; expected <= 4; ++expected) {
+      BOOST_CHECK_EQUAL(p.read(), expected);
+      BOOST_CHECK(! p.writable(1));
+    }
+
+    // The low mark is.
+    BOOST_CHECK_EQUAL(p.read(), expected++);
+    BOOST_CHECK(p.writable(1));
+    BOOST_CHECK(p.writable(5));
+    BOOST_CHECK(! p.writable(6));
+
+    // Refill and check nothing was lost or reordered.
+    for (int i = 7; i <= 11; ++i) {
+      p.write(i);
+    }
+    BOOST_CHECK(! p.writable(1));
+    for (; expected <= 11; ++expected) {
+      BOOST_CHECK_EQUAL(p.read(), expected);
+    }
+    BOOST_CHECK(! p.readable());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ring_rounds_up) {
+  para::spsc_ring<int> r(5);
+  BOOST_CHECK_EQUAL(r.capacity(), 8u);
+
+  r.reserve(16);
+  BOOST_CHECK_EQUAL(r.capacity(), 16u);
+
+  r.reserve(1);
+  BOOST_CHECK_EQUAL(r.capacity(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(ring_full_and_empty) {
+  para::spsc_ring<int> r(4);
+  int v = 0;
+
+  BOOST_CHECK(r.empty());
+  BOOST_CHECK(! r.full());
+  BOOST_CHECK(! r.try_pop(v));
+
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK(r.try_push(i));
+  }
+  BOOST_CHECK(r.full());
+  BOOST_CHECK_EQUAL(r.size(), 4u);
+  BOOST_CHECK(! r.try_push(99));
+
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK(r.try_pop(v));
+    BOOST_CHECK_EQUAL(v, i);
+  }
+  BOOST_CHECK(r.empty());
+  BOOST_CHECK(! r.try_pop(v));
+}
+
+BOOST_AUTO_TEST_CASE(ring_wraps_around) {
+  para::spsc_ring<int> r(4);
+  int next_in = 0;
+  int next_out = 0;
+  int v;
+
+  // Uneven pushes and pops so the indices go round many times and stop at
+  // every slot.
+  for (int round = 0; round < 100; ++round) {
+    const int pushes = 1 + round % 4;
+    for (int i = 0; i < pushes && r.try_push(next_in); ++i) {
+      ++next_in;
+    }
+    BOOST_CHECK_EQUAL(r.size(), (std::size_t) (next_in - next_out));
+    BOOST_CHECK_EQUAL(r.write_index(), (std::size_t) next_in);
+
+    const int pops = 1 + (round * 3) % 4;
+    for (int i = 0; i < pops && r.try_pop(v); ++i) {
+      BOOST_CHECK_EQUAL(v, next_out);
+      ++next_out;
+    }
+    BOOST_CHECK_EQUAL(r.read_index(), (std::size_t) next_out);
+  }
+
+  while (r.try_pop(v)) {
+    BOOST_CHECK_EQUAL(v, next_out);
+    ++next_out;
+  }
+  BOOST_CHECK_EQUAL(next_out, next_in);
+  BOOST_CHECK(next_in > 4 * 20);
+}
+
+BOOST_AUTO_TEST_CASE(byte_ring_wraps_around) {
+  para::spsc_byte_ring r(8);
+  BOOST_CHECK_EQUAL(r.capacity(), 8u);
+
+  const char data[] = "abcdefghijkl";
+  char out[16];
+
+  BOOST_CHECK_EQUAL(r.write(data, 6), 6u);
+  BOOST_CHECK_EQUAL(r.read(out, 4), 4u);
+  BOOST_CHECK_EQUAL(std::memcmp(out, "abcd", 4), 0);
+
+  // Only six of these fit and they go over the end of the buffer.
+  BOOST_CHECK_EQUAL(r.writable(), 6u);
+  BOOST_CHECK_EQUAL(r.write(data + 6, 8), 6u);
+  BOOST_CHECK_EQUAL(r.writable(), 0u);
+  BOOST_CHECK_EQUAL(r.write(data, 1), 0u);
+
+  BOOST_CHECK_EQUAL(r.read(out, sizeof(out)), 8u);
+  BOOST_CHECK_EQUAL(std::memcmp(out, "efghijkl", 8), 0);
+  BOOST_CHECK_EQUAL(r.read(out, sizeof(out)), 0u);
+  BOOST_CHECK_EQUAL(r.writable(), 8u);
+}
+
+BOOST_AUTO_TEST_CASE(limits_are_derived) {
+  const para::pipe_limits d;
+  BOOST_CHECK_EQUAL(d.capacity(), (std::size_t) para::pipe_limits::default_capacity);
+  BOOST_CHECK_EQUAL(d.high(), d.capacity());
+  BOOST_CHECK_EQUAL(d.low(), d.high() / 2);
+  BOOST_CHECK(d.valid());
+
+  const para::pipe_limits high_only(0, 30);
+  BOOST_CHECK_EQUAL(high_only.capacity(), 30u);
+  BOOST_CHECK_EQUAL(high_only.low(), 15u);
+
+  BOOST_CHECK(! para::pipe_limits(8, 9, 2).valid());
+  BOOST_CHECK(! para::pipe_limits(8, 4, 4).valid());
+}
+
+BOOST_AUTO_TEST_CASE(locking_pipe_hysteresis) {
+  check_hysteresis<locking_pipe>();
+}
+
+BOOST_AUTO_TEST_CASE(parking_pipe_hysteresis) {
+  check_hysteresis<parking_pipe>();
+}
+
+BOOST_AUTO_TEST_CASE(parking_pipe_capacity) {
+  // The ring rounds up so there's more room than the limits say.
+  parking_pipe p(para::pipe_limits(10, 8, 4));
+  BOOST_CHECK_EQUAL(p.capacity(), 16u);
+}
+
+BOOST_AUTO_TEST_CASE(threads_keep_order) {
+  const int n = 200000;
+  const std::size_t batches[] = {1, 7};
+
+  for (std::size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); ++b) {
+    parking_pipe p(threaded_limits);
+    boost::thread writer(boost::bind(&write_numbers, boost::ref(p), n, batches[b]));
+
+    // Read exactly n so the writer always finishes.  Checks are counted
+    // rather than made here so a failure doesn't log n lines.
+    int expected = 1;
+    int wrong = 0;
+    int buffer[5];
+    while (expected <= n) {
+      const std::size_t got = batches[b] == 1
+        ? (buffer[0] = p.read(), 1)
+        : p.read_batch(buffer, sizeof(buffer) / sizeof(buffer[0]));
+      for (std::size_t i = 0; i < got; ++i, ++expected) {
+        wrong += buffer[i] != expected;
+      }
+    }
+
+    writer.join();
+    BOOST_CHECK_EQUAL(wrong, 0);
+    BOOST_CHECK_EQUAL(expected, n + 1);
+    BOOST_CHECK(! p.readable());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(threads_with_cuts) {
+  const int n = 100000;
+  const int interval = 1000;
+  count_discarded::count.store(0);
+
+  parking_pipe p(threaded_limits);
+  boost::thread writer(boost::bind(&write_with_cuts, boost::ref(p), n, interval));
+
+  // Numbers only go up.  Nothing from before a cut comes after its priority
+  // value, and the priority value doesn't overtake anything from after it.
+  int last_number = 0;
+  int last_cut = 0;
+  int wrong = 0;
+  unsigned long read = 0;
+  while (last_number != n) {
+    const int v = p.read();
+    ++read;
+    if (v > 0) {
+      wrong += v <= last_number || v <= last_cut;
+      last_number = v;
+    }
+    else {
+      wrong += -v <= last_cut || -v < last_number;
+      last_cut = -v;
+    }
+  }
+
+  writer.join();
+  BOOST_CHECK_EQUAL(wrong, 0);
+
+  // Everything written was either read or thrown away by a cut.
+  const unsigned long priorities = (n - 1) / interval;
+  BOOST_CHECK_EQUAL(read + count_discarded::count.load(), (unsigned long) n + priorities);
+}
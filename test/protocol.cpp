@@ -0,0 +1,159 @@
+// Copyright (C) 2011, James Webber.
+// Distributed under a 3-clause BSD license.  See COPYING.
+
+// The control protocol's parser, fed the way session feeds it: each read goes
+// after the bytes which the last parse kept.
+
+#define BOOST_TEST_MODULE protocol
+#include <boost/test/included/unit_test.hpp>
+
+#include "server/protocol.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  //! Writes down every command as a line of text.
+  class recorder : public server::protocol::handler {
+    public:
+    std::vector<std::string> got;
+
+    void load(const char *path, std::size_t length) { this->add("load " + std::string(path, length)); }
+    void cue(const char *path, std::size_t length) { this->add("cue " + std::string(path, length)); }
+    void skip() { this->add("skip"); }
+    void pause() { this->add("pause"); }
+    void status() { this->add("status"); }
+    void bye() { this->add("bye"); }
+    void shutdown() { this->add("shutdown"); }
+    void error(const char *) { this->add("error"); }
+
+    void volume(double value, bool decibels) {
+      std::ostringstream s;
+      s << "volume " << value << (decibels ? "dB" : "");
+      this->add(s.str());
+    }
+
+    void subscribe(const char *topic, std::size_t length, unsigned long interval) {
+      std::ostringstream s;
+      s << "subscribe " << std::string(topic, length) << " " << interval;
+      this->add(s.str());
+    }
+
+    void unsubscribe(const char *topic, std::size_t length) {
+      this->add("unsubscribe " + std::string(topic, length));
+    }
+
+    private:
+    void add(const std::string &s) { got.push_back(s); }
+  };
+
+  //! A session's buffer and parser.
+  class session {
+    public:
+    session() : kept_(0) {}
+
+    //! One read from the client, which is more than one for us if it
+    //! doesn't fit in the buffer.
+    void read(const std::string &bytes) {
+      std::size_t done = 0;
+      while (done < bytes.size()) {
+        const std::size_t space = sizeof(buffer_) - kept_;
+        BOOST_REQUIRE(space > 0);
+        const std::size_t n = std::min(space, bytes.size() - done);
+        std::memcpy(buffer_ + kept_, bytes.data() + done, n);
+        kept_ = protocol_.parse(buffer_, sizeof(buffer_), kept_, n, handler);
+        done += n;
+      }
+    }
+
+    //! Every byte in a separate read.
+    void trickle(const std::string &bytes) {
+      for (std::size_t i = 0; i < bytes.size(); ++i) {
+        this->read(bytes.substr(i, 1));
+      }
+    }
+
+    recorder handler;
+
+    private:
+    server::protocol protocol_;
+    char buffer_[64];
+    std::size_t kept_;
+  };
+
+  std::vector<std::string> lines(const char *a, const char *b = NULL, const char *c = NULL, const char *d = NULL) {
+    std::vector<std::string> v;
+    const char *all[] = {a, b, c, d};
+    for (std::size_t i = 0; i < 4 && all[i]; ++i) {
+      v.push_back(all[i]);
+    }
+    return v;
+  }
+
+  const char *const commands =
+    "load /music/a b.flac\n"
+    "cue /music/c.ogg\r\n"
+    "volume -6.5dB\n"
+    "subscribe status 250\n";
+}
+
+// Both are used twice so they mustn't be temporaries.
+#define CHECK_LINES(got__, expected__) \
+  BOOST_CHECK_EQUAL_COLLECTIONS((got__).begin(), (got__).end(), (expected__).begin(), (expected__).end())
+
+BOOST_AUTO_TEST_CASE(whole_reads) {
+  session s;
+  s.read(commands);
+  const std::vector<std::string> expected =
+    lines("load /music/a b.flac", "cue /music/c.ogg", "volume -6.5dB", "subscribe status 250");
+  CHECK_LINES(s.handler.got, expected);
+}
+
+BOOST_AUTO_TEST_CASE(split_reads) {
+  const std::vector<std::string> expected =
+    lines("load /music/a b.flac", "cue /music/c.ogg", "volume -6.5dB", "subscribe status 250");
+
+  // Every place one read could end and the next start.
+  const std::string all(commands);
+  for (std::size_t at = 1; at < all.size(); ++at) {
+    session s;
+    s.read(all.substr(0, at));
+    s.read(all.substr(at));
+    CHECK_LINES(s.handler.got, expected);
+  }
+
+  session s;
+  s.trickle(all);
+  CHECK_LINES(s.handler.got, expected);
+}
+
+BOOST_AUTO_TEST_CASE(bad_line_is_skipped) {
+  session s;
+  s.trickle("lod x\nskip\n");
+  const std::vector<std::string> expected = lines("error", "skip");
+  CHECK_LINES(s.handler.got, expected);
+}
+
+BOOST_AUTO_TEST_CASE(line_too_long) {
+  session s;
+  s.read("load /" + std::string(100, 'x') + "\nskip\n");
+  const std::vector<std::string> expected = lines("error", "skip");
+  CHECK_LINES(s.handler.got, expected);
+}
+
+BOOST_AUTO_TEST_CASE(nothing_after_bye) {
+  session s;
+  s.read("skip\nbye\nload /x\n");
+  const std::vector<std::string> expected = lines("skip", "bye");
+  CHECK_LINES(s.handler.got, expected);
+}
+
+BOOST_AUTO_TEST_CASE(nothing_after_shutdown) {
+  session s;
+  s.read("pause\nshutdown\nskip\n");
+  const std::vector<std::string> expected = lines("pause", "shutdown");
+  CHECK_LINES(s.handler.got, expected);
+}